@@ -31,7 +31,7 @@
 #define BUTTON_UP      32
 #define BUTTON_DOWN    4
 
-// Create the display instance
-extern GxEPD2_BW<GxEPD2_154_D67, GxEPD2_154_D67::HEIGHT> display;
+// Panel driver; screens are rendered into a FrameBuffer (src/frame_buffer.h) and pushed by DisplayUpdater
+extern GxEPD2_154_D67 panel;
 
 #endif // LGFX_WATCHY_EPAPER_HPP 
\ No newline at end of file
@@ -0,0 +1,50 @@
+/**
+  ******************************************************************************
+  * @file    battery_adc.cpp
+  * @brief   Calibrated, oversampled reading of the battery voltage divider
+  ******************************************************************************
+*/
+
+#include "battery_adc.h"
+#include "battery_filter.h"
+#include <esp_adc_cal.h>
+
+static esp_adc_cal_characteristics_t characteristics;
+static esp_adc_cal_value_t calibration = ESP_ADC_CAL_VAL_DEFAULT_VREF;
+
+void batteryAdcBegin() {
+  adc1_config_width(ADC_WIDTH_BIT_12);
+  adc1_config_channel_atten(BATTERY_ADC_CHANNEL, ADC_ATTEN_DB_11);
+  
+  // Two-point or Vref values measured at the factory replace the nominal 3.3V full scale
+  calibration = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12,
+                                         BATTERY_ADC_DEFAULT_VREF_MV, &characteristics);
+  Serial.printf("Battery ADC calibration: %s\n", batteryAdcCalibrationName());
+}
+
+float batteryAdcRead(uint16_t& spread) {
+  uint16_t samples[BATTERY_ADC_BURST];
+  for (int i = 0; i < BATTERY_ADC_BURST; i++) {
+    samples[i] = adc1_get_raw(BATTERY_ADC_CHANNEL);
+  }
+  
+  // Sorted by the trimmed mean, so the quartiles can be read off directly
+  float raw = batteryTrimmedMean(samples, BATTERY_ADC_BURST);
+  spread = samples[BATTERY_ADC_BURST * 3 / 4] - samples[BATTERY_ADC_BURST / 4];
+  
+  // The calibration converts whole counts, interpolate the fraction the averaging gained
+  uint32_t whole = (uint32_t)raw;
+  uint32_t lowMv = esp_adc_cal_raw_to_voltage(whole, &characteristics);
+  uint32_t highMv = esp_adc_cal_raw_to_voltage(whole + 1, &characteristics);
+  float mv = lowMv + (float)(highMv - lowMv) * (raw - whole);
+  
+  return mv / 1000.0f * BATTERY_DIVIDER_RATIO * BATTERY_ADC_SCALE;
+}
+
+const char* batteryAdcCalibrationName() {
+  switch (calibration) {
+    case ESP_ADC_CAL_VAL_EFUSE_TP: return "eFuse two-point";
+    case ESP_ADC_CAL_VAL_EFUSE_VREF: return "eFuse Vref";
+    default: return "default Vref";
+  }
+}
@@ -0,0 +1,50 @@
+/**
+  ******************************************************************************
+  * @file    battery_adc.h
+  * @brief   Calibrated, oversampled reading of the battery voltage divider
+  ******************************************************************************
+*/
+
+#ifndef BATTERY_ADC_H
+#define BATTERY_ADC_H
+
+#include <Arduino.h>
+#include <driver/adc.h>
+
+// GPIO34 on the Watchy, behind a 1:2 divider
+#ifndef BATTERY_ADC_CHANNEL
+#define BATTERY_ADC_CHANNEL ADC1_CHANNEL_6
+#endif
+
+#ifndef BATTERY_DIVIDER_RATIO
+#define BATTERY_DIVIDER_RATIO 2.0f
+#endif
+
+// Residual gain correction on top of the eFuse calibration, 1.0 on a calibrated chip
+#ifndef BATTERY_ADC_SCALE
+#define BATTERY_ADC_SCALE 1.0f
+#endif
+
+// Reference voltage assumed when the chip has no calibration burnt into eFuse
+#ifndef BATTERY_ADC_DEFAULT_VREF_MV
+#define BATTERY_ADC_DEFAULT_VREF_MV 1100
+#endif
+
+// Readings per burst, about 40 us each
+#ifndef BATTERY_ADC_BURST
+#define BATTERY_ADC_BURST 64
+#endif
+
+// Configure the channel and load the calibration, call once before reading
+void batteryAdcBegin();
+
+/**
+ * Read one burst and return the battery voltage of its trimmed mean.
+ * @param spread interquartile range of the burst in raw counts, a noise indicator
+ */
+float batteryAdcRead(uint16_t& spread);
+
+// Which calibration the conversion uses
+const char* batteryAdcCalibrationName();
+
+#endif // BATTERY_ADC_H
@@ -0,0 +1,65 @@
+/**
+  ******************************************************************************
+  * @file    battery_filter.cpp
+  * @brief   Outlier rejection and Kalman filtering of battery voltage samples
+  ******************************************************************************
+*/
+
+#include "battery_filter.h"
+#include <string.h>
+
+float batteryTrimmedMean(uint16_t samples[], int count) {
+  if (count <= 0) {
+    return 0;
+  }
+  
+  // Insertion sort, bursts are a few dozen samples
+  for (int i = 1; i < count; i++) {
+    uint16_t value = samples[i];
+    int j = i - 1;
+    while (j >= 0 && samples[j] > value) {
+      samples[j + 1] = samples[j];
+      j--;
+    }
+    samples[j + 1] = value;
+  }
+  
+  int trim = count * BATTERY_TRIM_PERCENT / 100;
+  uint32_t sum = 0;
+  for (int i = trim; i < count - trim; i++) {
+    sum += samples[i];
+  }
+  return (float)sum / (count - 2 * trim);
+}
+
+void batteryFilterReset(BatteryFilterState& state) {
+  memset(&state, 0, sizeof(state));
+}
+
+float batteryFilterUpdate(BatteryFilterState& state, float measurement) {
+  const float processVariance = BATTERY_PROCESS_NOISE_V * BATTERY_PROCESS_NOISE_V;
+  const float measurementVariance = BATTERY_MEASUREMENT_NOISE_V * BATTERY_MEASUREMENT_NOISE_V;
+  
+  float innovation = measurement - state.estimate;
+  if (state.samples == 0 || innovation > BATTERY_STEP_V || innovation < -BATTERY_STEP_V) {
+    state.estimate = measurement;
+    state.variance = measurementVariance;
+    state.displayed = measurement;
+    state.samples = 1;
+    return state.estimate;
+  }
+  
+  // Predict: the voltage may have drifted since the last burst. Update: weigh the
+  // new burst against the estimate by their variances.
+  state.variance += processVariance;
+  float gain = state.variance / (state.variance + measurementVariance);
+  state.estimate += gain * innovation;
+  state.variance *= 1 - gain;
+  state.samples++;
+  
+  float moved = state.estimate - state.displayed;
+  if (moved >= BATTERY_DISPLAY_HYSTERESIS_V || moved <= -BATTERY_DISPLAY_HYSTERESIS_V) {
+    state.displayed = state.estimate;
+  }
+  return state.estimate;
+}
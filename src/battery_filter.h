@@ -0,0 +1,60 @@
+/**
+  ******************************************************************************
+  * @file    battery_filter.h
+  * @brief   Outlier rejection and Kalman filtering of battery voltage samples
+  ******************************************************************************
+*/
+
+#ifndef BATTERY_FILTER_H
+#define BATTERY_FILTER_H
+
+// Plain C/C++ only, so the filter can run in host-side simulations
+#include <stdint.h>
+
+// Fraction of a burst dropped at each end before averaging, in percent
+#ifndef BATTERY_TRIM_PERCENT
+#define BATTERY_TRIM_PERCENT 25
+#endif
+
+// Expected drift of the true voltage between two bursts, volts (standard deviation)
+#ifndef BATTERY_PROCESS_NOISE_V
+#define BATTERY_PROCESS_NOISE_V 0.003f
+#endif
+
+// Noise of one trimmed burst average, volts (standard deviation)
+#ifndef BATTERY_MEASUREMENT_NOISE_V
+#define BATTERY_MEASUREMENT_NOISE_V 0.012f
+#endif
+
+// A burst this far from the estimate is a real step, e.g. a charger, and restarts the filter
+#ifndef BATTERY_STEP_V
+#define BATTERY_STEP_V 0.15f
+#endif
+
+// The displayed value follows the estimate only once it moved this far, so a value
+// sitting on a rounding boundary does not flip the last digit on every sample
+#ifndef BATTERY_DISPLAY_HYSTERESIS_V
+#define BATTERY_DISPLAY_HYSTERESIS_V 0.008f
+#endif
+
+// Scalar Kalman filter state, kept in RTC memory so it carries over deep sleep
+struct BatteryFilterState {
+  float estimate;  // Volts, 0 until the first sample
+  float variance;  // Of the estimate, volts squared
+  float displayed; // Volts, what the screen and the web page show
+  uint32_t samples;
+};
+
+/**
+ * Mean of a burst of raw ADC readings without its highest and lowest
+ * BATTERY_TRIM_PERCENT, which removes spikes from radio transmissions.
+ * Sorts samples in place.
+ */
+float batteryTrimmedMean(uint16_t samples[], int count);
+
+void batteryFilterReset(BatteryFilterState& state);
+
+// Feed one burst average in volts, returns the new estimate
+float batteryFilterUpdate(BatteryFilterState& state, float measurement);
+
+#endif // BATTERY_FILTER_H
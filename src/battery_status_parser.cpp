@@ -0,0 +1,72 @@
+/**
+  ******************************************************************************
+  * @file    battery_status_parser.cpp
+  * @brief   Main battery voltage from a mavlink2rest BATTERY_STATUS JSON message
+  ******************************************************************************
+*/
+
+#include "battery_status_parser.h"
+#include <string.h>
+
+// Find needle in a buffer that is not necessarily null-terminated
+static const char* findToken(const char* haystack, size_t length, const char* needle) {
+  size_t needleLength = strlen(needle);
+  for (size_t i = 0; i + needleLength <= length; i++) {
+    if (memcmp(haystack + i, needle, needleLength) == 0) {
+      return haystack + i;
+    }
+  }
+  return nullptr;
+}
+
+// Unsigned integer right after token, e.g. "\"id\":"; false if the token or the number is missing
+static bool readNumber(const char* json, size_t length, const char* token, long& value) {
+  const char* start = findToken(json, length, token);
+  if (start == nullptr) {
+    return false;
+  }
+  
+  const char* end = json + length;
+  const char* cursor = start + strlen(token);
+  while (cursor < end && *cursor == ' ') {
+    cursor++;
+  }
+  value = 0;
+  int digits = 0;
+  while (cursor < end && *cursor >= '0' && *cursor <= '9' && digits < 6) {
+    value = value * 10 + (*cursor - '0');
+    cursor++;
+    digits++;
+  }
+  return digits > 0;
+}
+
+bool parseBatteryStatusVoltage(const char* json, size_t length, float& volts) {
+  if (findToken(json, length, "\"BATTERY_STATUS\"") == nullptr) {
+    return false;
+  }
+  
+  // The header names the sender, the message the battery
+  long systemId;
+  long componentId;
+  long batteryId;
+  if (!readNumber(json, length, "\"system_id\":", systemId) || systemId != 1 ||
+      !readNumber(json, length, "\"component_id\":", componentId) || componentId != 1 ||
+      !readNumber(json, length, "\"id\":", batteryId) || batteryId != 0) {
+    return false;
+  }
+  
+  // First array element, in millivolts
+  long millivolts;
+  if (!readNumber(json, length, "\"voltages\":[", millivolts)) {
+    return false;
+  }
+  
+  // UINT16_MAX means the cell voltage is unknown
+  if (millivolts <= 0 || millivolts >= 65535) {
+    return false;
+  }
+  
+  volts = millivolts / 1000.0f;
+  return true;
+}
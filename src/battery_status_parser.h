@@ -0,0 +1,23 @@
+/**
+  ******************************************************************************
+  * @file    battery_status_parser.h
+  * @brief   Main battery voltage from a mavlink2rest BATTERY_STATUS JSON message
+  ******************************************************************************
+*/
+
+#ifndef BATTERY_STATUS_PARSER_H
+#define BATTERY_STATUS_PARSER_H
+
+// Plain C/C++ only, so the parser can be tested on the host against recorded messages
+#include <stddef.h>
+
+/**
+ * Extract voltages[0] from a mavlink2rest BATTERY_STATUS JSON message. Like the HTTP
+ * path (vehicles/1/components/1), only the autopilot of system 1 is accepted, and only
+ * its main battery (id 0).
+ * @param json message, not necessarily null-terminated
+ * @return true and fills volts when a valid cell voltage was found
+ */
+bool parseBatteryStatusVoltage(const char* json, size_t length, float& volts);
+
+#endif // BATTERY_STATUS_PARSER_H
@@ -0,0 +1,151 @@
+/**
+  ******************************************************************************
+  * @file    battery_stream.cpp
+  * @brief   BATTERY_STATUS subscription over the mavlink2rest WebSocket
+  ******************************************************************************
+*/
+
+#include "battery_stream.h"
+#include "battery_status_parser.h"
+#include "live_voltage.h"
+#include <IPAddress.h>
+#include <WebSocketsClient.h>
+
+// Initialize static instance
+BatteryStream* BatteryStream::instance = nullptr;
+
+BatteryStream::BatteryStream() : wantedCount(0), wantedChanged(false), task(nullptr) {
+  mutex = xSemaphoreCreateMutex();
+  for (int i = 0; i < BATTERY_STREAM_SLOTS; i++) {
+    subscriptions[i].client = nullptr;
+    streamThrottleReset(subscriptions[i].throttle);
+  }
+}
+
+BatteryStream* BatteryStream::getInstance() {
+  if (instance == nullptr) {
+    instance = new BatteryStream();
+  }
+  return instance;
+}
+
+void BatteryStream::begin() {
+  if (task == nullptr) {
+    xTaskCreate(streamTask, "batstream", 6144, this, 1, &task);
+  }
+}
+
+void BatteryStream::setVehicles(const String vehicleIPs[], int count) {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  wantedCount = min(count, MAX_VEHICLES);
+  for (int i = 0; i < wantedCount; i++) {
+    wantedIPs[i] = vehicleIPs[i];
+  }
+#ifdef BATTERY_STREAM_FIXED_IP
+  wantedIPs[wantedCount++] = BATTERY_STREAM_FIXED_IP;
+#endif
+  wantedChanged = true;
+  xSemaphoreGive(mutex);
+}
+
+void BatteryStream::streamTask(void* param) {
+  BatteryStream* stream = static_cast<BatteryStream*>(param);
+  
+  while (true) {
+    stream->applySubscriptions();
+  
+    // Connecting may block, which is why this runs on its own task
+    for (int i = 0; i < BATTERY_STREAM_SLOTS; i++) {
+      if (stream->subscriptions[i].client != nullptr) {
+        stream->subscriptions[i].client->loop();
+      }
+    }
+  
+    vTaskDelay(pdMS_TO_TICKS(20));
+  }
+}
+
+// Runs on the stream task, the only owner of the clients
+void BatteryStream::applySubscriptions() {
+  uint32_t wanted[BATTERY_STREAM_SLOTS];
+  int count = 0;
+  
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  bool changed = wantedChanged;
+  if (changed) {
+    for (int i = 0; i < wantedCount; i++) {
+      IPAddress address;
+      if (address.fromString(wantedIPs[i])) {
+        wanted[count++] = (uint32_t)address;
+      }
+    }
+    wantedChanged = false;
+  }
+  xSemaphoreGive(mutex);
+  
+  if (!changed) {
+    return;
+  }
+  
+  uint32_t slots[BATTERY_STREAM_SLOTS];
+  for (int i = 0; i < BATTERY_STREAM_SLOTS; i++) {
+    IPAddress address;
+    bool subscribed = subscriptions[i].client != nullptr && address.fromString(subscriptions[i].ip);
+    slots[i] = subscribed ? (uint32_t)address : 0;
+  }
+  uint32_t previous[BATTERY_STREAM_SLOTS];
+  memcpy(previous, slots, sizeof(previous));
+  streamSubscriptionsAssign(slots, BATTERY_STREAM_SLOTS, wanted, count);
+  
+  for (int i = 0; i < BATTERY_STREAM_SLOTS; i++) {
+    if (slots[i] == previous[i]) {
+      continue;
+    }
+    Subscription& subscription = subscriptions[i];
+  
+    // Unsubscribe from a vehicle that left the table
+    if (subscription.client != nullptr) {
+      Serial.println("Battery stream: unsubscribing " + subscription.ip);
+      subscription.client->disconnect();
+      delete subscription.client;
+      subscription.client = nullptr;
+      subscription.ip = "";
+    }
+    if (slots[i] == 0) {
+      continue;
+    }
+  
+    // Subscribe to a new one
+    subscription.ip = IPAddress(slots[i]).toString();
+    streamThrottleReset(subscription.throttle);
+    subscription.client = new WebSocketsClient();
+    subscription.client->begin(subscription.ip, MAVLINK2REST_WS_PORT, MAVLINK2REST_WS_PATH);
+    subscription.client->setReconnectInterval(BATTERY_STREAM_RECONNECT_MS);
+    subscription.client->onEvent([this, i](WStype_t type, uint8_t* payload, size_t length) {
+      if (type == WStype_TEXT) {
+        handleMessage(i, payload, length);
+      } else if (type == WStype_CONNECTED) {
+        Serial.println("Battery stream: subscribed to " + subscriptions[i].ip);
+      } else if (type == WStype_DISCONNECTED) {
+        Serial.println("Battery stream: disconnected from " + subscriptions[i].ip);
+      }
+    });
+  }
+}
+
+void BatteryStream::handleMessage(int index, const uint8_t* payload, size_t length) {
+  Subscription& subscription = subscriptions[index];
+  
+  // Throttle on the watch side: skip parsing until the interval elapsed
+  uint32_t now = millis();
+  if (!streamThrottleReady(subscription.throttle, now, BATTERY_STREAM_MIN_INTERVAL_MS)) {
+    return;
+  }
+  
+  float volts;
+  if (parseBatteryStatusVoltage(reinterpret_cast<const char*>(payload), length, volts)) {
+    streamThrottleAccept(subscription.throttle, now);
+    Serial.printf("Battery stream: %s at %.2f V\n", subscription.ip.c_str(), volts);
+    LiveVoltageStore::getInstance()->publish(subscription.ip, volts, LIVE_SOURCE_WEBSOCKET);
+  }
+}
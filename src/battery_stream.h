@@ -0,0 +1,76 @@
+/**
+  ******************************************************************************
+  * @file    battery_stream.h
+  * @brief   BATTERY_STATUS subscription over the mavlink2rest WebSocket
+  ******************************************************************************
+*/
+
+#ifndef BATTERY_STREAM_H
+#define BATTERY_STREAM_H
+
+#include <Arduino.h>
+#include "telemetry.h"
+#include "stream_subscriptions.h"
+
+// mavlink2rest WebSocket endpoint, filtered server-side to BATTERY_STATUS.
+// Override the port/path to point the stream at a local stand-in server.
+#ifndef MAVLINK2REST_WS_PORT
+#define MAVLINK2REST_WS_PORT 6040
+#endif
+#ifndef MAVLINK2REST_WS_PATH
+#define MAVLINK2REST_WS_PATH "/v1/ws/mavlink?filter=BATTERY_STATUS"
+#endif
+
+// Updates arriving sooner than this after the last accepted one are dropped unparsed
+#ifndef BATTERY_STREAM_MIN_INTERVAL_MS
+#define BATTERY_STREAM_MIN_INTERVAL_MS 5000
+#endif
+
+// Delay between reconnection attempts of a dropped subscription
+#ifndef BATTERY_STREAM_RECONNECT_MS
+#define BATTERY_STREAM_RECONNECT_MS 10000
+#endif
+
+// Subscribe to this IPv4 address too, whatever discovery finds, e.g. a host running
+// tools/standin/mavlink2rest_standin.py (with MAVLINK2REST_WS_PORT set to its port)
+#ifdef BATTERY_STREAM_FIXED_IP
+#define BATTERY_STREAM_SLOTS (MAX_VEHICLES + 1)
+#else
+#define BATTERY_STREAM_SLOTS MAX_VEHICLES
+#endif
+
+class WebSocketsClient;
+
+// One WebSocket subscription per discovered vehicle, serviced by a background task
+class BatteryStream {
+private:
+  struct Subscription {
+    String ip;
+    WebSocketsClient* client;
+    StreamThrottle throttle;
+  };
+  
+  static BatteryStream* instance;
+  Subscription subscriptions[BATTERY_STREAM_SLOTS];
+  String wantedIPs[BATTERY_STREAM_SLOTS];
+  int wantedCount;
+  bool wantedChanged;
+  SemaphoreHandle_t mutex;
+  TaskHandle_t task;
+  
+  BatteryStream();
+  static void streamTask(void* param);
+  void applySubscriptions();
+  void handleMessage(int index, const uint8_t* payload, size_t length);
+
+public:
+  static BatteryStream* getInstance();
+  
+  // Start the background task
+  void begin();
+  
+  // Set the vehicles to subscribe to, applied by the stream task
+  void setVehicles(const String vehicleIPs[], int count);
+};
+
+#endif // BATTERY_STREAM_H
@@ -0,0 +1,173 @@
+/**
+  ******************************************************************************
+  * @file    charge_estimator.cpp
+  * @brief   State of charge and time to empty of a LiPo pack from its voltage history
+  ******************************************************************************
+*/
+
+#include "charge_estimator.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Resting cell voltage at 0, 5, ... 100 percent
+static const float CELL_CURVE[] = {
+  3.27f, 3.61f, 3.69f, 3.71f, 3.73f, 3.75f, 3.77f, 3.79f, 3.80f, 3.82f, 3.84f,
+  3.85f, 3.87f, 3.91f, 3.95f, 3.98f, 4.02f, 4.08f, 4.11f, 4.15f, 4.20f
+};
+#define CELL_CURVE_POINTS (sizeof(CELL_CURVE) / sizeof(CELL_CURVE[0]))
+#define CELL_CURVE_STEP (100.0f / (CELL_CURVE_POINTS - 1))
+
+// Slower changes than this, percent per hour, are neither charging nor discharging
+#define RATE_DEADBAND 0.2f
+
+// Time to empty is capped, a pack lasting longer than this is effectively idle
+#define MAX_MINUTES_TO_EMPTY (99L * 24L * 60L)
+
+float chargeSocFromCellVoltage(float cellVolts) {
+  if (cellVolts <= CELL_CURVE[0]) {
+    return 0;
+  }
+  for (unsigned int i = 1; i < CELL_CURVE_POINTS; i++) {
+    if (cellVolts < CELL_CURVE[i]) {
+      float fraction = (cellVolts - CELL_CURVE[i - 1]) / (CELL_CURVE[i] - CELL_CURVE[i - 1]);
+      return (i - 1 + fraction) * CELL_CURVE_STEP;
+    }
+  }
+  return 100;
+}
+
+// Every count the voltage allows, at least one
+static void plausibleCells(float packVolts, uint8_t& fewest, uint8_t& most) {
+  int low = (int)ceilf(packVolts / CHARGE_CELL_MAX_V);
+  int high = (int)floorf(packVolts / CHARGE_CELL_EMPTY_V);
+  low = low < 1 ? 1 : (low > CHARGE_MAX_CELLS ? CHARGE_MAX_CELLS : low);
+  high = high < low ? low : (high > CHARGE_MAX_CELLS ? CHARGE_MAX_CELLS : high);
+  fewest = low;
+  most = high;
+}
+
+uint8_t chargeDetectCells(float packVolts) {
+  uint8_t fewest;
+  uint8_t most;
+  plausibleCells(packVolts, fewest, most);
+  return fewest == most ? fewest : 0;
+}
+
+uint8_t chargeConfiguredCells(const char* table, const char* key) {
+  size_t keyLength = strlen(key);
+  const char* entry = table;
+  while (entry != nullptr && *entry != '\0') {
+    const char* end = strchr(entry, ',');
+    const char* equals = strchr(entry, '=');
+    if (equals != nullptr && (end == nullptr || equals < end) &&
+        (size_t)(equals - entry) == keyLength && strncmp(entry, key, keyLength) == 0) {
+      int cells = atoi(equals + 1);
+      return cells < 0 || cells > CHARGE_MAX_CELLS ? 0 : cells;
+    }
+    entry = end != nullptr ? end + 1 : nullptr;
+  }
+  return 0;
+}
+
+// Forget the charge history but not what is known about the cell count
+static void clearHistory(ChargeEstimatorState& state) {
+  state.samples = 0;
+  state.soc = 0;
+  state.sw = state.st = state.sy = state.stt = state.sty = 0;
+}
+
+void chargeEstimatorReset(ChargeEstimatorState& state, uint8_t fixedCells) {
+  memset(&state, 0, sizeof(state));
+  state.fixedCells = fixedCells;
+  state.cells = fixedCells;
+  state.minCells = fixedCells;
+  state.maxCells = fixedCells;
+}
+
+void chargeEstimatorUpdate(ChargeEstimatorState& state, float packVolts, uint64_t nowMs) {
+  if (packVolts <= 0) {
+    return;
+  }
+  
+  if (state.fixedCells == 0) {
+    uint8_t fewest;
+    uint8_t most;
+    plausibleCells(packVolts, fewest, most);
+  
+    // A pack too high for the largest count, or too low for the smallest, is another one
+    bool swapped = state.minCells > 0 &&
+                   (fewest > state.maxCells || packVolts / state.minCells < CHARGE_CELL_MIN_V);
+    if (state.minCells == 0 || swapped) {
+      chargeEstimatorReset(state, 0);
+      state.minCells = fewest;
+      state.maxCells = most;
+    } else {
+      // Only ever narrowed: a deep sag below CHARGE_CELL_EMPTY_V keeps the count
+      state.minCells = fewest > state.minCells ? fewest : state.minCells;
+      state.maxCells = most < state.maxCells ? most : state.maxCells;
+      state.maxCells = state.maxCells < state.minCells ? state.minCells : state.maxCells;
+    }
+  
+    uint8_t cells = state.minCells == state.maxCells ? state.minCells : 0;
+    if (cells != state.cells) {
+      clearHistory(state);
+      state.cells = cells;
+    }
+    if (state.cells == 0) {
+      // No charge history while the count is open
+      state.lastMs = nowMs;
+      return;
+    }
+  }
+  float soc = chargeSocFromCellVoltage(packVolts / state.cells);
+  
+  if (state.samples > 0 && (soc > state.soc + CHARGE_RESET_PERCENT || nowMs < state.lastMs)) {
+    // Recharged, the count stays
+    clearHistory(state);
+  }
+  
+  if (state.samples == 0) {
+    state.firstMs = nowMs;
+  } else {
+    // Move the time origin to this sample and fade the history, both O(1) on the sums
+    double dt = (nowMs - state.lastMs) / 3600000.0;
+    double decay = exp(-(double)(nowMs - state.lastMs) / CHARGE_RATE_WINDOW_MS);
+    state.sty = (state.sty - dt * state.sy) * decay;
+    state.stt = (state.stt - 2 * dt * state.st + dt * dt * state.sw) * decay;
+    state.st = (state.st - dt * state.sw) * decay;
+    state.sy *= decay;
+    state.sw *= decay;
+  }
+  state.sw += 1;
+  state.sy += soc;
+  
+  state.soc = soc;
+  state.lastMs = nowMs;
+  if (state.samples < UINT16_MAX) {
+    state.samples++;
+  }
+}
+
+ChargeEstimate chargeEstimatorGet(const ChargeEstimatorState& state) {
+  ChargeEstimate estimate = { state.cells, -1.0f, 0.0f, -1, false };
+  if (state.samples == 0) {
+    return estimate;
+  }
+  estimate.soc = state.soc;
+  
+  double denominator = state.sw * state.stt - state.st * state.st;
+  if (state.samples < CHARGE_MIN_SAMPLES || state.lastMs - state.firstMs < CHARGE_MIN_SPAN_MS || denominator <= 0) {
+    return estimate;
+  }
+  
+  float rate = (float)((state.sw * state.sty - state.st * state.sy) / denominator);
+  estimate.ratePerHour = rate;
+  if (rate > RATE_DEADBAND) {
+    estimate.charging = true;
+  } else if (rate < -RATE_DEADBAND) {
+    double minutes = state.soc / -rate * 60;
+    estimate.minutesToEmpty = minutes > MAX_MINUTES_TO_EMPTY ? MAX_MINUTES_TO_EMPTY : (int32_t)minutes;
+  }
+  return estimate;
+}
@@ -0,0 +1,91 @@
+/**
+  ******************************************************************************
+  * @file    charge_estimator.h
+  * @brief   State of charge and time to empty of a LiPo pack from its voltage history
+  ******************************************************************************
+*/
+
+#ifndef CHARGE_ESTIMATOR_H
+#define CHARGE_ESTIMATOR_H
+
+// Plain C/C++ only, so the estimator can run in host-side simulations
+#include <stdint.h>
+
+// Samples older than this weigh 1/e as much in the discharge rate
+#ifndef CHARGE_RATE_WINDOW_MS
+#define CHARGE_RATE_WINDOW_MS (30UL * 60UL * 1000UL)
+#endif
+
+// History needed before a discharge rate is reported
+#ifndef CHARGE_MIN_SAMPLES
+#define CHARGE_MIN_SAMPLES 4
+#endif
+
+#ifndef CHARGE_MIN_SPAN_MS
+#define CHARGE_MIN_SPAN_MS (5UL * 60UL * 1000UL)
+#endif
+
+// A rise this large is a recharge or a fresh pack, the history starts over
+#ifndef CHARGE_RESET_PERCENT
+#define CHARGE_RESET_PERCENT 10.0f
+#endif
+
+// A cell never reads above CHARGE_CELL_MAX_V, and an empty or sagging one under load
+// rarely below CHARGE_CELL_EMPTY_V, so a pack voltage allows every count in between.
+// A full 4S pack (16.8 V) could also be a 5S one at 3.36 V per cell: the count, and with
+// it the charge, stays unknown until the voltages seen leave a single count, or the
+// count is configured.
+#define CHARGE_CELL_MAX_V 4.25f
+#define CHARGE_CELL_EMPTY_V 3.0f
+
+// No LiPo cell rests below this: at the known count the pack must have been swapped
+#define CHARGE_CELL_MIN_V 2.5f
+#define CHARGE_MAX_CELLS 12
+
+/**
+ * Voltage history of one pack, small enough for RTC memory. The discharge rate is a
+ * least-squares line through the charge samples, with older samples fading out; its
+ * sums are updated in O(1) per sample with time measured back from the newest one.
+ */
+struct ChargeEstimatorState {
+  uint8_t cells;      // Detected or fixed series cell count, 0 while unknown
+  uint8_t fixedCells; // 0 to detect from the voltage
+  uint8_t minCells;   // Counts the voltages seen so far allow, 0 before the first sample
+  uint8_t maxCells;
+  uint16_t samples;
+  float soc;          // Percent at the last sample
+  uint64_t firstMs;
+  uint64_t lastMs;
+  double sw, st, sy, stt, sty; // Weighted sums of 1, t, soc, t^2 and t*soc, t in hours
+};
+
+struct ChargeEstimate {
+  uint8_t cells;          // 0 when nothing is known
+  float soc;              // Percent, < 0 when unknown
+  float ratePerHour;      // Percent per hour, negative while discharging, 0 until known
+  int32_t minutesToEmpty; // -1 when unknown, not discharging or charging
+  bool charging;
+};
+
+// State of charge in percent of one cell at rest, from the LiPo discharge curve
+float chargeSocFromCellVoltage(float cellVolts);
+
+// Series cells of a pack from one voltage, 0 when more than one count is plausible
+uint8_t chargeDetectCells(float packVolts);
+
+/**
+ * Configured cell count of a vehicle
+ * @param table comma separated key=cells entries, e.g. "192.168.2.2=4,192.168.2.3=6"
+ * @return the count for key, 0 to detect it from the voltage
+ */
+uint8_t chargeConfiguredCells(const char* table, const char* key);
+
+// Forget the history, fixedCells 0 to detect the cell count on the next sample
+void chargeEstimatorReset(ChargeEstimatorState& state, uint8_t fixedCells);
+
+// Add a pack voltage measured at nowMs
+void chargeEstimatorUpdate(ChargeEstimatorState& state, float packVolts, uint64_t nowMs);
+
+ChargeEstimate chargeEstimatorGet(const ChargeEstimatorState& state);
+
+#endif // CHARGE_ESTIMATOR_H
@@ -0,0 +1,68 @@
+/**
+  ******************************************************************************
+  * @file    charge_monitor.cpp
+  * @brief   Charge estimates of the watch and of every vehicle battery
+  ******************************************************************************
+*/
+
+#include "charge_monitor.h"
+#include "rtc_state.h"
+#include <IPAddress.h>
+
+void chargeMonitorRecordWatch(float volts) {
+  ChargeEstimatorState& state = rtcState.watchCharge;
+  if (state.fixedCells != CHARGE_WATCH_CELLS) {
+    chargeEstimatorReset(state, CHARGE_WATCH_CELLS);
+  }
+  chargeEstimatorUpdate(state, volts, rtcStateUptimeMs());
+}
+
+ChargeEstimate chargeMonitorWatch() {
+  return chargeEstimatorGet(rtcState.watchCharge);
+}
+
+// Slot of a vehicle, or nullptr if it has none
+static RtcVehicleCharge* findVehicle(uint32_t ip) {
+  for (int i = 0; i < MAX_VEHICLES; i++) {
+    if (rtcState.vehicleCharge[i].ip == ip) {
+      return &rtcState.vehicleCharge[i];
+    }
+  }
+  return nullptr;
+}
+
+void chargeMonitorRecordVehicle(const String& ip, float volts) {
+  IPAddress address;
+  if (volts <= 0 || !address.fromString(ip)) {
+    return;
+  }
+  
+  uint8_t cells = chargeConfiguredCells(CHARGE_VEHICLE_CELLS, ip.c_str());
+  RtcVehicleCharge* slot = findVehicle((uint32_t)address);
+  if (slot != nullptr && slot->state.fixedCells != cells) {
+    // The configured count changed with the firmware
+    chargeEstimatorReset(slot->state, cells);
+  }
+  if (slot == nullptr) {
+    slot = &rtcState.vehicleCharge[0];
+    for (int i = 1; i < MAX_VEHICLES; i++) {
+      if (rtcState.vehicleCharge[i].state.lastMs < slot->state.lastMs) {
+        slot = &rtcState.vehicleCharge[i];
+      }
+    }
+    slot->ip = (uint32_t)address;
+    chargeEstimatorReset(slot->state, cells);
+  }
+  chargeEstimatorUpdate(slot->state, volts, rtcStateUptimeMs());
+}
+
+ChargeEstimate chargeMonitorVehicle(const String& ip) {
+  IPAddress address;
+  RtcVehicleCharge* slot = address.fromString(ip) ? findVehicle((uint32_t)address) : nullptr;
+  if (slot == nullptr) {
+    ChargeEstimatorState empty;
+    chargeEstimatorReset(empty, 0);
+    return chargeEstimatorGet(empty);
+  }
+  return chargeEstimatorGet(slot->state);
+}
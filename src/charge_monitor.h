@@ -0,0 +1,36 @@
+/**
+  ******************************************************************************
+  * @file    charge_monitor.h
+  * @brief   Charge estimates of the watch and of every vehicle battery
+  ******************************************************************************
+*/
+
+#ifndef CHARGE_MONITOR_H
+#define CHARGE_MONITOR_H
+
+#include <Arduino.h>
+#include "charge_estimator.h"
+
+// The watch runs from a single LiPo cell
+#define CHARGE_WATCH_CELLS 1
+
+// Cell counts of vehicle packs by IP, e.g. "192.168.2.2=4,192.168.2.3=6". Others are
+// counted from their voltage, and read unknown while that allows more than one count.
+#ifndef CHARGE_VEHICLE_CELLS
+#define CHARGE_VEHICLE_CELLS ""
+#endif
+
+// Add a filtered watch battery voltage
+void chargeMonitorRecordWatch(float volts);
+
+ChargeEstimate chargeMonitorWatch();
+
+/**
+ * Add a vehicle pack voltage. Vehicles are tracked by IP in RTC memory; a new
+ * vehicle takes over the slot of the one heard from least recently.
+ */
+void chargeMonitorRecordVehicle(const String& ip, float volts);
+
+ChargeEstimate chargeMonitorVehicle(const String& ip);
+
+#endif // CHARGE_MONITOR_H
@@ -0,0 +1,220 @@
+/**
+  ******************************************************************************
+  * @file    circuit_breaker.cpp
+  * @brief   Per-vehicle circuit breaker keeping unreachable vehicles off the network path
+  ******************************************************************************
+*/
+
+#include "circuit_breaker.h"
+
+void CircuitBreaker::trip(unsigned long now) {
+  // Exponential backoff: base, 2x base, 4x base... capped
+  unsigned long duration = BREAKER_BASE_OPEN_MS;
+  for (uint8_t i = 0; i < trips && duration < BREAKER_MAX_OPEN_MS; i++) {
+    duration *= 2;
+  }
+  
+  state = BREAKER_OPEN;
+  openedAt = now;
+  openDuration = min(duration, (unsigned long)BREAKER_MAX_OPEN_MS);
+  if (trips < UINT8_MAX) {
+    trips++;
+  }
+}
+
+bool CircuitBreaker::allowRequest(unsigned long now) {
+  switch (state) {
+    case BREAKER_CLOSED:
+      return true;
+    case BREAKER_OPEN:
+      if (now - openedAt >= openDuration) {
+        state = BREAKER_HALF_OPEN;
+        return true;
+      }
+      return false;
+    case BREAKER_HALF_OPEN:
+    default:
+      // A probe is already in flight
+      return false;
+  }
+}
+
+void CircuitBreaker::recordSuccess() {
+  state = BREAKER_CLOSED;
+  consecutiveFailures = 0;
+  trips = 0;
+}
+
+void CircuitBreaker::recordFailure(unsigned long now) {
+  if (state == BREAKER_HALF_OPEN) {
+    // The probe failed, stay away for longer
+    trip(now);
+    return;
+  }
+  
+  if (consecutiveFailures < UINT8_MAX) {
+    consecutiveFailures++;
+  }
+  if (state == BREAKER_CLOSED && consecutiveFailures >= BREAKER_FAILURE_THRESHOLD) {
+    trip(now);
+  }
+}
+
+unsigned long CircuitBreaker::remainingOpen(unsigned long now) const {
+  if (state != BREAKER_OPEN || now - openedAt >= openDuration) {
+    return 0;
+  }
+  return openDuration - (now - openedAt);
+}
+
+void CircuitBreaker::save(BreakerRecord& record, unsigned long now, uint64_t uptimeMs) const {
+  record.consecutiveFailures = consecutiveFailures;
+  record.trips = trips;
+  record.open = state != BREAKER_CLOSED;
+  record.openUntilMs = uptimeMs + remainingOpen(now);
+}
+
+void CircuitBreaker::restore(const BreakerRecord& record, unsigned long now, uint64_t uptimeMs) {
+  consecutiveFailures = record.consecutiveFailures;
+  trips = record.trips;
+  
+  // A half-open breaker lost its probe with the sleep, it probes again once the period is over
+  state = record.open ? BREAKER_OPEN : BREAKER_CLOSED;
+  openedAt = now;
+  openDuration = record.open && record.openUntilMs > uptimeMs ? record.openUntilMs - uptimeMs : 0;
+}
+
+// Initialize static instance
+VehicleHealthTable* VehicleHealthTable::instance = nullptr;
+
+VehicleHealthTable::VehicleHealthTable() : entryCount(0) {
+  mutex = xSemaphoreCreateMutex();
+}
+
+VehicleHealthTable* VehicleHealthTable::getInstance() {
+  if (instance == nullptr) {
+    instance = new VehicleHealthTable();
+  }
+  return instance;
+}
+
+// Caller must hold the mutex
+VehicleHealth& VehicleHealthTable::findOrCreate(const String& ip) {
+  for (int i = 0; i < entryCount; i++) {
+    if (entries[i].ip == ip) {
+      return entries[i];
+    }
+  }
+  
+  // Replace the entry read longest ago when the table is full
+  int index = entryCount;
+  if (entryCount < MAX_VEHICLES) {
+    entryCount++;
+  } else {
+    index = 0;
+    for (int i = 1; i < MAX_VEHICLES; i++) {
+      if (entries[i].lastVoltageAt < entries[index].lastVoltageAt) {
+        index = i;
+      }
+    }
+  }
+  
+  VehicleHealth& entry = entries[index];
+  entry.ip = ip;
+  entry.breaker = CircuitBreaker();
+  entry.lastVoltage = -1.0f;
+  entry.lastVoltageAt = 0;
+  return entry;
+}
+
+bool VehicleHealthTable::allowRequest(const String& ip, bool& isProbe) {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  VehicleHealth& entry = findOrCreate(ip);
+  bool allowed = entry.breaker.allowRequest(millis());
+  isProbe = allowed && entry.breaker.getState() == BREAKER_HALF_OPEN;
+  xSemaphoreGive(mutex);
+  return allowed;
+}
+
+void VehicleHealthTable::recordSuccess(const String& ip, float voltage) {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  VehicleHealth& entry = findOrCreate(ip);
+  if (entry.breaker.getState() != BREAKER_CLOSED) {
+    Serial.println("Vehicle reachable again: " + ip);
+  }
+  entry.breaker.recordSuccess();
+  if (voltage > 0) {
+    entry.lastVoltage = voltage;
+    entry.lastVoltageAt = millis();
+  }
+  xSemaphoreGive(mutex);
+}
+
+void VehicleHealthTable::recordFailure(const String& ip) {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  VehicleHealth& entry = findOrCreate(ip);
+  unsigned long now = millis();
+  entry.breaker.recordFailure(now);
+  if (entry.breaker.getState() == BREAKER_OPEN) {
+    Serial.printf("Vehicle %s unreachable, next probe in %lu s\n",
+                  ip.c_str(), entry.breaker.remainingOpen(now) / 1000);
+  }
+  xSemaphoreGive(mutex);
+}
+
+void VehicleHealthTable::restoreLastVoltage(const String& ip, float voltage) {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  VehicleHealth& entry = findOrCreate(ip);
+  if (voltage > 0 && entry.lastVoltage <= 0) {
+    entry.lastVoltage = voltage;
+    entry.lastVoltageAt = millis();
+  }
+  xSemaphoreGive(mutex);
+}
+
+void VehicleHealthTable::saveBreaker(const String& ip, uint64_t uptimeMs, BreakerRecord& record) {
+  CircuitBreaker closed;
+  unsigned long now = millis();
+  
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  const CircuitBreaker* breaker = &closed;
+  for (int i = 0; i < entryCount; i++) {
+    if (entries[i].ip == ip) {
+      breaker = &entries[i].breaker;
+      break;
+    }
+  }
+  breaker->save(record, now, uptimeMs);
+  xSemaphoreGive(mutex);
+}
+
+void VehicleHealthTable::restoreBreaker(const String& ip, uint64_t uptimeMs, const BreakerRecord& record) {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  VehicleHealth& entry = findOrCreate(ip);
+  entry.breaker.restore(record, millis(), uptimeMs);
+  xSemaphoreGive(mutex);
+}
+
+bool VehicleHealthTable::getLastVoltage(const String& ip, float& voltage) {
+  bool found = false;
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  for (int i = 0; i < entryCount; i++) {
+    if (entries[i].ip == ip && entries[i].lastVoltage > 0) {
+      voltage = entries[i].lastVoltage;
+      found = true;
+      break;
+    }
+  }
+  xSemaphoreGive(mutex);
+  return found;
+}
+
+int VehicleHealthTable::getEntries(VehicleHealth out[], int maxCount) {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  int count = min(entryCount, maxCount);
+  for (int i = 0; i < count; i++) {
+    out[i] = entries[i];
+  }
+  xSemaphoreGive(mutex);
+  return count;
+}
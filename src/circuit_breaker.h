@@ -0,0 +1,120 @@
+/**
+  ******************************************************************************
+  * @file    circuit_breaker.h
+  * @brief   Per-vehicle circuit breaker keeping unreachable vehicles off the network path
+  ******************************************************************************
+*/
+
+#ifndef CIRCUIT_BREAKER_H
+#define CIRCUIT_BREAKER_H
+
+#include <Arduino.h>
+#include "telemetry.h"
+
+// Consecutive failed requests that open the breaker
+#ifndef BREAKER_FAILURE_THRESHOLD
+#define BREAKER_FAILURE_THRESHOLD 2
+#endif
+
+// First open period, doubled after every failed probe
+#ifndef BREAKER_BASE_OPEN_MS
+#define BREAKER_BASE_OPEN_MS 60000
+#endif
+
+#ifndef BREAKER_MAX_OPEN_MS
+#define BREAKER_MAX_OPEN_MS (15UL * 60UL * 1000UL)
+#endif
+
+// Breaker kept in RTC memory across deep sleep, plain data
+struct BreakerRecord {
+  uint8_t consecutiveFailures;
+  uint8_t trips;
+  bool open;            // Open or half-open when saved
+  uint64_t openUntilMs; // End of the open period on the rtcStateUptimeMs() clock
+};
+
+enum BreakerState : uint8_t {
+  BREAKER_CLOSED,    // Requests flow normally
+  BREAKER_OPEN,      // Vehicle considered unreachable, no requests
+  BREAKER_HALF_OPEN  // One probe request allowed to test the vehicle
+};
+
+// Closed/open/half-open state machine with exponential backoff of the open period
+class CircuitBreaker {
+private:
+  BreakerState state;
+  uint8_t consecutiveFailures;
+  uint8_t trips;            // Opens since the last success, drives the backoff
+  unsigned long openedAt;
+  unsigned long openDuration;
+  
+  void trip(unsigned long now);
+
+public:
+  CircuitBreaker() : state(BREAKER_CLOSED), consecutiveFailures(0), trips(0), openedAt(0), openDuration(0) {}
+  
+  /**
+   * Ask for permission to contact the vehicle.
+   * An open breaker whose period elapsed moves to half-open and allows one probe.
+   */
+  bool allowRequest(unsigned long now);
+  
+  void recordSuccess();
+  void recordFailure(unsigned long now);
+  
+  BreakerState getState() const { return state; }
+  uint8_t getTrips() const { return trips; }
+  
+  // Time left before the next probe, 0 unless open
+  unsigned long remainingOpen(unsigned long now) const;
+  
+  // Copy to and from RTC memory; now is millis(), uptimeMs the same instant on the RTC clock
+  void save(BreakerRecord& record, unsigned long now, uint64_t uptimeMs) const;
+  void restore(const BreakerRecord& record, unsigned long now, uint64_t uptimeMs);
+};
+
+// Breaker and last known voltage of one vehicle
+struct VehicleHealth {
+  String ip;
+  CircuitBreaker breaker;
+  float lastVoltage;          // Volts, <= 0 if never read
+  unsigned long lastVoltageAt;
+};
+
+// Thread-safe breaker table shared by the fetcher and diagnostics
+class VehicleHealthTable {
+private:
+  static VehicleHealthTable* instance;
+  VehicleHealth entries[MAX_VEHICLES];
+  int entryCount;
+  SemaphoreHandle_t mutex;
+  
+  VehicleHealthTable();
+  VehicleHealth& findOrCreate(const String& ip);
+
+public:
+  static VehicleHealthTable* getInstance();
+  
+  // Breaker decision for a vehicle, see CircuitBreaker::allowRequest()
+  bool allowRequest(const String& ip, bool& isProbe);
+  
+  void recordSuccess(const String& ip, float voltage);
+  void recordFailure(const String& ip);
+  
+  // Last voltage that was read from the vehicle, false if none
+  bool getLastVoltage(const String& ip, float& voltage);
+  
+  // Restore a last known voltage remembered across deep sleep
+  void restoreLastVoltage(const String& ip, float voltage);
+  
+  // Copy a vehicle's breaker for RTC memory, closed if the vehicle is unknown
+  void saveBreaker(const String& ip, uint64_t uptimeMs, BreakerRecord& record);
+  
+  // Restore a breaker saved before deep sleep, so failures keep counting across wakes
+  void restoreBreaker(const String& ip, uint64_t uptimeMs, const BreakerRecord& record);
+  
+  // Copy the table for diagnostics
+  int getEntries(VehicleHealth out[], int maxCount);
+};
+
+#endif // CIRCUIT_BREAKER_H
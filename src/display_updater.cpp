@@ -0,0 +1,355 @@
+/**
+  ******************************************************************************
+  * @file    display_updater.cpp
+  * @brief   Pushes rendered frames to the e-paper panel, skipping frames it already shows
+  ******************************************************************************
+*/
+
+#include "display_updater.h"
+#include "rtc_state.h"
+#include "power_manager.h"
+#include "../hal/esp32/displays/LGFX_WATCHY_EPAPER.hpp"
+
+#define FNV_OFFSET 2166136261UL
+#define FNV_PRIME 16777619UL
+
+// Initialize static instance
+DisplayUpdater* DisplayUpdater::instance = nullptr;
+
+DisplayUpdater::DisplayUpdater()
+  : renderedTop(-1), render(nullptr), context(nullptr), layoutHash(0), layoutCount(0),
+    panelInSync(false), task(nullptr), busyReleased(nullptr), updating(false),
+    pendingRender(nullptr), pendingContext(nullptr), pendingRegions(nullptr), pendingCount(0) {
+}
+
+DisplayUpdater* DisplayUpdater::getInstance() {
+  if (instance == nullptr) {
+    instance = new DisplayUpdater();
+  }
+  return instance;
+}
+
+void DisplayUpdater::begin() {
+  if (task != nullptr) {
+    return;
+  }
+  
+  // BUSY goes low when the panel finished; GxEPD2 calls waitWhileBusy() instead of spinning on delay(1)
+  busyReleased = xSemaphoreCreateBinary();
+  attachInterrupt(digitalPinToInterrupt(DISPLAY_BUSY), busyIsr, FALLING);
+  panel.setBusyCallback(waitWhileBusy, this);
+  
+  xTaskCreate(displayTask, "display", 4096, this, 1, &task);
+}
+
+// Without an initial refresh GxEPD2 keeps the controller RAM, which still holds the frame
+// the RTC state describes; the ghosting accounting continues from before the sleep
+void DisplayUpdater::resume() {
+  if (rtcState.panelHash == 0 || rtcState.panelRegionCount > DISPLAY_MAX_REGIONS) {
+    return;
+  }
+  layoutHash = rtcState.panelLayoutHash;
+  layoutCount = rtcState.panelRegionCount;
+  for (int i = 0; i < layoutCount; i++) {
+    regionHash[i] = rtcState.panelRegionHash[i];
+    regionBlack[i] = rtcState.panelRegionBlack[i];
+  }
+  scheduler = rtcState.panelScheduler;
+  panelInSync = true;
+  Serial.printf("Panel resumed, %u partial updates since the last full refresh\n", scheduler.partialsSinceFull);
+}
+
+void DisplayUpdater::saveToRtc() {
+  rtcState.panelLayoutHash = layoutHash;
+  rtcState.panelRegionCount = layoutCount;
+  for (int i = 0; i < layoutCount; i++) {
+    rtcState.panelRegionHash[i] = regionHash[i];
+    rtcState.panelRegionBlack[i] = regionBlack[i];
+  }
+  rtcState.panelScheduler = scheduler;
+}
+
+void IRAM_ATTR DisplayUpdater::busyIsr() {
+  BaseType_t woken = pdFALSE;
+  xSemaphoreGiveFromISR(instance->busyReleased, &woken);
+  if (woken) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+// Called by GxEPD2 for as long as BUSY is asserted; blocking here lets the CPU idle.
+// The render lock is dropped meanwhile so the CPU may light sleep, the poll timeout
+// still wakes it should the BUSY edge be missed while asleep.
+void DisplayUpdater::waitWhileBusy(const void* param) {
+  const DisplayUpdater* self = (const DisplayUpdater*)param;
+  powerUnlock(POWER_RENDER);
+  powerStateEnter(ENERGY_PANEL_BUSY);
+  powerStateLeave(ENERGY_RENDER);
+  xSemaphoreTake(self->busyReleased, pdMS_TO_TICKS(DISPLAY_BUSY_POLL_MS));
+  powerStateEnter(ENERGY_RENDER);
+  powerStateLeave(ENERGY_PANEL_BUSY);
+  powerLock(POWER_RENDER);
+}
+
+void DisplayUpdater::displayTask(void* param) {
+  DisplayUpdater* self = (DisplayUpdater*)param;
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    powerLock(POWER_RENDER);
+    powerStateEnter(ENERGY_RENDER);
+    self->update(self->pendingRender, self->pendingContext, self->pendingRegions, self->pendingCount);
+    powerStateLeave(ENERGY_RENDER);
+    powerUnlock(POWER_RENDER);
+    self->updating = false;
+  }
+}
+
+void DisplayUpdater::waitUntilIdle() {
+  while (updating) {
+    delay(5);
+  }
+}
+
+// Partial windows must start and end on byte boundaries, and the regions must tile the frame
+bool DisplayUpdater::layoutUsable(const DisplayRegion regions[], int count) {
+  if (regions == nullptr || count <= 0 || count > DISPLAY_MAX_REGIONS) {
+    return false;
+  }
+  
+  long area = 0;
+  for (int i = 0; i < count; i++) {
+    const DisplayRegion& region = regions[i];
+    if (region.x % 8 != 0 || region.w % 8 != 0 || region.x < 0 || region.y < 0 ||
+        region.x + region.w > FRAME_WIDTH || region.y + region.h > FRAME_HEIGHT) {
+      Serial.printf("Display region %s is not byte aligned or out of bounds\n", region.name);
+      return false;
+    }
+    area += (long)region.w * region.h;
+  }
+  
+  if (area != (long)FRAME_WIDTH * FRAME_HEIGHT) {
+    Serial.println("Display regions do not tile the frame");
+    return false;
+  }
+  return true;
+}
+
+// Identifies a layout across deep sleep, where only the rectangles are known
+static uint32_t layoutSignature(const DisplayRegion regions[], int count) {
+  uint32_t hash = FNV_OFFSET;
+  for (int i = 0; i < count; i++) {
+    const int16_t values[] = { regions[i].x, regions[i].y, regions[i].w, regions[i].h };
+    for (int16_t value : values) {
+      hash = (hash ^ (uint16_t)value) * FNV_PRIME;
+    }
+  }
+  return count > 0 ? hash : 0;
+}
+
+// With a single page the frame is drawn once per update, with several once per page and pass
+void DisplayUpdater::renderPage(RenderFunction render, const void* context, int16_t top) {
+  if (top == renderedTop && FRAME_PAGE_COUNT == 1) {
+    return;
+  }
+  frame.setPage(top);
+  render(frame, context);
+  renderedTop = top;
+}
+
+void DisplayUpdater::fullUpdate(RenderFunction render, const void* context) {
+  // Same sequence as GxEPD2_BW for a full window: the second pass primes the
+  // controller's previous-image RAM for later differential updates
+  for (int16_t top = 0; top < FRAME_HEIGHT; top += FRAME_PAGE_HEIGHT) {
+    renderPage(render, context, top);
+    panel.writeImageForFullRefresh(frame.getBuffer(), 0, top, FRAME_WIDTH, frame.getPageHeight());
+  }
+  panel.refresh(false);
+  for (int16_t top = 0; top < FRAME_HEIGHT; top += FRAME_PAGE_HEIGHT) {
+    renderPage(render, context, top);
+    panel.writeImageAgain(frame.getBuffer(), 0, top, FRAME_WIDTH, frame.getPageHeight());
+  }
+  refreshSchedulerReset(scheduler);
+  rtcState.panelRefreshes++;
+}
+
+bool DisplayUpdater::present(RenderFunction render, const void* context,
+                             const DisplayRegion regions[], int count) {
+  if (task == nullptr) {
+    powerLock(POWER_RENDER);
+    powerStateEnter(ENERGY_RENDER);
+    bool updated = update(render, context, regions, count);
+    powerStateLeave(ENERGY_RENDER);
+    powerUnlock(POWER_RENDER);
+    return updated;
+  }
+  
+  waitUntilIdle();
+  pendingRender = render;
+  pendingContext = context;
+  pendingRegions = regions;
+  pendingCount = count;
+  updating = true;
+  xTaskNotifyGive(task);
+  return true;
+}
+
+bool DisplayUpdater::update(RenderFunction render, const void* context,
+                            const DisplayRegion regions[], int count) {
+  unsigned long startTime = millis();
+  bool usable = layoutUsable(regions, count);
+  if (!usable) {
+    count = 0;
+  }
+  
+  // First pass: hash the frame and each region, and count black pixels, page by page
+  uint32_t hash = FNV_OFFSET;
+  uint32_t hashes[DISPLAY_MAX_REGIONS];
+  uint16_t black[DISPLAY_MAX_REGIONS];
+  for (int i = 0; i < count; i++) {
+    hashes[i] = FNV_OFFSET;
+    black[i] = regions[i].w * regions[i].h;
+  }
+  renderedTop = -1;
+  for (int16_t top = 0; top < FRAME_HEIGHT; top += FRAME_PAGE_HEIGHT) {
+    renderPage(render, context, top);
+    for (int16_t y = top; y < top + frame.getPageHeight(); y++) {
+      const uint8_t* row = frame.getRow(y);
+      for (int i = 0; i < FRAME_BYTES_PER_ROW; i++) {
+        hash = (hash ^ row[i]) * FNV_PRIME;
+      }
+      for (int i = 0; i < count; i++) {
+        const DisplayRegion& region = regions[i];
+        if (y < region.y || y >= region.y + region.h) {
+          continue;
+        }
+        for (int j = region.x / 8; j < (region.x + region.w) / 8; j++) {
+          hashes[i] = (hashes[i] ^ row[j]) * FNV_PRIME;
+          black[i] -= __builtin_popcount(row[j]);
+        }
+      }
+    }
+  }
+  
+  if (hash == rtcState.panelHash) {
+    // The same frame, so this screen can redraw the panel before a sleep
+    this->render = render;
+    this->context = context;
+    rtcState.panelSkips++;
+    Serial.println("Frame unchanged, panel not refreshed");
+    return false;
+  }
+  
+  uint32_t signature = usable ? layoutSignature(regions, count) : 0;
+  bool partial = usable && panelInSync && signature == layoutHash && count == layoutCount;
+  
+  // Estimate how many pixels each dirty region would flip
+  uint32_t changedPixels[DISPLAY_MAX_REGIONS];
+  bool dirty[DISPLAY_MAX_REGIONS];
+  int dirtyCount = 0;
+  for (int i = 0; i < count; i++) {
+    dirty[i] = partial && hashes[i] != regionHash[i];
+    // Upper bound without the old pixels: everything black before or after may have flipped
+    changedPixels[i] = dirty[i] ? regionBlack[i] + black[i] : 0;
+    if (dirty[i]) {
+      dirtyCount++;
+    }
+  }
+  
+  // The frame changed but no region did: the change is outside the display list
+  if (partial && dirtyCount == 0) {
+    Serial.println("Change outside the regions, full refresh");
+    partial = false;
+  }
+  
+  if (partial && refreshSchedulerWantsFull(scheduler, changedPixels, count)) {
+    Serial.printf("Full refresh to clear ghosting after %u partial updates\n", scheduler.partialsSinceFull);
+    partial = false;
+  }
+  
+  if (partial) {
+    int16_t left = FRAME_WIDTH, top = FRAME_HEIGHT, right = 0, bottom = 0;
+    for (int i = 0; i < count; i++) {
+      if (dirty[i]) {
+        left = min(left, regions[i].x);
+        top = min(top, regions[i].y);
+        right = max(right, (int16_t)(regions[i].x + regions[i].w));
+        bottom = max(bottom, (int16_t)(regions[i].y + regions[i].h));
+      }
+    }
+  
+    // Only the changed rectangles go over SPI, one differential refresh over all of them,
+    // then a second pass syncs the previous-image RAM
+    for (int pass = 0; pass < 2; pass++) {
+      for (int16_t pageTop = 0; pageTop < FRAME_HEIGHT; pageTop += FRAME_PAGE_HEIGHT) {
+        int16_t pageBottom = pageTop + frame.getPageHeight();
+        bool rendered = false;
+        for (int i = 0; i < count; i++) {
+          const DisplayRegion& region = regions[i];
+          int16_t y0 = max(region.y, pageTop);
+          int16_t y1 = min((int16_t)(region.y + region.h), pageBottom);
+          if (!dirty[i] || y0 >= y1) {
+            continue;
+          }
+          if (!rendered) {
+            renderPage(render, context, pageTop);
+            rendered = true;
+          }
+          if (pass == 0) {
+            panel.writeImagePart(frame.getBuffer(), region.x, y0 - pageTop, FRAME_WIDTH, frame.getPageHeight(),
+                                 region.x, y0, region.w, y1 - y0);
+          } else {
+            panel.writeImagePartAgain(frame.getBuffer(), region.x, y0 - pageTop, FRAME_WIDTH, frame.getPageHeight(),
+                                      region.x, y0, region.w, y1 - y0);
+          }
+        }
+      }
+      if (pass == 0) {
+        panel.refresh(left, top, right - left, bottom - top);
+      }
+    }
+    refreshSchedulerRecordPartial(scheduler, changedPixels, count);
+    rtcState.panelPartials++;
+  } else {
+    fullUpdate(render, context);
+  }
+  panel.powerOff();
+  
+  // Remember the screen and the display list of what is on the panel now
+  this->render = render;
+  this->context = context;
+  layoutHash = signature;
+  layoutCount = count;
+  for (int i = 0; i < count; i++) {
+    regionHash[i] = hashes[i];
+    regionBlack[i] = black[i];
+  }
+  panelInSync = true;
+  rtcState.panelHash = hash;
+  saveToRtc();
+  
+  if (partial) {
+    Serial.printf("Partial update of %d regions in %lu ms\n", dirtyCount, millis() - startTime);
+  } else {
+    Serial.printf("Panel refreshed in %lu ms\n", millis() - startTime);
+  }
+  return true;
+}
+
+void DisplayUpdater::prepareForSleep(uint64_t sleepMs) {
+  waitUntilIdle();
+  if (sleepMs < DISPLAY_CLEAN_SLEEP_MS) {
+    return;
+  }
+  
+  // The screen on the panel is redrawn from its still valid context
+  if (panelInSync && render != nullptr && refreshSchedulerHasGhosting(scheduler)) {
+    Serial.println("Full refresh before deep sleep to clear ghosting");
+    powerLock(POWER_RENDER);
+    powerStateEnter(ENERGY_RENDER);
+    fullUpdate(render, context);
+    panel.powerOff();
+    saveToRtc();
+    powerStateLeave(ENERGY_RENDER);
+    powerUnlock(POWER_RENDER);
+  }
+}
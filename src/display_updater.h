@@ -0,0 +1,121 @@
+/**
+  ******************************************************************************
+  * @file    display_updater.h
+  * @brief   Pushes rendered frames to the e-paper panel, skipping frames it already shows
+  ******************************************************************************
+*/
+
+#ifndef DISPLAY_UPDATER_H
+#define DISPLAY_UPDATER_H
+
+#include <Arduino.h>
+#include "frame_buffer.h"
+#include "refresh_scheduler.h"
+
+// Most regions a screen layout may have
+#ifndef DISPLAY_MAX_REGIONS
+#define DISPLAY_MAX_REGIONS REFRESH_MAX_REGIONS
+#endif
+
+/**
+ * One independently updated rectangle of a screen layout.
+ * The regions of a layout must tile the whole frame without overlapping,
+ * so that every changed pixel belongs to exactly one region.
+ */
+struct DisplayRegion {
+  const char* name;
+  int16_t x;
+  int16_t y;
+  int16_t w;
+  int16_t h;
+};
+
+// Deep sleeps at least this long start from a full refresh, shorter ones leave the
+// ghosting of partial updates to the next wake, which keeps accounting it
+#ifndef DISPLAY_CLEAN_SLEEP_MS
+#define DISPLAY_CLEAN_SLEEP_MS (20UL * 60UL * 1000UL)
+#endif
+
+// Longest single wait for the BUSY interrupt before the pin is checked again
+#ifndef DISPLAY_BUSY_POLL_MS
+#define DISPLAY_BUSY_POLL_MS 50
+#endif
+
+// Owns the frame buffer and decides what reaches the panel
+class DisplayUpdater {
+private:
+  static DisplayUpdater* instance;
+  FrameBuffer frame;
+  int16_t renderedTop; // Page the frame buffer holds, -1 if none
+  
+  // Screen on the panel, and its display list
+  RenderFunction render;
+  const void* context;
+  uint32_t layoutHash; // Region rectangles, 0 without a layout
+  int layoutCount;
+  uint32_t regionHash[DISPLAY_MAX_REGIONS];
+  uint16_t regionBlack[DISPLAY_MAX_REGIONS]; // Black pixels per region, to estimate changed pixels
+  bool panelInSync; // The controller's RAM holds the frame on the panel, so partial updates are possible
+  RefreshSchedulerState scheduler;
+  
+  // Panel updates run on their own task, which sleeps on the BUSY interrupt
+  TaskHandle_t task;
+  SemaphoreHandle_t busyReleased;
+  volatile bool updating;
+  RenderFunction pendingRender;
+  const void* pendingContext;
+  const DisplayRegion* pendingRegions;
+  int pendingCount;
+  
+  DisplayUpdater();
+  static void displayTask(void* param);
+  static void busyIsr();
+  static void waitWhileBusy(const void* param);
+  bool update(RenderFunction render, const void* context, const DisplayRegion regions[], int count);
+  bool layoutUsable(const DisplayRegion regions[], int count);
+  void renderPage(RenderFunction render, const void* context, int16_t top);
+  void fullUpdate(RenderFunction render, const void* context);
+  void saveToRtc();
+
+public:
+  static DisplayUpdater* getInstance();
+  
+  // Start the update task and hook the BUSY pin; without it updates are synchronous
+  void begin();
+  
+  /**
+   * Continue from the frame recorded in RTC memory after a deep sleep wake, so the first
+   * update can be partial. Only valid when the panel was initialized without its initial
+   * full refresh, its controller RAM then still holds that frame. Call after rtcStateInit().
+   */
+  void resume();
+  
+  // An update is in flight
+  bool isBusy() const { return updating; }
+  
+  // Block until the panel update in flight finished
+  void waitUntilIdle();
+  
+  /**
+   * Bring the panel up to date with the screen drawn by render from context.
+   * Nothing is sent when the hash of the frame on the panel (kept in RTC memory,
+   * so it holds across deep sleep) matches.
+   * With a layout, only the regions whose pixels changed are sent, in one partial
+   * update of their bounding box; the first update after power-on and any change
+   * of layout are full updates, a wake after resume() is not. Without a layout every
+   * update is full.
+   * Once partial updates have accumulated enough ghosting the update is full as well.
+   * After begin() this only hands the screen to the update task and returns at once.
+   * context must stay valid and unchanged until the next present().
+   * @return true if the panel was refreshed, or the update was handed to the task
+   */
+  bool present(RenderFunction render, const void* context,
+               const DisplayRegion regions[] = nullptr, int count = 0);
+  
+  // Finish the update in flight and, before a sleep of DISPLAY_CLEAN_SLEEP_MS or longer, clear accumulated ghosting
+  void prepareForSleep(uint64_t sleepMs);
+  
+  const RefreshSchedulerState& getScheduler() const { return scheduler; }
+};
+
+#endif // DISPLAY_UPDATER_H
@@ -0,0 +1,69 @@
+/**
+  ******************************************************************************
+  * @file    draw_schedule.cpp
+  * @brief   When the always-on loop redraws the status screen and samples the battery
+  ******************************************************************************
+*/
+
+#include "draw_schedule.h"
+
+void drawScheduleBegin(DrawSchedule& schedule, uint32_t nowMs) {
+  schedule.firstDrawPending = true;
+  schedule.servicesStartedMs = nowMs;
+  schedule.firstWaitMs = 0;
+  schedule.lastDrawMs = nowMs;
+  schedule.lastBatteryMs = nowMs;
+}
+
+void drawScheduleServicesStarted(DrawSchedule& schedule, uint32_t nowMs, uint32_t firstWaitMs) {
+  schedule.firstDrawPending = true;
+  schedule.servicesStartedMs = nowMs;
+  schedule.firstWaitMs = firstWaitMs;
+}
+
+bool drawScheduleDue(DrawSchedule& schedule, uint32_t nowMs, bool discoveryDone, bool& sampleBattery) {
+  sampleBattery = false;
+  
+  // Give discovery one query to fill the table before the first screen
+  if (schedule.firstDrawPending) {
+    if (discoveryDone || nowMs - schedule.servicesStartedMs >= schedule.firstWaitMs) {
+      schedule.firstDrawPending = false;
+      schedule.lastDrawMs = nowMs;
+      return true;
+    }
+    return false;
+  }
+  
+  // The battery timer only runs out while the draw timer has not, as it always did
+  if (nowMs - schedule.lastDrawMs >= DRAW_INTERVAL_MS) {
+    schedule.lastDrawMs = nowMs;
+    return true;
+  }
+  if (nowMs - schedule.lastBatteryMs >= DRAW_BATTERY_INTERVAL_MS) {
+    sampleBattery = true;
+    schedule.lastBatteryMs = nowMs;
+    schedule.lastDrawMs = nowMs;
+    return true;
+  }
+  return false;
+}
+
+static uint32_t remainingMs(uint32_t sinceMs, uint32_t intervalMs) {
+  return sinceMs < intervalMs ? intervalMs - sinceMs : 0;
+}
+
+uint32_t drawScheduleIdleMs(const DrawSchedule& schedule, uint32_t nowMs, uint32_t maxMs) {
+  if (schedule.firstDrawPending) {
+    return 0;
+  }
+  uint32_t idleMs = maxMs;
+  uint32_t untilDraw = remainingMs(nowMs - schedule.lastDrawMs, DRAW_INTERVAL_MS);
+  uint32_t untilBattery = remainingMs(nowMs - schedule.lastBatteryMs, DRAW_BATTERY_INTERVAL_MS);
+  if (untilDraw < idleMs) {
+    idleMs = untilDraw;
+  }
+  if (untilBattery < idleMs) {
+    idleMs = untilBattery;
+  }
+  return idleMs;
+}
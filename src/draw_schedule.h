@@ -0,0 +1,53 @@
+/**
+  ******************************************************************************
+  * @file    draw_schedule.h
+  * @brief   When the always-on loop redraws the status screen and samples the battery
+  ******************************************************************************
+*/
+
+#ifndef DRAW_SCHEDULE_H
+#define DRAW_SCHEDULE_H
+
+// Plain C/C++ only, so the schedule can run in host-side simulations
+#include <stdint.h>
+
+// Redraw at least this often
+#ifndef DRAW_INTERVAL_MS
+#define DRAW_INTERVAL_MS 60000UL
+#endif
+
+// Battery sampling period, a new sample also redraws
+#ifndef DRAW_BATTERY_INTERVAL_MS
+#define DRAW_BATTERY_INTERVAL_MS 60000UL
+#endif
+
+// Timers of the loop, times are millis()
+struct DrawSchedule {
+  bool firstDrawPending;
+  uint32_t servicesStartedMs;
+  uint32_t firstWaitMs;  // How long the first draw waits for discovery before showing what is known
+  uint32_t lastDrawMs;
+  uint32_t lastBatteryMs;
+};
+
+// Battery sampled at nowMs, before the network is up
+void drawScheduleBegin(DrawSchedule& schedule, uint32_t nowMs);
+
+// Network services started at nowMs, the first draw waits up to firstWaitMs for discovery
+void drawScheduleServicesStarted(DrawSchedule& schedule, uint32_t nowMs, uint32_t firstWaitMs);
+
+/**
+ * Whether loop() should draw at nowMs, call only while the panel is idle.
+ * Sets sampleBattery when the battery is due for a sample, which is also a
+ * reason to draw; the draw is then assumed to happen and the timers restart.
+ * @param discoveryDone the first discovery query finished
+ */
+bool drawScheduleDue(DrawSchedule& schedule, uint32_t nowMs, bool discoveryDone, bool& sampleBattery);
+
+/**
+ * How long loop() may wait at nowMs before a timer of drawScheduleDue() runs out, at most maxMs.
+ * 0 while the first draw waits for discovery, which may finish at any time.
+ */
+uint32_t drawScheduleIdleMs(const DrawSchedule& schedule, uint32_t nowMs, uint32_t maxMs);
+
+#endif // DRAW_SCHEDULE_H
@@ -0,0 +1,107 @@
+/**
+  ******************************************************************************
+  * @file    energy_model.cpp
+  * @brief   Time per power state and the charge it is estimated to have drawn
+  ******************************************************************************
+*/
+
+#include "energy_model.h"
+#include <string.h>
+
+static const uint32_t CURRENT_UA[ENERGY_STATE_COUNT] = {
+  ENERGY_CURRENT_BOOT_UA,
+  ENERGY_CURRENT_SCAN_UA,
+  ENERGY_CURRENT_ASSOCIATE_UA,
+  ENERGY_CURRENT_DHCP_UA,
+  ENERGY_CURRENT_MDNS_UA,
+  ENERGY_CURRENT_HTTP_UA,
+  ENERGY_CURRENT_RENDER_UA,
+  ENERGY_CURRENT_PANEL_BUSY_UA,
+  ENERGY_CURRENT_IDLE_UA,
+  ENERGY_CURRENT_SLEEP_UA
+};
+
+static const char* STATE_NAMES[ENERGY_STATE_COUNT] = {
+  "boot", "scan", "associate", "DHCP", "mDNS", "HTTP", "render", "panel busy", "idle", "sleep"
+};
+
+void energyCountersReset(EnergyCounters& counters) {
+  memset(&counters, 0, sizeof(counters));
+}
+
+void energyTrackerBegin(EnergyTracker& tracker, uint64_t nowMs) {
+  memset(tracker.active, 0, sizeof(tracker.active));
+  tracker.charged = ENERGY_IDLE;
+  tracker.chargedSince = nowMs;
+}
+
+// First active state in enum order, idle if none
+static uint8_t chargedState(const EnergyTracker& tracker) {
+  for (int i = 0; i < ENERGY_STATE_COUNT; i++) {
+    if (tracker.active[i] > 0) {
+      return i;
+    }
+  }
+  return ENERGY_IDLE;
+}
+
+void energyTrackerFlush(EnergyTracker& tracker, EnergyCounters& counters, uint64_t nowMs) {
+  if (nowMs > tracker.chargedSince) {
+    counters.stateMs[tracker.charged] += nowMs - tracker.chargedSince;
+  }
+  tracker.chargedSince = nowMs;
+}
+
+void energyTrackerEnter(EnergyTracker& tracker, EnergyCounters& counters, EnergyState state, uint64_t nowMs) {
+  energyTrackerFlush(tracker, counters, nowMs);
+  if (tracker.active[state] < UINT8_MAX) {
+    tracker.active[state]++;
+  }
+  tracker.charged = chargedState(tracker);
+}
+
+void energyTrackerLeave(EnergyTracker& tracker, EnergyCounters& counters, EnergyState state, uint64_t nowMs) {
+  energyTrackerFlush(tracker, counters, nowMs);
+  if (tracker.active[state] > 0) {
+    tracker.active[state]--;
+  }
+  tracker.charged = chargedState(tracker);
+}
+
+void energyCharge(EnergyCounters& counters, EnergyState state, uint64_t ms) {
+  counters.stateMs[state] += ms;
+}
+
+uint32_t energyCurrentUa(EnergyState state) {
+  return CURRENT_UA[state];
+}
+
+double energyIdleCurrentUa(double wakesPerSecond) {
+  // uC per wake * wakes per second = uA
+  return ENERGY_CURRENT_IDLE_FLOOR_UA + ENERGY_IDLE_WAKE_CHARGE_UC * wakesPerSecond;
+}
+
+double energyMilliampHours(const EnergyCounters& counters, EnergyState state) {
+  // ms * uA = 3.6e9 mAh
+  return (double)counters.stateMs[state] * CURRENT_UA[state] / 3.6e9;
+}
+
+double energyTotalMilliampHours(const EnergyCounters& counters) {
+  double total = 0;
+  for (int i = 0; i < ENERGY_STATE_COUNT; i++) {
+    total += energyMilliampHours(counters, (EnergyState)i);
+  }
+  return total;
+}
+
+uint64_t energyTotalMs(const EnergyCounters& counters) {
+  uint64_t total = 0;
+  for (int i = 0; i < ENERGY_STATE_COUNT; i++) {
+    total += counters.stateMs[i];
+  }
+  return total;
+}
+
+const char* energyStateName(EnergyState state) {
+  return state < ENERGY_STATE_COUNT ? STATE_NAMES[state] : "?";
+}
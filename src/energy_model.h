@@ -0,0 +1,135 @@
+/**
+  ******************************************************************************
+  * @file    energy_model.h
+  * @brief   Time per power state and the charge it is estimated to have drawn
+  ******************************************************************************
+*/
+
+#ifndef ENERGY_MODEL_H
+#define ENERGY_MODEL_H
+
+// Plain C/C++ only, so the model can run in host-side simulations
+#include <stdint.h>
+
+// Average battery current per state in microamps, whole watch. Override with
+// measurements of the actual hardware, the defaults are datasheet ballparks.
+#ifndef ENERGY_CURRENT_BOOT_UA
+#define ENERGY_CURRENT_BOOT_UA 50000UL
+#endif
+
+#ifndef ENERGY_CURRENT_SCAN_UA
+#define ENERGY_CURRENT_SCAN_UA 115000UL
+#endif
+
+#ifndef ENERGY_CURRENT_ASSOCIATE_UA
+#define ENERGY_CURRENT_ASSOCIATE_UA 120000UL
+#endif
+
+#ifndef ENERGY_CURRENT_DHCP_UA
+#define ENERGY_CURRENT_DHCP_UA 100000UL
+#endif
+
+#ifndef ENERGY_CURRENT_MDNS_UA
+#define ENERGY_CURRENT_MDNS_UA 100000UL
+#endif
+
+#ifndef ENERGY_CURRENT_HTTP_UA
+#define ENERGY_CURRENT_HTTP_UA 110000UL
+#endif
+
+#ifndef ENERGY_CURRENT_RENDER_UA
+#define ENERGY_CURRENT_RENDER_UA 50000UL
+#endif
+
+#ifndef ENERGY_CURRENT_PANEL_BUSY_UA
+#define ENERGY_CURRENT_PANEL_BUSY_UA 20000UL
+#endif
+
+// Idle is automatic light sleep with the radio in modem sleep, plus the charge of
+// every CPU wake for a timer or a poll. The default rate is loop() waiting
+// LOOP_IDLE_MAX_MS and the MAVLink UDP task's heartbeat; the 10 ms polls of both
+// made about 200 wakes per second, or 15 mA.
+#ifndef ENERGY_CURRENT_IDLE_FLOOR_UA
+#define ENERGY_CURRENT_IDLE_FLOOR_UA 3000UL
+#endif
+
+#ifndef ENERGY_IDLE_WAKE_CHARGE_UC
+#define ENERGY_IDLE_WAKE_CHARGE_UC 60UL
+#endif
+
+#ifndef ENERGY_IDLE_WAKES_PER_S
+#define ENERGY_IDLE_WAKES_PER_S 6UL
+#endif
+
+#ifndef ENERGY_CURRENT_IDLE_UA
+#define ENERGY_CURRENT_IDLE_UA (ENERGY_CURRENT_IDLE_FLOOR_UA + ENERGY_IDLE_WAKE_CHARGE_UC * ENERGY_IDLE_WAKES_PER_S)
+#endif
+
+#ifndef ENERGY_CURRENT_SLEEP_UA
+#define ENERGY_CURRENT_SLEEP_UA 150UL
+#endif
+
+/**
+ * What the watch is doing. States overlap across tasks, e.g. a fetch while the
+ * panel is busy; the time then goes to the active state first in this order,
+ * which is roughly the one drawing the most current. IDLE is charged whenever
+ * no other state is active.
+ */
+enum EnergyState : uint8_t {
+  ENERGY_BOOT,       // setup() until the WiFi connection starts
+  ENERGY_SCAN,       // WiFi scan
+  ENERGY_ASSOCIATE,  // WiFi association, including directed fast connects
+  ENERGY_DHCP,       // Waiting for an IP lease
+  ENERGY_MDNS,       // Vehicle discovery query
+  ENERGY_HTTP,       // Fetching vehicle names and voltages
+  ENERGY_RENDER,     // Drawing frames and sending them to the panel
+  ENERGY_PANEL_BUSY, // Waiting for the panel to finish a refresh
+  ENERGY_IDLE,       // Awake with nothing to do
+  ENERGY_SLEEP,      // Deep sleep
+  ENERGY_STATE_COUNT
+};
+
+// Time charged to each state, kept in RTC memory across deep sleep
+struct EnergyCounters {
+  uint64_t stateMs[ENERGY_STATE_COUNT];
+};
+
+// Which states are active right now, transient
+struct EnergyTracker {
+  uint8_t active[ENERGY_STATE_COUNT]; // Nesting count, several tasks may be in a state at once
+  uint8_t charged;                    // State the time since chargedSince goes to
+  uint64_t chargedSince;
+};
+
+void energyCountersReset(EnergyCounters& counters);
+
+// Start tracking at nowMs with nothing active
+void energyTrackerBegin(EnergyTracker& tracker, uint64_t nowMs);
+
+// A state became or stopped being active at nowMs; the time up to nowMs is charged first
+void energyTrackerEnter(EnergyTracker& tracker, EnergyCounters& counters, EnergyState state, uint64_t nowMs);
+
+void energyTrackerLeave(EnergyTracker& tracker, EnergyCounters& counters, EnergyState state, uint64_t nowMs);
+
+// Charge the time up to nowMs without a transition, e.g. before reading the counters
+void energyTrackerFlush(EnergyTracker& tracker, EnergyCounters& counters, uint64_t nowMs);
+
+// Add time spent in a state directly, for periods nothing was running to track them
+void energyCharge(EnergyCounters& counters, EnergyState state, uint64_t ms);
+
+// Configured current of a state in microamps
+uint32_t energyCurrentUa(EnergyState state);
+
+// Idle current in microamps when the CPU wakes this often, see ENERGY_CURRENT_IDLE_FLOOR_UA
+double energyIdleCurrentUa(double wakesPerSecond);
+
+// Estimated charge drawn in a state, and by all states
+double energyMilliampHours(const EnergyCounters& counters, EnergyState state);
+
+double energyTotalMilliampHours(const EnergyCounters& counters);
+
+uint64_t energyTotalMs(const EnergyCounters& counters);
+
+const char* energyStateName(EnergyState state);
+
+#endif // ENERGY_MODEL_H
@@ -0,0 +1,198 @@
+/**
+  ******************************************************************************
+  * @file    frame_buffer.cpp
+  * @brief   1bpp frame buffer the screens are rendered into before reaching the panel
+  ******************************************************************************
+*/
+
+#include "frame_buffer.h"
+#include <new>
+
+FrameBuffer::FrameBuffer() : Adafruit_GFX(FRAME_WIDTH, FRAME_HEIGHT), pageTop(0) {
+  memset(buffer, 0xFF, sizeof(buffer));
+}
+
+void FrameBuffer::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  y -= pageTop;
+  if (x < 0 || y < 0 || x >= FRAME_WIDTH || y >= getPageHeight()) {
+    return;
+  }
+  
+  uint8_t& byte = buffer[y * FRAME_BYTES_PER_ROW + x / 8];
+  uint8_t mask = 0x80 >> (x & 7);
+  if (color) {
+    byte |= mask;
+  } else {
+    byte &= ~mask;
+  }
+}
+
+// Clears the current page only, every page is drawn from scratch
+void FrameBuffer::fillScreen(uint16_t color) {
+  memset(buffer, color ? 0xFF : 0x00, sizeof(buffer));
+}
+
+// Same cursor handling as Adafruit_GFX::write() for GFX fonts, with the glyph blitted
+size_t FrameBuffer::write(uint8_t c) {
+  if (gfxFont == nullptr || textsize_x != textsize_y || textsize_x > 2) {
+    return Adafruit_GFX::write(c);
+  }
+  
+  if (c == '\n') {
+    cursor_x = 0;
+    cursor_y += (int16_t)textsize_y * (uint8_t)pgm_read_byte(&gfxFont->yAdvance);
+    return 1;
+  }
+  
+  uint8_t first = pgm_read_byte(&gfxFont->first);
+  if (c == '\r' || c < first || c > (uint8_t)pgm_read_byte(&gfxFont->last)) {
+    return 1;
+  }
+  
+  const GFXglyph* glyph = ((const GFXglyph*)pgm_read_ptr(&gfxFont->glyph)) + (c - first);
+  uint8_t w = pgm_read_byte(&glyph->width);
+  uint8_t h = pgm_read_byte(&glyph->height);
+  if (w > 0 && h > 0) {
+    int16_t xo = (int8_t)pgm_read_byte(&glyph->xOffset);
+    if (wrap && cursor_x + textsize_x * (xo + w) > _width) {
+      cursor_x = 0;
+      cursor_y += (int16_t)textsize_y * (uint8_t)pgm_read_byte(&gfxFont->yAdvance);
+    }
+    blitGlyph(glyph, (const uint8_t*)pgm_read_ptr(&gfxFont->bitmap));
+  }
+  cursor_x += (uint8_t)pgm_read_byte(&glyph->xAdvance) * (int16_t)textsize_x;
+  return 1;
+}
+
+// Spread 16 bits to 32, each bit doubled, for text size 2
+static uint32_t doubleBits(uint32_t x) {
+  x = (x | (x << 8)) & 0x00FF00FF;
+  x = (x | (x << 4)) & 0x0F0F0F0F;
+  x = (x | (x << 2)) & 0x33333333;
+  x = (x | (x << 1)) & 0x55555555;
+  return x | (x << 1);
+}
+
+// Glyph bitmaps are bit-packed across rows; rows are read 16 bits at a time and written whole bytes at a time
+void FrameBuffer::blitGlyph(const GFXglyph* glyph, const uint8_t* bitmap) {
+  int w = pgm_read_byte(&glyph->width);
+  int h = pgm_read_byte(&glyph->height);
+  int size = textsize_x;
+  int16_t x0 = cursor_x + (int8_t)pgm_read_byte(&glyph->xOffset) * size;
+  int16_t y0 = cursor_y + (int8_t)pgm_read_byte(&glyph->yOffset) * size;
+  bool white = textcolor != 0;
+  
+  // Skip rows outside the current page without touching their bits
+  int16_t pageBottom = pageTop + getPageHeight();
+  if (y0 >= pageBottom || y0 + h * size <= pageTop) {
+    return;
+  }
+  
+  const uint8_t* bits = bitmap + pgm_read_word(&glyph->bitmapOffset);
+  uint32_t bitOffset = 0;
+  for (int row = 0; row < h; row++, bitOffset += w) {
+    int16_t y = y0 + row * size;
+    if (y + size <= pageTop || y >= pageBottom) {
+      continue;
+    }
+    
+    for (int column = 0; column < w; column += 16) {
+      int count = w - column < 16 ? w - column : 16;
+      
+      // Up to 16 source bits starting anywhere in a byte span at most 3 bytes
+      uint32_t start = bitOffset + column;
+      const uint8_t* source = bits + start / 8;
+      int needed = (start % 8 + count + 7) / 8;
+      uint32_t window = 0;
+      for (int i = 0; i < 3; i++) {
+        window = (window << 8) | (i < needed ? pgm_read_byte(source + i) : 0);
+      }
+      uint32_t chunk = (window << (8 + start % 8)) & ~(0xFFFFFFFFUL >> count); // Left-aligned
+      if (chunk == 0) {
+        continue;
+      }
+      
+      int16_t x = x0 + column * size;
+      if (size == 2) {
+        uint32_t wide = doubleBits(chunk >> 16);
+        blitBits(x, y, wide, count * 2, white);
+        blitBits(x, y + 1, wide, count * 2, white);
+      } else {
+        blitBits(x, y, chunk, count, white);
+      }
+    }
+  }
+}
+
+// Write up to 32 left-aligned pixels of one row, touching at most 5 bytes
+void FrameBuffer::blitBits(int16_t x, int16_t y, uint32_t bits, int width, bool white) {
+  if (y < pageTop || y >= pageTop + getPageHeight() || x >= FRAME_WIDTH || x + width <= 0) {
+    return;
+  }
+  if (width < 32) {
+    bits &= ~(0xFFFFFFFFUL >> width);
+  }
+  if (x < 0) {
+    bits <<= -x;
+    width += x;
+    x = 0;
+  }
+  if (x + width > FRAME_WIDTH) {
+    width = FRAME_WIDTH - x;
+    bits &= ~(0xFFFFFFFFUL >> width);
+  }
+  
+  // Bit 39 of the window is the first pixel of the byte x falls in
+  uint64_t window = (uint64_t)bits << (8 - (x & 7));
+  uint8_t* row = buffer + (y - pageTop) * FRAME_BYTES_PER_ROW + x / 8;
+  int bytes = ((x & 7) + width + 7) / 8;
+  for (int i = 0; i < bytes; i++) {
+    uint8_t mask = (uint8_t)(window >> (32 - 8 * i));
+    if (white) {
+      row[i] |= mask;
+    } else {
+      row[i] &= ~mask;
+    }
+  }
+}
+
+bool FrameBuffer::drawLayer(const StaticLayer& layer) {
+  if (layer.rows == nullptr) {
+    return false;
+  }
+  
+  // Overlapping rows are contiguous in both, one copy does them all
+  int16_t first = max(layer.top, pageTop);
+  int16_t last = min((int16_t)(layer.top + layer.height), (int16_t)(pageTop + getPageHeight()));
+  if (first < last) {
+    memcpy(buffer + (first - pageTop) * FRAME_BYTES_PER_ROW,
+           layer.rows + (first - layer.top) * FRAME_BYTES_PER_ROW,
+           (last - first) * FRAME_BYTES_PER_ROW);
+  }
+  return true;
+}
+
+bool buildStaticLayer(StaticLayer& layer, int16_t top, int16_t height, RenderFunction render, const void* context) {
+  FrameBuffer* scratch = new (std::nothrow) FrameBuffer();
+  uint8_t* rows = (uint8_t*)malloc(height * FRAME_BYTES_PER_ROW);
+  if (scratch == nullptr || rows == nullptr) {
+    delete scratch;
+    free(rows);
+    return false;
+  }
+  
+  // Render every page the rows fall in and keep just those rows
+  for (int16_t pageTop = top - top % FRAME_PAGE_HEIGHT; pageTop < top + height; pageTop += FRAME_PAGE_HEIGHT) {
+    scratch->setPage(pageTop);
+    render(*scratch, context);
+    for (int16_t y = max(top, pageTop); y < top + height && y < pageTop + scratch->getPageHeight(); y++) {
+      memcpy(rows + (y - top) * FRAME_BYTES_PER_ROW, scratch->getRow(y), FRAME_BYTES_PER_ROW);
+    }
+  }
+  delete scratch;
+  
+  layer.top = top;
+  layer.height = height;
+  layer.rows = rows;
+  return true;
+}
@@ -0,0 +1,96 @@
+/**
+  ******************************************************************************
+  * @file    frame_buffer.h
+  * @brief   1bpp frame buffer the screens are rendered into before reaching the panel
+  ******************************************************************************
+*/
+
+#ifndef FRAME_BUFFER_H
+#define FRAME_BUFFER_H
+
+#include <Adafruit_GFX.h>
+
+#ifndef FRAME_WIDTH
+#define FRAME_WIDTH 200
+#endif
+
+#ifndef FRAME_HEIGHT
+#define FRAME_HEIGHT 200
+#endif
+
+// Rows held in RAM at once. A fraction of FRAME_HEIGHT (e.g. 50 for a quarter, 1.25 KB
+// instead of 5 KB) renders the screen once per page, like GxEPD2_BW's page_height.
+#ifndef FRAME_PAGE_HEIGHT
+#define FRAME_PAGE_HEIGHT FRAME_HEIGHT
+#endif
+
+#define FRAME_BYTES_PER_ROW (FRAME_WIDTH / 8)
+#define FRAME_BUFFER_SIZE (FRAME_BYTES_PER_ROW * FRAME_PAGE_HEIGHT)
+#define FRAME_PAGE_COUNT ((FRAME_HEIGHT + FRAME_PAGE_HEIGHT - 1) / FRAME_PAGE_HEIGHT)
+
+/**
+ * Rows of pre-rendered pixels, the unchanging parts of a screen. They are copied
+ * into the frame with memcpy and replace whatever was under them, so a screen draws
+ * its layers first and the changing fields over them.
+ */
+struct StaticLayer {
+  int16_t top;
+  int16_t height;
+  uint8_t* rows; // height * FRAME_BYTES_PER_ROW bytes, nullptr until built
+};
+
+/**
+ * One page of rows of the frame, in the layout the GxEPD2 drivers expect: rows of
+ * MSB-first bytes, a set bit is white. Drawing uses frame coordinates and anything
+ * outside the current page is clipped, so a whole screen can be drawn once per page.
+ * Text in GFX fonts at size 1 and 2 is blitted a glyph row at a time instead of
+ * pixel by pixel. Rotation is not supported, the watch only uses rotation 0.
+ */
+class FrameBuffer : public Adafruit_GFX {
+private:
+  uint8_t buffer[FRAME_BUFFER_SIZE];
+  int16_t pageTop;
+  
+  void blitGlyph(const GFXglyph* glyph, const uint8_t* bitmap);
+  void blitBits(int16_t x, int16_t y, uint32_t bits, int width, bool white);
+
+public:
+  FrameBuffer();
+  
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+  void fillScreen(uint16_t color) override;
+  
+  using Adafruit_GFX::write;
+  size_t write(uint8_t c) override;
+  
+  // Select the page starting at frame row top, for the next drawing
+  void setPage(int16_t top) { pageTop = top; }
+  int16_t getPageTop() const { return pageTop; }
+  int16_t getPageHeight() const {
+    return FRAME_HEIGHT - pageTop < FRAME_PAGE_HEIGHT ? FRAME_HEIGHT - pageTop : FRAME_PAGE_HEIGHT;
+  }
+  
+  // Rows of the current page
+  const uint8_t* getBuffer() const { return buffer; }
+  
+  // Frame row y, which must be inside the current page
+  const uint8_t* getRow(int16_t y) const { return buffer + (y - pageTop) * FRAME_BYTES_PER_ROW; }
+  
+  // Copy the rows of a layer that fall inside the current page, false if the layer was never built
+  bool drawLayer(const StaticLayer& layer);
+};
+
+/**
+ * Draws a whole screen from context. It runs once per page and pass, possibly on the
+ * display task, so it must be pure: same output for the same context, no waiting.
+ */
+typedef void (*RenderFunction)(FrameBuffer& frame, const void* context);
+
+/**
+ * Pre-render rows top..top+height-1 of what render draws, for drawLayer().
+ * Uses a temporary frame buffer, so call it once at startup rather than per frame.
+ * @return false if there was no memory, the layer then stays empty
+ */
+bool buildStaticLayer(StaticLayer& layer, int16_t top, int16_t height, RenderFunction render, const void* context);
+
+#endif // FRAME_BUFFER_H
@@ -0,0 +1,195 @@
+/**
+  ******************************************************************************
+  * @file    http_pool.cpp
+  * @brief   Pool of persistent keep-alive HTTP connections per (host, port)
+  ******************************************************************************
+*/
+
+#include "http_pool.h"
+#include "rtt_estimator.h"
+
+// Initialize static instance
+HttpConnectionPool* HttpConnectionPool::instance = nullptr;
+
+HttpConnectionPool::HttpConnectionPool() {
+  mutex = xSemaphoreCreateMutex();
+  for (int i = 0; i < HTTP_POOL_SIZE; i++) {
+    connections[i].port = 0;
+    connections[i].inUse = false;
+    connections[i].lastUsed = 0;
+    connections[i].http.setReuse(true);
+  }
+}
+
+HttpConnectionPool* HttpConnectionPool::getInstance() {
+  if (instance == nullptr) {
+    instance = new HttpConnectionPool();
+  }
+  return instance;
+}
+
+HttpConnectionPool::Connection* HttpConnectionPool::acquire(const String& host, uint16_t port) {
+  Connection* found = nullptr;
+  Connection* freeSlot = nullptr;
+  Connection* oldestIdle = nullptr;
+  int hostConnections = 0;
+  
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  for (int i = 0; i < HTTP_POOL_SIZE; i++) {
+    Connection& connection = connections[i];
+    if (connection.host.length() == 0) {
+      if (freeSlot == nullptr) {
+        freeSlot = &connection;
+      }
+      continue;
+    }
+    if (connection.port == port && connection.host == host) {
+      hostConnections++;
+      if (!connection.inUse && found == nullptr) {
+        found = &connection;
+      }
+    }
+    if (!connection.inUse && (oldestIdle == nullptr || connection.lastUsed < oldestIdle->lastUsed)) {
+      oldestIdle = &connection;
+    }
+  }
+  
+  if (found == nullptr && hostConnections < HTTP_POOL_MAX_PER_HOST) {
+    // Open a new connection, recycling the least recently used idle one if full
+    found = freeSlot != nullptr ? freeSlot : oldestIdle;
+    if (found != nullptr) {
+      found->client.stop();
+      found->host = host;
+      found->port = port;
+    }
+  }
+  if (found != nullptr) {
+    found->inUse = true;
+  }
+  xSemaphoreGive(mutex);
+  
+  return found;
+}
+
+void HttpConnectionPool::release(Connection* connection, bool healthy) {
+  if (!healthy) {
+    // Don't keep a socket in an unknown state, the next request reconnects
+    connection->client.stop();
+  }
+  
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  connection->lastUsed = millis();
+  connection->inUse = false;
+  xSemaphoreGive(mutex);
+}
+
+int HttpConnectionPool::request(HTTPClient& http, WiFiClient& client, const String& host, uint16_t port,
+                                const String& path, uint16_t maxTimeoutMs, String& payload) {
+  AdaptiveTimeouts* timeouts = AdaptiveTimeouts::getInstance();
+  uint32_t connectTimeout;
+  uint32_t responseTimeout;
+  timeouts->getTimeouts(host, port, maxTimeoutMs, connectTimeout, responseTimeout);
+  
+  // Connect here rather than in HTTPClient so the handshake gets its own timeout and sample
+  if (!client.connected()) {
+    unsigned long connectStart = millis();
+    bool connected = client.connect(host.c_str(), port, connectTimeout);
+    timeouts->recordConnect(host, port, millis() - connectStart, connected);
+    if (!connected) {
+      return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+  }
+  
+  http.begin(client, host, port, path);
+  http.setTimeout(responseTimeout);
+  
+  unsigned long requestStart = millis();
+  int httpResponseCode = http.GET();
+  if (httpResponseCode > 0) {
+    timeouts->recordResponse(host, port, millis() - requestStart, true);
+  } else if (httpResponseCode == HTTPC_ERROR_READ_TIMEOUT) {
+    // Other errors come from dead sockets, not from a slow vehicle
+    timeouts->recordResponse(host, port, 0, false);
+  }
+  
+  if (httpResponseCode > 0) {
+    // Read the whole body, otherwise the connection can't be reused
+    payload = http.getString();
+  }
+  
+  // Leaves the socket open when the server agreed to keep-alive
+  http.end();
+  
+  return httpResponseCode;
+}
+
+// Errors of a socket the server closed while it sat idle in the pool. A read timeout is
+// not one of them: the request reached a slow vehicle, and repeating it doubles the wait.
+static bool isStaleConnectionError(int httpResponseCode) {
+  switch (httpResponseCode) {
+    case HTTPC_ERROR_CONNECTION_REFUSED:
+    case HTTPC_ERROR_SEND_HEADER_FAILED:
+    case HTTPC_ERROR_SEND_PAYLOAD_FAILED:
+    case HTTPC_ERROR_NOT_CONNECTED:
+    case HTTPC_ERROR_CONNECTION_LOST:
+      return true;
+    default:
+      return false;
+  }
+}
+
+int HttpConnectionPool::get(const String& host, uint16_t port, const String& path, uint16_t maxTimeoutMs, String& payload) {
+  Connection* connection = acquire(host, port);
+  
+  if (connection == nullptr) {
+    // Pool exhausted, fall back to a one-shot connection
+    WiFiClient client;
+    HTTPClient http;
+    int httpResponseCode = request(http, client, host, port, path, maxTimeoutMs, payload);
+    client.stop();
+    return httpResponseCode;
+  }
+  
+  bool reused = connection->client.connected();
+  int httpResponseCode = request(connection->http, connection->client, host, port, path, maxTimeoutMs, payload);
+  
+  if (reused && isStaleConnectionError(httpResponseCode)) {
+    // The server may have closed the idle connection under us, retry on a fresh one
+    Serial.printf("Stale connection to %s:%u, reconnecting\n", host.c_str(), port);
+    connection->client.stop();
+    httpResponseCode = request(connection->http, connection->client, host, port, path, maxTimeoutMs, payload);
+  }
+  
+  release(connection, httpResponseCode > 0);
+  
+  return httpResponseCode;
+}
+
+void HttpConnectionPool::evictIdle() {
+  unsigned long now = millis();
+  
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  for (int i = 0; i < HTTP_POOL_SIZE; i++) {
+    Connection& connection = connections[i];
+    if (connection.host.length() > 0 && !connection.inUse &&
+        now - connection.lastUsed >= HTTP_POOL_IDLE_TIMEOUT_MS) {
+      connection.client.stop();
+      connection.host = "";
+      connection.port = 0;
+    }
+  }
+  xSemaphoreGive(mutex);
+}
+
+void HttpConnectionPool::closeAll() {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  for (int i = 0; i < HTTP_POOL_SIZE; i++) {
+    Connection& connection = connections[i];
+    if (!connection.inUse) {
+      connection.client.stop();
+      connection.host = "";
+      connection.port = 0;
+    }
+  }
+  xSemaphoreGive(mutex);
+}
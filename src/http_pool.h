@@ -0,0 +1,71 @@
+/**
+  ******************************************************************************
+  * @file    http_pool.h
+  * @brief   Pool of persistent keep-alive HTTP connections per (host, port)
+  ******************************************************************************
+*/
+
+#ifndef HTTP_POOL_H
+#define HTTP_POOL_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <HTTPClient.h>
+#include "telemetry.h"
+
+// Total number of pooled connections (one per BlueOS service and vehicle)
+#ifndef HTTP_POOL_SIZE
+#define HTTP_POOL_SIZE (MAX_VEHICLES * 2)
+#endif
+
+// Connections to the same service that may be open at once
+#ifndef HTTP_POOL_MAX_PER_HOST
+#define HTTP_POOL_MAX_PER_HOST 2
+#endif
+
+// Connections unused for this long are closed to free lwIP sockets
+#ifndef HTTP_POOL_IDLE_TIMEOUT_MS
+#define HTTP_POOL_IDLE_TIMEOUT_MS 120000
+#endif
+
+// Keep-alive connection pool shared by all fetch paths
+class HttpConnectionPool {
+private:
+  struct Connection {
+    String host;
+    uint16_t port;
+    WiFiClient client;
+    HTTPClient http; // Kept with its client: destroying it would close the socket
+    bool inUse;
+    unsigned long lastUsed;
+  };
+  
+  static HttpConnectionPool* instance;
+  Connection connections[HTTP_POOL_SIZE];
+  SemaphoreHandle_t mutex;
+  
+  HttpConnectionPool();
+  Connection* acquire(const String& host, uint16_t port);
+  void release(Connection* connection, bool healthy);
+  int request(HTTPClient& http, WiFiClient& client, const String& host, uint16_t port,
+              const String& path, uint16_t maxTimeoutMs, String& payload);
+
+public:
+  static HttpConnectionPool* getInstance();
+  
+  /**
+   * GET a path over a pooled connection.
+   * A reused connection that turns out to be stale is reconnected once.
+   * Connect and response timeouts are learned per service, maxTimeoutMs caps the response one.
+   * @return HTTP status code, or a negative HTTPClient error code
+   */
+  int get(const String& host, uint16_t port, const String& path, uint16_t maxTimeoutMs, String& payload);
+  
+  // Close connections that were idle for longer than HTTP_POOL_IDLE_TIMEOUT_MS
+  void evictIdle();
+  
+  // Close every idle connection, e.g. after the WiFi link was re-established
+  void closeAll();
+};
+
+#endif // HTTP_POOL_H
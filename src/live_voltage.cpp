@@ -0,0 +1,67 @@
+/**
+  ******************************************************************************
+  * @file    live_voltage.cpp
+  * @brief   Latest vehicle voltages pushed by streaming telemetry sources
+  ******************************************************************************
+*/
+
+#include "live_voltage.h"
+
+// Initialize static instance
+LiveVoltageStore* LiveVoltageStore::instance = nullptr;
+
+LiveVoltageStore::LiveVoltageStore() {
+  mutex = xSemaphoreCreateMutex();
+  for (int i = 0; i < MAX_VEHICLES; i++) {
+    entries[i].voltage = -1.0f;
+    entries[i].updatedAt = 0;
+    entries[i].source = LIVE_SOURCE_NONE;
+  }
+}
+
+LiveVoltageStore* LiveVoltageStore::getInstance() {
+  if (instance == nullptr) {
+    instance = new LiveVoltageStore();
+  }
+  return instance;
+}
+
+void LiveVoltageStore::publish(const String& ip, float voltage, LiveVoltageSource source) {
+  unsigned long now = millis();
+  
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  // Reuse the vehicle's entry, or the stalest one
+  int index = 0;
+  for (int i = 0; i < MAX_VEHICLES; i++) {
+    if (entries[i].ip == ip) {
+      index = i;
+      break;
+    }
+    if (entries[i].updatedAt < entries[index].updatedAt) {
+      index = i;
+    }
+  }
+  entries[index].ip = ip;
+  entries[index].voltage = voltage;
+  entries[index].updatedAt = now;
+  entries[index].source = source;
+  xSemaphoreGive(mutex);
+}
+
+bool LiveVoltageStore::get(const String& ip, unsigned long maxAgeMs, float& voltage) {
+  bool fresh = false;
+  
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  for (int i = 0; i < MAX_VEHICLES; i++) {
+    if (entries[i].source != LIVE_SOURCE_NONE && entries[i].ip == ip) {
+      if (millis() - entries[i].updatedAt < maxAgeMs) {
+        voltage = entries[i].voltage;
+        fresh = true;
+      }
+      break;
+    }
+  }
+  xSemaphoreGive(mutex);
+  
+  return fresh;
+}
@@ -0,0 +1,55 @@
+/**
+  ******************************************************************************
+  * @file    live_voltage.h
+  * @brief   Latest vehicle voltages pushed by streaming telemetry sources
+  ******************************************************************************
+*/
+
+#ifndef LIVE_VOLTAGE_H
+#define LIVE_VOLTAGE_H
+
+#include <Arduino.h>
+#include "telemetry.h"
+
+// A streamed value younger than this replaces the HTTP voltage request
+#ifndef LIVE_VOLTAGE_MAX_AGE_MS
+#define LIVE_VOLTAGE_MAX_AGE_MS 30000
+#endif
+
+// Where a live value came from
+enum LiveVoltageSource : uint8_t {
+  LIVE_SOURCE_NONE,
+  LIVE_SOURCE_WEBSOCKET,
+  LIVE_SOURCE_MAVLINK_UDP
+};
+
+// Thread-safe table of the last streamed voltage per vehicle IP
+class LiveVoltageStore {
+private:
+  struct Entry {
+    String ip;
+    float voltage;
+    unsigned long updatedAt;
+    LiveVoltageSource source;
+  };
+  
+  static LiveVoltageStore* instance;
+  Entry entries[MAX_VEHICLES];
+  SemaphoreHandle_t mutex;
+  
+  LiveVoltageStore();
+
+public:
+  static LiveVoltageStore* getInstance();
+  
+  // Record a voltage (in volts) received for a vehicle
+  void publish(const String& ip, float voltage, LiveVoltageSource source);
+  
+  /**
+   * Get the last voltage if it is younger than maxAgeMs
+   * @return true and fills voltage when a fresh value exists
+   */
+  bool get(const String& ip, unsigned long maxAgeMs, float& voltage);
+};
+
+#endif // LIVE_VOLTAGE_H
@@ -23,6 +23,25 @@
 #include <HTTPClient.h>
 #include <WebServer.h>
 #include "esp_sleep.h"
+#include "telemetry.h"
+#include "vehicle_fetcher.h"
+#include "vehicle_api.h"
+#include "vehicle_name_cache.h"
+#include "http_pool.h"
+#include "vehicle_discovery.h"
+#include "battery_stream.h"
+#include "mavlink_udp_source.h"
+#include "rtt_estimator.h"
+#include "circuit_breaker.h"
+#include "rtc_state.h"
+#include "wifi_fast_connect.h"
+#include "wifi_manager.h"
+#include "sleep_policy.h"
+#include "display_updater.h"
+#include "power_manager.h"
+#include "draw_schedule.h"
+#include "battery_adc.h"
+#include "charge_monitor.h"
 
 // WiFi icon bitmap (20x20 pixels)
 const unsigned char WIFI_ICON[] PROGMEM = {
@@ -57,29 +76,54 @@ const unsigned char WIFI_ICON[] PROGMEM = {
 // Web server on port 80
 WebServer server(80);
 
-// Variables to store screen data for web server
-String vehicleNames[3];
-float vehicleVoltages[3];
-int vehicleCount = 0;
-float batteryVoltage = 0.0f;
-bool wifiConnected = false;
-unsigned long deviceUptime = 0;
+// Last collected screen data, shared by the display and the web server
+TelemetrySnapshot latestSnapshot = {};
 String ipAddress = "0.0.0.0"; // Add variable to store IP address
 
-// Track WiFi connection attempts
-unsigned long wifiDisconnectedTime = 0;
-int reconnectionAttempts = 0;
-const int MAX_RECONNECTION_ATTEMPTS = 1; // Try 5 times before sleeping
-const unsigned long WIFI_DEEP_SLEEP_DURATION = 60e6; // 60 seconds in microseconds
-
-// Create the display instance
-GxEPD2_BW<GxEPD2_154_D67, GxEPD2_154_D67::HEIGHT> display(
-  GxEPD2_154_D67(
-    DISPLAY_CS,
-    DISPLAY_DC,
-    DISPLAY_RESET,
-    DISPLAY_BUSY
-  )
+// OTA, web server and background tasks start on the first connection
+bool servicesStarted = false;
+
+// Draw and battery sampling timers of the always-on loop
+DrawSchedule drawSchedule;
+
+// Longest wait of the always-on loop, so the web server and OTA still answer within it.
+// It waits LOOP_BUSY_DELAY_MS instead while a connection, a draw, a web client or an OTA
+// update is in progress; every wake costs ENERGY_IDLE_WAKE_CHARGE_UC.
+#ifndef LOOP_IDLE_MAX_MS
+#define LOOP_IDLE_MAX_MS 200
+#endif
+#define LOOP_BUSY_DELAY_MS 10
+
+// A web request keeps the loop at LOOP_BUSY_DELAY_MS this long, for the page's follow-up requests
+#define LOOP_WEB_ACTIVE_MS 2000
+
+unsigned long lastWebRequestMs = 0;
+bool otaInProgress = false;
+
+// Duty-cycle mode: wake, fetch, render and deep sleep instead of staying awake.
+// There is no web server or OTA in this mode; press MENU to wake into always-on mode.
+#ifndef DUTY_CYCLE_MODE
+#define DUTY_CYCLE_MODE 0
+#endif
+#ifndef DUTY_CYCLE_INTERVAL_MS
+#define DUTY_CYCLE_INTERVAL_MS 300000 // 5 minutes between wakes
+#endif
+
+// Uptime on the status screen advances in these steps, so most wakes leave its region alone
+#ifndef STATUS_UPTIME_STEP_MINUTES
+#define STATUS_UPTIME_STEP_MINUTES 15
+#endif
+// Remembered vehicles are trusted for this many wakes before querying mDNS again
+#ifndef DUTY_CYCLE_REDISCOVER_WAKES
+#define DUTY_CYCLE_REDISCOVER_WAKES 12
+#endif
+
+// Create the panel driver, screens are rendered into DisplayUpdater's frame buffer
+GxEPD2_154_D67 panel(
+  DISPLAY_CS,
+  DISPLAY_DC,
+  DISPLAY_RESET,
+  DISPLAY_BUSY
 );
 
 // Define custom fonts for UI elements
@@ -87,17 +131,31 @@ GxEPD2_BW<GxEPD2_154_D67, GxEPD2_154_D67::HEIGHT> display(
 #define MEDIUM_FONT FreeSansBold12pt7b
 #define SMALL_FONT FreeSansBold9pt7b
 
+// Number of vehicle rows that fit on the display
+#define DISPLAY_VEHICLE_ROWS 3
+
+// Regions of the status screen, updated independently. They tile the 200x200 frame,
+// with x and width on byte boundaries for partial windows.
+const DisplayRegion STATUS_REGIONS[] = {
+  { "battery",   0,   0,   200, 71 }, // Voltage baseline at 50, charge line at 66
+  { "vehicle 1", 0,   71,  200, 32 }, // Row baselines at 88, 120 and 152
+  { "vehicle 2", 0,   103, 200, 32 },
+  { "vehicle 3", 0,   135, 200, 25 },
+  { "footer",    0,   160, 136, 40 }, // WiFi icon, SSID and IP
+  { "uptime",    136, 160, 64,  40 }  // Right-aligned at baseline 180
+};
+#define STATUS_REGION_COUNT (sizeof(STATUS_REGIONS) / sizeof(STATUS_REGIONS[0]))
+
 // Battery monitoring class
 class BatteryDisplay {
 private:
   static BatteryDisplay* instance;
-  float currentVoltage;
-  unsigned long lastUpdateTime;
-  const unsigned long updateIntervalMs = 60000; // Update every minute
-  const uint8_t batteryPin = 34; // ADC pin connected to battery
+  bool samplePending;
+  uint16_t lastSpread;     // Interquartile range of the last burst, raw ADC counts
+  uint32_t deferredCount;  // Samples put off because the radio was busy
   
-  BatteryDisplay() : currentVoltage(0.0f), lastUpdateTime(0) {
-    analogReadResolution(12); // Set ADC resolution to 12-bit
+  BatteryDisplay() : samplePending(false), lastSpread(0), deferredCount(0) {
+    batteryAdcBegin();
     updateVoltage();
   }
 
@@ -109,229 +167,149 @@ public:
     return instance;
   }
   
+  // Filtered voltage; it only moves once the estimate did, so it never flickers between two digits
   float getVoltage() {
-    return currentVoltage;
+    return rtcState.batteryFilter.displayed;
   }
   
-  bool shouldUpdate() {
-    unsigned long currentTime = millis();
-    if (currentTime - lastUpdateTime >= updateIntervalMs) {
-      updateVoltage();
-      lastUpdateTime = currentTime;
-      return true;
-    }
-    return false;
+  float getEstimate() {
+    return rtcState.batteryFilter.estimate;
   }
   
-  void updateVoltage() {
-    // Analog read and calculate voltage
-    // The battery voltage is divided by 2 via a voltage divider
-    // ADC range is 0-4095 for 0-3.3V
-    int adcValue = analogRead(batteryPin);
-    float voltage = adcValue * 3.3 * 2 / 4095.0;
-    currentVoltage = voltage * 1.0678;
-    Serial.printf("Battery ADC: %d, Voltage: %.2fV\n", adcValue, voltage);
+  uint16_t getSpread() {
+    return lastSpread;
   }
-};
-
-// Initialize static instance
-BatteryDisplay* BatteryDisplay::instance = nullptr;
-
-// Function to get battery voltage from Mavlink HTTP API
-float getMavlinkBatteryVoltage(const String& vehicleIP) {
-  float batteryVoltage = -1.0f; // Default value indicating failure
   
-  if (vehicleIP.length() == 0 || vehicleIP == "Not found" || vehicleIP == "0.0.0.0") {
-    Serial.println("Invalid vehicle IP address");
-    return batteryVoltage;
+  uint32_t getDeferredCount() {
+    return deferredCount;
   }
   
-  HTTPClient http;
-  
-  // Construct the URL for the battery voltage endpoint
-  String url = "http://" + vehicleIP + ":6040/v1/mavlink/vehicles/1/components/1/messages/BATTERY_STATUS/message/voltages/0";
-  
-  Serial.println("Making request to: " + url);
-  http.begin(url);
-  
-  // Set timeout for the request
-  http.setTimeout(5000); // 5 second timeout
-  
-  // Send GET request
-  int httpResponseCode = http.GET();
+  // Ask for a sample, taken now or by poll() once the radio is quiet
+  void updateVoltage() {
+    if (powerRadioActive()) {
+      deferredCount++;
+    }
+    samplePending = true;
+    poll();
+  }
   
-  if (httpResponseCode > 0) {
-    Serial.printf("HTTP Response code: %d\n", httpResponseCode);
-    String payload = http.getString();
-    Serial.println("Payload: " + payload);
+  void poll() {
+    if (!samplePending) {
+      return;
+    }
     
-    // Parse the plain text number response
-    // No need for JSON parsing since the response is just a number
-    int millivolts = payload.toInt();
-    if (millivolts > 0) {
-      // The API returns millivolts, convert to volts
-      batteryVoltage = millivolts / 1000.0f;
-      Serial.printf("Battery voltage: %.2f V\n", batteryVoltage);
-    } else {
-      Serial.println("Failed to parse voltage value from response");
+    // Transmit bursts sag the supply and couple into the ADC, sample between them
+    if (powerRadioActive()) {
+      return;
     }
+    samplePending = false;
+    
+    float measured = batteryAdcRead(lastSpread);
+    float estimate = batteryFilterUpdate(rtcState.batteryFilter, measured);
+    
+    // The displayed voltage, so the percentage moves no more often than the volts
+    chargeMonitorRecordWatch(rtcState.batteryFilter.displayed);
+    Serial.printf("Battery: burst %.3fV (spread %u), filtered %.3fV, shown %.2fV\n",
+                  measured, lastSpread, estimate, rtcState.batteryFilter.displayed);
+  }
+};
+
+// Initialize static instance
+BatteryDisplay* BatteryDisplay::instance = nullptr;
+
+// Time to empty as "45m", "9h10m" or "3d4h", coarser the longer it is so it changes rarely
+void formatDuration(int32_t minutes, char* buffer, size_t size) {
+  if (minutes < 60) {
+    snprintf(buffer, size, "%ldm", (long)minutes);
+  } else if (minutes < 24 * 60) {
+    snprintf(buffer, size, "%ldh%02ldm", (long)(minutes / 60), (long)(minutes % 60 / 10 * 10));
   } else {
-    // Improved error reporting
-    String errorMsg;
-    switch (httpResponseCode) {
-      case -1:
-        errorMsg = "Connection failed";
-        break;
-      case -2:
-        errorMsg = "Connection lost";
-        break;
-      case -3:
-        errorMsg = "Connection timed out";
-        break;
-      case -4:
-        errorMsg = "Server sent invalid response";
-        break;
-      case -5:
-        errorMsg = "Connection refused";
-        break;
-      case -6:
-        errorMsg = "Invalid server response";
-        break;
-      case -7:
-        errorMsg = "Failed to allocate stream";
-        break;
-      case -8:
-        errorMsg = "Not enough memory";
-        break;
-      case -9:
-        errorMsg = "Invalid HTTP response";
-        break;
-      case -10:
-        errorMsg = "More data pending";
-        break;
-      case -11:
-        errorMsg = "Connection timeout";
-        break;
-      default:
-        errorMsg = "Unknown error";
-    }
-    Serial.printf("HTTP request failed, error: %d (%s)\n", httpResponseCode, errorMsg.c_str());
+    snprintf(buffer, size, "%ldd%ldh", (long)(minutes / (24 * 60)), (long)(minutes / 60 % 24));
   }
-  
-  http.end();
-  
-  return batteryVoltage;
 }
 
-// Function to get vehicle name from the API
-String getVehicleName(const String& vehicleIP) {
-  String vehicleName = "Vehicle";  // Default name if API call fails
-  
-  if (vehicleIP.length() == 0 || vehicleIP == "0.0.0.0") {
-    Serial.println("Invalid vehicle IP for name lookup");
-    return vehicleName;
-  }
-  
-  HTTPClient http;
-  
-  // Construct the URL for the vehicle name endpoint
-  String url = "http://" + vehicleIP + ":9111/v1.0/vehicle_name";
-  
-  Serial.println("Getting vehicle name from: " + url);
-  http.begin(url);
-  
-  // Set timeout for the request
-  http.setTimeout(3000); // 3 second timeout
-  
-  // Send GET request
-  int httpResponseCode = http.GET();
-  
-  if (httpResponseCode > 0) {
-    Serial.printf("HTTP Response code: %d\n", httpResponseCode);
-    String payload = http.getString();
-    Serial.println("Name payload: " + payload);
-    
-    // Trim whitespace and use the response as vehicle name
-    vehicleName = payload;
-    vehicleName.trim();
-    
-    // Remove any double quotes from the name
-    for (int i = 0; i < vehicleName.length(); i++) {
-      if (vehicleName[i] == '"') {
-        vehicleName.remove(i, 1);
-        i--; // Adjust index after removal
-      }
-    }
-    
-    // If empty response, use default
-    if (vehicleName.length() == 0) {
-      vehicleName = "Vehicle";
-    }
+// What a pack is doing: time to empty, charging, steady or still measuring
+void formatChargeStatus(const ChargeEstimate& charge, char* buffer, size_t size) {
+  if (charge.soc < 0) {
+    snprintf(buffer, size, "--");
+  } else if (charge.charging) {
+    snprintf(buffer, size, "Charging");
+  } else if (charge.minutesToEmpty >= 0) {
+    char duration[16];
+    formatDuration(charge.minutesToEmpty, duration, sizeof(duration));
+    snprintf(buffer, size, "Empty in %s", duration);
+  } else if (charge.ratePerHour != 0) {
+    snprintf(buffer, size, "Steady");
   } else {
-    // Improved error reporting
-    String errorMsg;
-    switch (httpResponseCode) {
-      case -1:
-        errorMsg = "Connection failed";
-        break;
-      case -2:
-        errorMsg = "Connection lost";
-        break;
-      case -3:
-        errorMsg = "Connection timed out";
-        break;
-      case -4:
-        errorMsg = "Server sent invalid response";
-        break;
-      case -5:
-        errorMsg = "Connection refused";
-        break;
-      case -6:
-        errorMsg = "Invalid server response";
-        break;
-      case -7:
-        errorMsg = "Failed to allocate stream";
-        break;
-      case -8:
-        errorMsg = "Not enough memory";
-        break;
-      case -9:
-        errorMsg = "Invalid HTTP response";
-        break;
-      case -10:
-        errorMsg = "More data pending";
-        break;
-      case -11:
-        errorMsg = "Connection timeout";
-        break;
-      default:
-        errorMsg = "Unknown error";
+    snprintf(buffer, size, "Measuring");
+  }
+}
+
+// Text as the body of a JSON string; vehicle names come from the network
+String jsonEscape(const String& text) {
+  String escaped;
+  escaped.reserve(text.length() + 8);
+  for (unsigned int i = 0; i < text.length(); i++) {
+    char c = text[i];
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+      escaped += c;
+    } else if ((uint8_t)c < 0x20) {
+      char code[8];
+      snprintf(code, sizeof(code), "\\u%04x", (unsigned int)(uint8_t)c);
+      escaped += code;
+    } else {
+      escaped += c;
     }
-    Serial.printf("Name request failed, error: %d (%s)\n", httpResponseCode, errorMsg.c_str());
   }
-  
-  http.end();
-  
-  return vehicleName;
+  return escaped;
+}
+
+// Charge estimate as a JSON object
+String chargeJson(const ChargeEstimate& charge, float voltage) {
+  String json = "{\"voltage\":" + String(voltage, 2);
+  json += ",\"cells\":" + String((unsigned int)charge.cells);
+  json += ",\"soc\":" + (charge.soc >= 0 ? String(charge.soc, 1) : String("null"));
+  json += ",\"ratePerHour\":" + String(charge.ratePerHour, 2);
+  json += ",\"minutesToEmpty\":" + (charge.minutesToEmpty >= 0 ? String((long)charge.minutesToEmpty) : String("null"));
+  json += ",\"charging\":" + String(charge.charging ? "true" : "false") + "}";
+  return json;
 }
 
 // Function to handle root path on web server
 void handleRoot() {
+  // Work on a copy so the page is consistent even if a new snapshot is published
+  const TelemetrySnapshot snapshot = latestSnapshot;
+  
   String html = "<!DOCTYPE html><html><head><title>Watchy Status</title>";
   html += "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">";
   html += "</head><body><h1>Watchy Status</h1>";
   
   // Battery section
-  html += "<h2>Battery: " + String(batteryVoltage, 2) + "V</h2>";
+  char chargeStatus[32];
+  html += "<h2>Battery: " + String(snapshot.batteryVoltage, 2) + "V";
+  if (snapshot.batteryCharge.soc >= 0) {
+    formatChargeStatus(snapshot.batteryCharge, chargeStatus, sizeof(chargeStatus));
+    html += ", " + String(snapshot.batteryCharge.soc, 0) + "%, " + chargeStatus;
+  }
+  html += "</h2>";
   
   // Vehicles section
   html += "<h2>Vehicles:</h2>";
-  if (vehicleCount > 0) {
+  if (snapshot.vehicleCount > 0) {
     html += "<ul>";
-    for (int i = 0; i < vehicleCount; i++) {
-      html += "<li>" + vehicleNames[i];
-      if (vehicleVoltages[i] > 0) {
-        html += ": " + String(vehicleVoltages[i], 1) + "V";
+    for (int i = 0; i < snapshot.vehicleCount; i++) {
+      const VehicleTelemetry& vehicle = snapshot.vehicles[i];
+      html += "<li>" + vehicle.name;
+      if (vehicle.voltage > 0) {
+        html += ": " + String(vehicle.voltage, 1) + "V";
+        if (vehicle.charge.soc >= 0) {
+          formatChargeStatus(vehicle.charge, chargeStatus, sizeof(chargeStatus));
+          html += " (" + String((unsigned int)vehicle.charge.cells) + "S), " + String(vehicle.charge.soc, 0) + "%, " + chargeStatus;
+        }
+        if (vehicle.stale) {
+          html += " (stale, unreachable)";
+        }
       } else {
         html += ": --";
       }
@@ -343,21 +321,167 @@ void handleRoot() {
   }
   
   // WiFi status
-  html += "<p>WiFi: " + String(wifiConnected ? WIFI_SSID : "----") + "</p>";
+  html += "<p>WiFi: " + String(snapshot.wifiConnected ? WIFI_SSID : "----") + "</p>";
   
   // IP Address
-  html += "<p>IP: " + ipAddress + "</p>";
+  html += "<p>IP: " + snapshot.ipAddress + "</p>";
   
   // Uptime
-  html += "<p>Uptime: " + String(deviceUptime) + "m</p>";
+  html += "<p>Uptime: " + String(snapshot.uptimeMinutes) + "m</p>";
   
   // Control buttons
-  html += "<p><a href=\"/\">Refresh</a> | <a href=\"/reboot\" onclick=\"return confirm('Are you sure you want to reboot the device?');\">Reboot</a></p>";
+  html += "<p><a href=\"/\">Refresh</a> | <a href=\"/refresh-names\">Refresh names</a> | <a href=\"/diag\">Diagnostics</a> | <a href=\"/api/battery\">Battery API</a> | <a href=\"/reboot\" onclick=\"return confirm('Are you sure you want to reboot the device?');\">Reboot</a></p>";
+  
+  html += "</body></html>";
+  server.send(200, "text/html", html);
+}
+
+// Battery state of charge and time to empty of the watch and the vehicles, as JSON
+void handleBatteryApi() {
+  const TelemetrySnapshot snapshot = latestSnapshot;
+  
+  String json = "{\"watch\":" + chargeJson(snapshot.batteryCharge, snapshot.batteryVoltage) + ",\"vehicles\":[";
+  for (int i = 0; i < snapshot.vehicleCount; i++) {
+    const VehicleTelemetry& vehicle = snapshot.vehicles[i];
+    String entry = chargeJson(vehicle.charge, vehicle.voltage);
+    json += String(i > 0 ? "," : "") + "{\"ip\":\"" + jsonEscape(vehicle.ip) + "\",\"name\":\"" + jsonEscape(vehicle.name) + "\",";
+    json += "\"stale\":" + String(vehicle.stale ? "true" : "false") + "," + entry.substring(1);
+  }
+  json += "]}";
+  server.send(200, "application/json", json);
+}
+
+// Function to show learned network parameters
+void handleDiagnostics() {
+  String html = "<!DOCTYPE html><html><head><title>Watchy Diagnostics</title>";
+  html += "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">";
+  html += "</head><body><h1>Watchy Diagnostics</h1>";
+  
+  // Adaptive timeouts, one row per vehicle service
+  html += "<h2>Round-trip times</h2>";
+  RttEntry entries[RTT_TABLE_SIZE];
+  int count = AdaptiveTimeouts::getInstance()->getEntries(entries, RTT_TABLE_SIZE);
+  if (count > 0) {
+    html += "<table border=\"1\"><tr><th>Service</th><th>Connect SRTT / var / timeout</th>";
+    html += "<th>Response SRTT / var / timeout</th><th>Samples</th><th>Timeouts</th></tr>";
+    for (int i = 0; i < count; i++) {
+      const RttEntry& entry = entries[i];
+      html += "<tr><td>" + entry.host + ":" + String(entry.port) + "</td>";
+      html += "<td>" + String(entry.connect.smoothedRtt(), 0) + " / " + String(entry.connect.variance(), 0);
+      html += " / " + String(entry.connect.timeout()) + " ms</td>";
+      html += "<td>" + String(entry.response.smoothedRtt(), 0) + " / " + String(entry.response.variance(), 0);
+      html += " / " + String(entry.response.timeout()) + " ms</td>";
+      html += "<td>" + String(entry.connect.samples) + " / " + String(entry.response.samples) + "</td>";
+      html += "<td>" + String(entry.connect.timeouts) + " / " + String(entry.response.timeouts) + "</td></tr>";
+    }
+    html += "</table>";
+  } else {
+    html += "<p>No requests yet</p>";
+  }
+  
+  // WiFi connection phases
+  const RtcWifiTimings& timings = rtcState.wifiTimings;
+  html += "<h2>WiFi connect</h2>";
+  html += "<p>Last (" + String(timings.fastPath ? "fast" : "full") + "): scan " + String(timings.scanMs);
+  html += " ms, associate " + String(timings.associateMs) + " ms, DHCP " + String(timings.dhcpMs);
+  html += " ms, total " + String(timings.totalMs) + " ms</p>";
+  html += "<p>Fast: " + String(timings.fastConnects) + " connects, avg ";
+  html += String(timings.fastConnects > 0 ? (unsigned long)(timings.fastTotalMs / timings.fastConnects) : 0UL);
+  html += " ms, " + String(timings.fastFailures) + " fallbacks. Full: " + String(timings.fullConnects) + " connects, avg ";
+  html += String(timings.fullConnects > 0 ? (unsigned long)(timings.fullTotalMs / timings.fullConnects) : 0UL) + " ms</p>";
+  
+  WiFiManager* wifi = WiFiManager::getInstance();
+  html += "<p>State: " + String(WiFiManager::stateName(wifi->getState())) + " for ";
+  html += String(wifi->timeInState() / 1000) + " s</p>";
+  const SleepPolicyState& sleepPolicy = rtcState.sleepPolicy;
+  int availability = sleepPolicyAvailability(sleepPolicy, rtcStateUptimeMs());
+  html += "<p>Absent " + String((unsigned int)sleepPolicy.consecutiveFailures) + " times in a row, last sleep ";
+  html += String((unsigned long)(sleepPolicy.lastSleepMs / 1000)) + " s. Usual availability now: ";
+  html += (availability < 0 ? String("learning") : String(availability * 100 / 255) + "%") + "</p>";
+  WiFiDisconnectRecord disconnects[WIFI_DISCONNECT_HISTORY];
+  int disconnectCount = wifi->getDisconnects(disconnects, WIFI_DISCONNECT_HISTORY);
+  if (disconnectCount > 0) {
+    html += "<table border=\"1\"><tr><th>Disconnect</th><th>Reason</th></tr>";
+    for (int i = 0; i < disconnectCount; i++) {
+      html += "<tr><td>" + String((millis() - disconnects[i].at) / 1000) + " s ago</td>";
+      html += "<td>" + String(disconnects[i].reason) + " (" + WiFiManager::reasonName(disconnects[i].reason) + ")</td></tr>";
+    }
+    html += "</table>";
+  }
   
+  // Battery ADC pipeline
+  BatteryDisplay* battery = BatteryDisplay::getInstance();
+  html += "<h2>Battery ADC</h2>";
+  html += "<p>" + String(batteryAdcCalibrationName()) + " calibration, " + String(BATTERY_ADC_BURST) + " readings per burst. ";
+  html += "Filtered " + String(battery->getEstimate(), 3) + " V over " + String(rtcState.batteryFilter.samples);
+  html += " bursts, shown " + String(battery->getVoltage(), 2) + " V. Last burst spread " + String((unsigned int)battery->getSpread());
+  html += " counts, " + String(battery->getDeferredCount()) + " samples put off for the radio</p>";
+  
+  // Clock management
+  html += "<h2>Power</h2>";
+  html += "<p>" + String(powerModeName(powerManagerMode())) + ", CPU now " + String((unsigned int)getCpuFrequencyMhz());
+  html += " MHz. Locks held: render " + String(powerLockCount(POWER_RENDER)) + ", fetch ";
+  html += String(powerLockCount(POWER_FETCH)) + ", OTA " + String(powerLockCount(POWER_OTA)) + "</p>";
+  EnergyCounters energy;
+  powerEnergySnapshot(energy);
+  uint64_t energyMs = energyTotalMs(energy);
+  double energyMah = energyTotalMilliampHours(energy);
+  html += "<p>Estimated " + String(energyMah, 2) + " mAh since the first boot, ";
+  html += String(energyMs > 0 ? energyMah * 3600000.0 / energyMs : 0.0, 2) + " mA average</p>";
+  html += "<table border=\"1\"><tr><th>State</th><th>Time</th><th>Current</th><th>Charge</th><th>Share</th></tr>";
+  for (int i = 0; i < ENERGY_STATE_COUNT; i++) {
+    EnergyState state = (EnergyState)i;
+    double mah = energyMilliampHours(energy, state);
+    html += "<tr><td>" + String(energyStateName(state)) + "</td><td>" + String((unsigned long)(energy.stateMs[i] / 1000));
+    html += " s</td><td>" + String(energyCurrentUa(state) / 1000.0, 2) + " mA</td><td>" + String(mah, 3) + " mAh</td>";
+    html += "<td>" + String(energyMah > 0 ? mah * 100 / energyMah : 0.0, 1) + "%</td></tr>";
+  }
+  html += "</table>";
+  
+  // E-paper refreshes
+  html += "<h2>Display</h2>";
+  html += "<p>" + String(rtcState.panelRefreshes) + " full and " + String(rtcState.panelPartials);
+  html += " partial updates, " + String(rtcState.panelSkips) + " unchanged frames skipped</p>";
+  const RefreshSchedulerState& scheduler = DisplayUpdater::getInstance()->getScheduler();
+  html += "<p>Since the last full refresh: " + String((unsigned int)scheduler.partialsSinceFull) + " of ";
+  html += String(REFRESH_MAX_PARTIALS) + " partial updates, changed pixels per region:";
+  for (size_t i = 0; i < STATUS_REGION_COUNT; i++) {
+    html += " " + String(STATUS_REGIONS[i].name) + " " + String((unsigned long)scheduler.regionPixels[i]);
+  }
+  html += " (limit " + String(REFRESH_MAX_REGION_PIXELS) + ")</p>";
+  
+  // Circuit breakers, one row per vehicle
+  html += "<h2>Circuit breakers</h2>";
+  VehicleHealth health[MAX_VEHICLES];
+  int healthCount = VehicleHealthTable::getInstance()->getEntries(health, MAX_VEHICLES);
+  if (healthCount > 0) {
+    const char* stateNames[] = { "closed", "open", "half-open" };
+    unsigned long now = millis();
+    html += "<table border=\"1\"><tr><th>Vehicle</th><th>State</th><th>Trips</th><th>Next probe</th><th>Last voltage</th></tr>";
+    for (int i = 0; i < healthCount; i++) {
+      const VehicleHealth& entry = health[i];
+      html += "<tr><td>" + entry.ip + "</td><td>" + stateNames[entry.breaker.getState()] + "</td>";
+      html += "<td>" + String(entry.breaker.getTrips()) + "</td>";
+      html += "<td>" + String(entry.breaker.remainingOpen(now) / 1000) + " s</td>";
+      html += "<td>" + String(entry.lastVoltage, 2) + " V</td></tr>";
+    }
+    html += "</table>";
+  } else {
+    html += "<p>No vehicles yet</p>";
+  }
+  
+  html += "<p><a href=\"/\">Back to status page</a></p>";
   html += "</body></html>";
   server.send(200, "text/html", html);
 }
 
+// Forget all cached vehicle names so the next refresh fetches them again
+void handleRefreshNames() {
+  VehicleNameCache::getInstance()->invalidateAll();
+  server.sendHeader("Location", "/");
+  server.send(303, "text/plain", "Vehicle names will be refreshed");
+}
+
 // Handle reboot request
 void handleReboot() {
   server.send(200, "text/html", "<html><body><h1>Rebooting...</h1><p>Device will restart in a few seconds.</p><p><a href=\"/\">Back to status page</a></p></body></html>");
@@ -365,350 +489,425 @@ void handleReboot() {
   ESP.restart();
 }
 
-// Function to draw UI on the display
-void drawUI() {
-  display.setFullWindow();
-  display.firstPage();
-  do {
-    // Set display to white background
-    display.fillScreen(GxEPD_WHITE);
-    
-    // Draw battery voltage at top
-    float voltage = BatteryDisplay::getInstance()->getVoltage();
-    batteryVoltage = voltage; // Store for web server
-    char batteryBuffer[16];
-    int voltsInt = (int)voltage;
-    int voltsDec = (int)((voltage - voltsInt) * 100);
-    snprintf(batteryBuffer, sizeof(batteryBuffer), "%d.%02dV", voltsInt, voltsDec);
-    
-    // Use monospace font for battery (keeps digits aligned)
-    display.setFont(&FreeSansBold18pt7b);
-    display.setTextColor(GxEPD_BLACK);
-    display.setCursor(0, 50);
-    display.setTextSize(2);
-    display.print(batteryBuffer);
-    
-    // Draw mavlink status - up to 3 vehicles
-    int n = MDNS.queryService("mavlink", "udp");
-    int yPos = 80; // Start higher up since we removed the "Vehicle" label
-    
-    // Reset vehicle count for web server
-    vehicleCount = 0;
+// Gather all data shown on screen: battery, vehicles and WiFi state.
+// This is the only stage that touches the network.
+TelemetrySnapshot collectTelemetry() {
+  TelemetrySnapshot snapshot = {};
+  
+  snapshot.batteryVoltage = BatteryDisplay::getInstance()->getVoltage();
+  snapshot.batteryCharge = chargeMonitorWatch();
+  snapshot.wifiConnected = (WiFi.status() == WL_CONNECTED);
+  snapshot.ipAddress = ipAddress;
+  snapshot.vehicleCount = 0;
+  
+  // Read the discovery table, kept up to date in the background
+  DiscoveredVehicle discovered[MAX_VEHICLES];
+  int vehicleCount = VehicleDiscovery::getInstance()->getVehicles(discovered, MAX_VEHICLES);
+  
+  String vehicleIPs[MAX_VEHICLES];
+  for (int i = 0; i < vehicleCount; i++) {
+    vehicleIPs[i] = discovered[i].ip;
+  }
+  
+  // Keep one BATTERY_STATUS subscription per discovered vehicle
+  BatteryStream::getInstance()->setVehicles(vehicleIPs, vehicleCount);
+#if MAVLINK_UDP_ENABLED
+  MavlinkUdpSource::getInstance()->setVehicles(discovered, vehicleCount);
+#endif
+  
+  // Fetch names and voltages of all vehicles in parallel
+  VehicleFetchResult results[MAX_VEHICLES];
+  VehicleFetcher::getInstance()->fetchAll(vehicleIPs, vehicleCount, results);
+  
+  for (int i = 0; i < vehicleCount; i++) {
+    VehicleTelemetry& vehicle = snapshot.vehicles[snapshot.vehicleCount++];
+    vehicle.ip = vehicleIPs[i];
+    vehicle.name = results[i].name;
+    vehicle.voltage = results[i].voltage;
+    vehicle.stale = results[i].stale;
     
-    if (n > 0) {
-      // Array to store unique IP addresses
-      String uniqueIPs[3]; // Store up to 3 unique IPs
-      int uniqueCount = 0;
-      
-      // Find unique IP addresses
-      for (int i = 0; i < n && uniqueCount < 3; i++) {
-        String currentIP = MDNS.IP(i).toString();
-        
-        // Filter out invalid IPs like 0.0.0.0 early
-        if (currentIP == "0.0.0.0" || currentIP.length() == 0) {
-          Serial.println("Skipping invalid IP: " + currentIP);
-          continue;
-        }
-        
-        bool isDuplicate = false;
-        
-        // Check if this IP is already in our unique list
-        for (int j = 0; j < uniqueCount; j++) {
-          if (currentIP == uniqueIPs[j]) {
-            isDuplicate = true;
-            break;
-          }
-        }
-        
-        // If not a duplicate, add to our list
-        if (!isDuplicate) {
-          uniqueIPs[uniqueCount++] = currentIP;
-          Serial.println("Found unique vehicle IP: " + currentIP);
-        }
-      }
-      
-      // Display unique vehicles and fetch their voltages
-      // Use proportional font for vehicle names and voltage display
-      display.setFont(&FreeMonoBold12pt7b);
-      display.setTextSize(1); // Using a larger font but smaller text size for better clarity
-      
-      for (int i = 0; i < uniqueCount; i++) {
-        // Get vehicle name
-        String vehicleName = getVehicleName(uniqueIPs[i]);
-        
-        // Truncate name even more to fit display at larger text size (max 8 chars)
-        if (vehicleName.length() > 7) {
-          vehicleName = vehicleName.substring(0, 7);
-        }
-        
-        // Get battery voltage from the vehicle
-        float batteryVoltage = getMavlinkBatteryVoltage(uniqueIPs[i]);
-        
-        // Store for web server
-        vehicleNames[vehicleCount] = vehicleName;
-        vehicleVoltages[vehicleCount] = batteryVoltage;
-        vehicleCount++;
-        
-        // Display the name and battery voltage
-        char vehicleBuffer[32];
-        if (batteryVoltage > 0) {
-          snprintf(vehicleBuffer, sizeof(vehicleBuffer), "%s %.1fV", vehicleName.c_str(), batteryVoltage);
-        } else {
-          snprintf(vehicleBuffer, sizeof(vehicleBuffer), "%s: --", vehicleName.c_str());
-        }
-        
-        display.setCursor(0, yPos);
-        display.print(vehicleBuffer);
-        yPos += 35; // Adjusted spacing for proportional font
-      }
-      
-      if (uniqueCount == 0) {
-        display.setCursor(4, yPos);
-        display.print("No vehicles");
-      }
-    } else {
-      // Use proportional font
-      display.setFont(&FreeMonoBold12pt7b);
-      display.setTextSize(1);
-      display.setCursor(4, yPos);
-      display.print("No vehicles");
+    // Last known values of unreachable vehicles are not new samples
+    if (!vehicle.stale) {
+      chargeMonitorRecordVehicle(vehicle.ip, vehicle.voltage);
     }
+    vehicle.charge = chargeMonitorVehicle(vehicle.ip);
+  }
+  
+  rtcState.fetchCount++;
+  
+  snapshot.collectedAt = millis();
+  snapshot.uptimeMinutes = rtcStateUptimeMs() / 60000; // Convert milliseconds to minutes, deep sleep included
+  
+  return snapshot;
+}
+
+// Unchanging parts of the screens, pre-rendered by buildStaticLayers() and copied in with memcpy
+StaticLayer wifiChromeLayer = {};
+StaticLayer sleepChromeLayer = {};
+
+// WiFi icon and SSID of the status screen footer
+void drawWifiChrome(FrameBuffer& frame) {
+  frame.drawBitmap(4, 165, WIFI_ICON, 20, 20, GxEPD_BLACK);
+  frame.setFont(&FreeSans9pt7b);
+  frame.setTextSize(1);
+  frame.setTextColor(GxEPD_BLACK);
+  frame.setCursor(30, 179);
+  frame.print(WIFI_SSID);
+}
+
+// "OFF" of the sleep screen
+void drawSleepChrome(FrameBuffer& frame) {
+  frame.setFont(&FreeSansBold18pt7b);
+  frame.setTextSize(1);
+  frame.setTextColor(GxEPD_BLACK);
+  frame.setCursor(10, 120);
+  frame.print("OFF");
+}
+
+// Layers are built from a white page with the chrome drawn on it
+void renderWifiChrome(FrameBuffer& frame, const void* context) {
+  frame.fillScreen(GxEPD_WHITE);
+  drawWifiChrome(frame);
+}
+
+void renderSleepChrome(FrameBuffer& frame, const void* context) {
+  frame.fillScreen(GxEPD_WHITE);
+  drawSleepChrome(frame);
+}
+
+// Pre-render the chrome once; without memory the screens draw it from primitives instead
+void buildStaticLayers() {
+  buildStaticLayer(wifiChromeLayer, 160, 26, renderWifiChrome, nullptr);
+  buildStaticLayer(sleepChromeLayer, 92, 30, renderSleepChrome, nullptr);
+}
+
+// Draw the status screen for a TelemetrySnapshot.
+// Pure function of its input, so it can run once per page or partial window.
+void renderStatusScreen(FrameBuffer& frame, const void* context) {
+  const TelemetrySnapshot& snapshot = *(const TelemetrySnapshot*)context;
+  
+  // Set display to white background, with the pre-rendered WiFi icon and SSID
+  frame.fillScreen(GxEPD_WHITE);
+  if (snapshot.wifiConnected && !frame.drawLayer(wifiChromeLayer)) {
+    drawWifiChrome(frame);
+  }
+  
+  // Draw battery voltage at top
+  float voltage = snapshot.batteryVoltage;
+  char batteryBuffer[16];
+  int voltsInt = (int)voltage;
+  int voltsDec = (int)((voltage - voltsInt) * 100);
+  snprintf(batteryBuffer, sizeof(batteryBuffer), "%d.%02dV", voltsInt, voltsDec);
+  
+  frame.setFont(&FreeSansBold18pt7b);
+  frame.setTextColor(GxEPD_BLACK);
+  frame.setCursor(0, 50);
+  frame.setTextSize(2);
+  frame.print(batteryBuffer);
+  
+  // The voltage fills the width, the charge and what it is doing go on a small line below
+  const ChargeEstimate& charge = snapshot.batteryCharge;
+  if (charge.soc >= 0) {
+    char chargeStatus[32];
+    char chargeBuffer[40];
+    formatChargeStatus(charge, chargeStatus, sizeof(chargeStatus));
+    snprintf(chargeBuffer, sizeof(chargeBuffer), "%d%%  %s", (int)(charge.soc + 0.5f), chargeStatus);
+    frame.setFont(&FreeSans9pt7b);
+    frame.setTextSize(1);
+    frame.setCursor(0, 66);
+    frame.print(chargeBuffer);
+  }
+  
+  // Draw mavlink status - up to DISPLAY_VEHICLE_ROWS vehicles
+  int yPos = 88; // Below the charge line
+  
+  // Use proportional font for vehicle names and voltage display
+  frame.setFont(&FreeMonoBold12pt7b);
+  frame.setTextSize(1); // Using a larger font but smaller text size for better clarity
+  
+  for (int i = 0; i < snapshot.vehicleCount && i < DISPLAY_VEHICLE_ROWS; i++) {
+    const VehicleTelemetry& vehicle = snapshot.vehicles[i];
     
-    // Draw WiFi status with icon and SSID
-    display.setFont(&FreeSans9pt7b); // Use smaller proportional font for WiFi info
-    display.setTextSize(1);
-    wifiConnected = (WiFi.status() == WL_CONNECTED);
+    // Truncate name even more to fit display at larger text size (max 8 chars)
+    String vehicleName = vehicle.name;
+    if (vehicleName.length() > 7) {
+      vehicleName = vehicleName.substring(0, 7);
+    }
     
-    if (wifiConnected) {
-      // Draw WiFi icon
-      display.drawBitmap(4, 165, WIFI_ICON, 20, 20, GxEPD_BLACK);
-      
-      // Draw SSID
-      display.setCursor(30, 179);
-      display.print(WIFI_SSID);
-      
-      // Draw IP address below SSID
-      display.setCursor(30, 197);
-      display.print(ipAddress);
+    // Display the name and the state of charge, or the voltage until the charge is known
+    char vehicleBuffer[32];
+    if (vehicle.voltage > 0 && vehicle.charge.soc >= 0) {
+      snprintf(vehicleBuffer, sizeof(vehicleBuffer), "%s %d%%%s", vehicleName.c_str(), (int)(vehicle.charge.soc + 0.5f),
+               vehicle.stale ? "*" : "");
+    } else if (vehicle.voltage > 0) {
+      // A trailing * marks a last known value of an unreachable vehicle
+      snprintf(vehicleBuffer, sizeof(vehicleBuffer), "%s %.1fV%s", vehicleName.c_str(), vehicle.voltage,
+               vehicle.stale ? "*" : "");
     } else {
-      display.setCursor(4, 180);
-      display.print("WiFi: ----");
+      snprintf(vehicleBuffer, sizeof(vehicleBuffer), "%s: --", vehicleName.c_str());
     }
     
-    // Add uptime in minutes on the lower right corner
-    deviceUptime = millis() / 60000; // Convert milliseconds to minutes
-    char uptimeBuffer[16];
-    snprintf(uptimeBuffer, sizeof(uptimeBuffer), "%lum", deviceUptime);
-    
-    int16_t tbx, tby;
-    uint16_t tbw, tbh;
-    display.getTextBounds(uptimeBuffer, 0, 0, &tbx, &tby, &tbw, &tbh);
-    display.setCursor(display.width() - tbw - 5, 180); // Position on lower right
-    display.print(uptimeBuffer);
+    frame.setCursor(0, yPos);
+    frame.print(vehicleBuffer);
     
-  } while (display.nextPage());
+    // Time to empty in small print at the right end of the row, when it fits
+    if (vehicle.charge.minutesToEmpty >= 0 && !vehicle.stale) {
+      char duration[16];
+      formatDuration(vehicle.charge.minutesToEmpty, duration, sizeof(duration));
+      int16_t textEnd = frame.getCursorX();
+      int16_t dx, dy;
+      uint16_t dw, dh;
+      frame.setFont(&FreeSans9pt7b);
+      frame.getTextBounds(duration, 0, 0, &dx, &dy, &dw, &dh);
+      if (textEnd + 4 + dw <= frame.width()) {
+        frame.setCursor(frame.width() - dw - 1, yPos);
+        frame.print(duration);
+      }
+      frame.setFont(&FreeMonoBold12pt7b);
+    }
+    yPos += 32; // Three rows between the charge line and the footer
+  }
+  
+  if (snapshot.vehicleCount == 0) {
+    frame.setCursor(4, yPos);
+    frame.print("No vehicles");
+  }
+  
+  // Draw WiFi status with icon and SSID
+  frame.setFont(&FreeSans9pt7b); // Use smaller proportional font for WiFi info
+  frame.setTextSize(1);
+  
+  if (snapshot.wifiConnected) {
+    // Draw IP address below the SSID
+    frame.setCursor(30, 197);
+    frame.print(snapshot.ipAddress);
+  } else {
+    frame.setCursor(4, 180);
+    frame.print("WiFi: ----");
+  }
+  
+  // Add uptime in minutes on the lower right corner, the web page has it to the minute
+  char uptimeBuffer[16];
+  snprintf(uptimeBuffer, sizeof(uptimeBuffer), "%lum",
+           snapshot.uptimeMinutes - snapshot.uptimeMinutes % STATUS_UPTIME_STEP_MINUTES);
+  
+  int16_t tbx, tby;
+  uint16_t tbw, tbh;
+  frame.getTextBounds(uptimeBuffer, 0, 0, &tbx, &tby, &tbw, &tbh);
+  frame.setCursor(frame.width() - tbw - 5, 180); // Position on lower right
+  frame.print(uptimeBuffer);
+}
+
+// Function to draw UI on the display
+void drawUI() {
+  // Collect first, then publish the finished snapshot in one assignment
+  TelemetrySnapshot snapshot = collectTelemetry();
+  
+  // The display task may still be drawing the previous snapshot
+  DisplayUpdater::getInstance()->waitUntilIdle();
+  latestSnapshot = snapshot;
+  
+  // Only the regions whose pixels differ from the panel reach it; the update runs in the background
+  DisplayUpdater::getInstance()->present(renderStatusScreen, &latestSnapshot, STATUS_REGIONS, STATUS_REGION_COUNT);
 }
 
-// Function to check WiFi connection and reconnect if needed
-bool checkAndReconnectWiFi() {
-  if (WiFi.status() != WL_CONNECTED) {
-    // If this is a new disconnection, record the time
-    if (wifiDisconnectedTime == 0) {
-      wifiDisconnectedTime = millis();
-      reconnectionAttempts = 0;
-      Serial.println("WiFi disconnected, starting reconnection attempts...");
+// Go to deep sleep, keeping the time base in RTC memory
+void enterDeepSleep(uint64_t durationUs) {
+  // The image stays on the panel for the whole sleep, a long one starts without ghosting
+  DisplayUpdater::getInstance()->prepareForSleep(durationUs / 1000);
+  
+  // The sleep is charged as planned, a button wake cuts it short like it does the time base
+  powerChargeSleep(durationUs / 1000);
+  powerLogEnergy();
+  rtcState.elapsedMs += millis() + durationUs / 1000;
+  
+  // Configure wake up source as timer
+  esp_sleep_enable_timer_wakeup(durationUs);
+  
+  // MENU wakes the watch into always-on mode (Watchy buttons read HIGH when pressed)
+  esp_sleep_enable_ext0_wakeup((gpio_num_t)BUTTON_MENU, 1);
+  
+  // Go to deep sleep
+  esp_deep_sleep_start();
+}
+
+// Remember the vehicles, their last values and what was learned about their reachability for the next wake
+void saveToRtc(const TelemetrySnapshot& snapshot) {
+  DiscoveredVehicle discovered[MAX_VEHICLES];
+  int count = VehicleDiscovery::getInstance()->getVehicles(discovered, MAX_VEHICLES);
+  uint64_t uptimeMs = rtcStateUptimeMs();
+  
+  rtcState.vehicleCount = 0;
+  for (int i = 0; i < count; i++) {
+    IPAddress address;
+    if (!address.fromString(discovered[i].ip)) {
+      continue;
     }
+    RtcVehicle& saved = rtcState.vehicles[rtcState.vehicleCount++];
+    saved.ip = (uint32_t)address;
+    saved.port = discovered[i].port;
+    saved.name[0] = '\0';
+    saved.nameFetchedAtMs = 0;
+    saved.lastVoltage = -1.0f;
     
-    // First scan for the WiFi network
-    Serial.println("Scanning for WiFi networks...");
-    int n = WiFi.scanNetworks();
-    Serial.printf("Scan complete, %d networks found\n", n);
-    
-    bool networkFound = false;
-    for (int i = 0; i < n && !networkFound; i++) {
-      Serial.printf("  %d: %s (%d dBm)\n", i + 1, WiFi.SSID(i).c_str(), WiFi.RSSI(i));
-      if (WiFi.SSID(i) == WIFI_SSID) {
-        networkFound = true;
-        Serial.printf("Target network '%s' found with signal strength %d dBm\n", WIFI_SSID, WiFi.RSSI(i));
-      }
+    // Only fetched names are kept, with their age, never the placeholder
+    String name;
+    unsigned long nameAgeMs;
+    if (VehicleNameCache::getInstance()->getStale(discovered[i].ip, name, &nameAgeMs)) {
+      strlcpy(saved.name, name.c_str(), sizeof(saved.name));
+      saved.nameFetchedAtMs = uptimeMs > nameAgeMs ? uptimeMs - nameAgeMs : 0;
     }
     
-    if (!networkFound) {
-      Serial.printf("Target network '%s' not found in scan results\n", WIFI_SSID);
-      
-      // Get current battery voltage
-      float voltage = BatteryDisplay::getInstance()->getVoltage();
-      char batteryBuffer[16];
-      int voltsInt = (int)voltage;
-      int voltsDec = (int)((voltage - voltsInt) * 100);
-      snprintf(batteryBuffer, sizeof(batteryBuffer), "%d.%02dV", voltsInt, voltsDec);
-      
-      // Display sleep message on screen with battery voltage
-      display.setFullWindow();
-      display.firstPage();
-      do {
-        display.fillScreen(GxEPD_WHITE);
-        display.setTextColor(GxEPD_BLACK);
-        
-        // Draw battery voltage in the same position as regular UI
-        display.setFont(&FreeSansBold18pt7b);
-        display.setCursor(0, 50);
-        display.setTextSize(2);
-        display.print(batteryBuffer);
-        
-        // Draw sleep message
-        display.setFont(&FreeSansBold18pt7b);
-        display.setCursor(10, 120);
-        display.setTextSize(1);
-        display.println("OFF");
-        
-        display.setCursor(10, 160);
-        display.setFont(&FreeSansBold9pt7b);
-        display.println("No WiFi found");
-        display.setCursor(10, 180);
-        display.println("Sleeping for 60s...");
-      } while (display.nextPage());
-      
-      Serial.println("Going to deep sleep for 60 seconds...");
-      delay(1000); // Give time for serial output and display to complete
-      
-      // Configure wake up source as timer
-      esp_sleep_enable_timer_wakeup(WIFI_DEEP_SLEEP_DURATION);
-      
-      // Go to deep sleep
-      esp_deep_sleep_start();
-      
-      // Code will continue from setup() after waking up
-      return false; // This line won't actually execute due to deep sleep
+    for (int j = 0; j < snapshot.vehicleCount; j++) {
+      const VehicleTelemetry& vehicle = snapshot.vehicles[j];
+      if (vehicle.ip == discovered[i].ip) {
+        saved.lastVoltage = vehicle.voltage;
+        break;
+      }
     }
     
-    // Increment attempt counter
-    reconnectionAttempts++;
-    
-    Serial.printf("WiFi network found, attempt %d of %d to connect...\n", 
-                 reconnectionAttempts, MAX_RECONNECTION_ATTEMPTS);
-    
-    WiFi.disconnect();
-    WiFi.mode(WIFI_STA);
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    VehicleHealthTable::getInstance()->saveBreaker(discovered[i].ip, uptimeMs, saved.breaker);
+    memset(saved.services, 0, sizeof(saved.services));
+    AdaptiveTimeouts::getInstance()->saveHost(discovered[i].ip, saved.services, RTC_VEHICLE_SERVICES);
+  }
+}
+
+// Seed discovery, name cache, last values, breakers and timeouts from the previous wake
+void restoreFromRtc() {
+  DiscoveredVehicle seeded[MAX_VEHICLES];
+  int count = min((int)rtcState.vehicleCount, MAX_VEHICLES);
+  uint64_t uptimeMs = rtcStateUptimeMs();
+  VehicleNameCache* names = VehicleNameCache::getInstance();
+  
+  for (int i = 0; i < count; i++) {
+    const RtcVehicle& saved = rtcState.vehicles[i];
+    seeded[i].ip = IPAddress(saved.ip).toString();
+    seeded[i].port = saved.port;
+    seeded[i].lastSeen = 0;
     
-    // Wait briefly for connection
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 10) {
-      delay(500);
-      Serial.print(".");
-      attempts++;
+    // Restored at its real age: an expired name is still shown while it is fetched again
+    if (saved.name[0] != '\0') {
+      uint64_t ageMs = uptimeMs > saved.nameFetchedAtMs ? uptimeMs - saved.nameFetchedAtMs : 0;
+      names->put(seeded[i].ip, saved.name, (unsigned long)min(ageMs, (uint64_t)names->getTtl()));
     }
-    
-    if (WiFi.status() == WL_CONNECTED) {
-      // Reset the disconnection timer and attempt counter since we're connected again
-      wifiDisconnectedTime = 0;
-      reconnectionAttempts = 0;
-      
-      ipAddress = WiFi.localIP().toString(); // Update IP address variable
-      Serial.println("\nWiFi reconnected");
-      Serial.print("IP address: ");
-      Serial.println(ipAddress);
-      
-      // Restart mDNS service after reconnecting
-      MDNS.end();
-      if (MDNS.begin(OTA_HOSTNAME)) {
-        Serial.println("mDNS responder restarted");
-      } else {
-        Serial.println("Error restarting mDNS responder");
+    VehicleHealthTable::getInstance()->restoreLastVoltage(seeded[i].ip, saved.lastVoltage);
+    VehicleHealthTable::getInstance()->restoreBreaker(seeded[i].ip, uptimeMs, saved.breaker);
+    for (int j = 0; j < RTC_VEHICLE_SERVICES; j++) {
+      // Bounds of this build, a service no longer requested is dropped
+      uint32_t maxTimeout = vehicleServiceMaxTimeout(saved.services[j].port);
+      if (maxTimeout > 0) {
+        AdaptiveTimeouts::getInstance()->restoreService(seeded[i].ip, saved.services[j], maxTimeout);
       }
-      
-      return true; // Return true to indicate successful connection
-    } else if (reconnectionAttempts >= MAX_RECONNECTION_ATTEMPTS) {
-      // We've tried enough times, go to deep sleep to save power
-      Serial.println("Maximum WiFi reconnection attempts reached.");
-      
-      // Get current battery voltage
-      float voltage = BatteryDisplay::getInstance()->getVoltage();
-      char batteryBuffer[16];
-      int voltsInt = (int)voltage;
-      int voltsDec = (int)((voltage - voltsInt) * 100);
-      snprintf(batteryBuffer, sizeof(batteryBuffer), "%d.%02dV", voltsInt, voltsDec);
-      
-      // Display sleep message on screen with battery voltage
-      display.setFullWindow();
-      display.firstPage();
-      do {
-        display.fillScreen(GxEPD_WHITE);
-        display.setTextColor(GxEPD_BLACK);
-        
-        // Draw battery voltage in the same position as regular UI
-        display.setFont(&FreeSansBold18pt7b);
-        display.setCursor(0, 50);
-        display.setTextSize(2);
-        display.print(batteryBuffer);
-        
-        // Draw sleep message
-        display.setFont(&FreeSansBold18pt7b);
-        display.setCursor(10, 120);
-        display.setTextSize(1);
-        display.println("OFF");
-        
-        display.setCursor(10, 160);
-        display.setFont(&FreeSansBold9pt7b);
-        display.println("WiFi connect failed");
-        display.setCursor(10, 180);
-        display.println("Sleeping for 60s...");
-      } while (display.nextPage());
-      
-      Serial.println("Going to deep sleep for 60 seconds to save power...");
-      delay(1000); // Give time for serial output and display to complete
-      
-      // Configure wake up source as timer
-      esp_sleep_enable_timer_wakeup(WIFI_DEEP_SLEEP_DURATION);
-      
-      // Go to deep sleep
-      esp_deep_sleep_start();
-      
-      // Code will continue from setup() after waking up
-      return false; // This line won't actually execute due to deep sleep
     }
-    
-    return false; // Return false to indicate connection failed
-  } else {
-    // We're connected, reset the disconnection timer and attempt counter
-    wifiDisconnectedTime = 0;
-    reconnectionAttempts = 0;
-    
-    // Print IP address 
-    ipAddress = WiFi.localIP().toString();
-    Serial.print("WiFi connected. IP address: ");
-    Serial.println(ipAddress);
-    
-    return true; // Return true to indicate already connected
   }
+  VehicleDiscovery::getInstance()->seed(seeded, count);
+  
+  Serial.printf("Restored %d vehicles from RTC memory\n", count);
 }
 
-// Setup WiFi and OTA updates
-bool setupWiFiAndOTA() {
-  // Try to connect using the common reconnect function
-  bool connected = checkAndReconnectWiFi();
+// Bring the link-level services back up after the link was (re-)established
+void onWiFiConnected() {
+  ipAddress = WiFi.localIP().toString(); // Update IP address variable
+  Serial.println("\nWiFi connected");
+  Serial.print("IP address: ");
+  Serial.println(ipAddress);
   
-  // If connection failed, the function will go to deep sleep
-  // so we won't reach this point unless we're connected
-  if (!connected) {
-    return false;
-  }
+  // Sockets opened on the previous link are dead
+  HttpConnectionPool::getInstance()->closeAll();
   
-  // Set up mDNS responder
+  // (Re)start the mDNS responder on the new link, never under a running discovery query
+  VehicleDiscovery::getInstance()->pause();
+  MDNS.end();
   if (MDNS.begin(OTA_HOSTNAME)) {
-    Serial.println("mDNS responder started");
     // Explicitly advertise the OTA service
     MDNS.addService("arduino", "tcp", 3232);
     Serial.printf("You can update firmware using: %s.local\n", OTA_HOSTNAME);
   } else {
     Serial.println("Error starting mDNS responder");
   }
+  VehicleDiscovery::getInstance()->resume();
   
-  // Initialize OTA
+  // Refresh the vehicle table on the new link right away
+  VehicleDiscovery::getInstance()->requestQuery();
+  
+  // The network is back: short sleeps next time it goes away, and the status screen replaces "OFF"
+  sleepPolicyRecordSuccess(rtcState.sleepPolicy, rtcStateUptimeMs());
+}
+
+// Text of the sleep screen, global because the display task draws it after drawSleepScreen() returned
+struct SleepScreen {
+  char battery[16];
+  const char* message;
+  char sleep[32];
+};
+SleepScreen sleepScreen;
+
+// Draw the sleep screen for a SleepScreen, pure like renderStatusScreen()
+void renderSleepScreen(FrameBuffer& frame, const void* context) {
+  const SleepScreen& screen = *(const SleepScreen*)context;
+  
+  frame.fillScreen(GxEPD_WHITE);
+  if (!frame.drawLayer(sleepChromeLayer)) {
+    drawSleepChrome(frame);
+  }
+  frame.setTextColor(GxEPD_BLACK);
+  
+  // Draw battery voltage in the same position as regular UI
+  frame.setFont(&FreeSansBold18pt7b);
+  frame.setCursor(0, 50);
+  frame.setTextSize(2);
+  frame.print(screen.battery);
+  
+  // Draw sleep message below the "OFF" chrome
+  frame.setTextSize(1);
+  frame.setCursor(10, 160);
+  frame.setFont(&FreeSansBold9pt7b);
+  frame.println(screen.message);
+  frame.setCursor(10, 180);
+  frame.println(screen.sleep);
+}
+
+// Show why the watch is going to sleep, with the battery voltage where the UI has it
+void drawSleepScreen(const char* message, uint32_t sleepMs) {
+  DisplayUpdater::getInstance()->waitUntilIdle();
+  
+  float voltage = BatteryDisplay::getInstance()->getVoltage();
+  int voltsInt = (int)voltage;
+  int voltsDec = (int)((voltage - voltsInt) * 100);
+  snprintf(sleepScreen.battery, sizeof(sleepScreen.battery), "%d.%02dV", voltsInt, voltsDec);
+  
+  sleepScreen.message = message;
+  if (sleepMs < 120000) {
+    snprintf(sleepScreen.sleep, sizeof(sleepScreen.sleep), "Sleeping for %lus...", (unsigned long)(sleepMs / 1000));
+  } else {
+    snprintf(sleepScreen.sleep, sizeof(sleepScreen.sleep), "Sleeping for %lum...", (unsigned long)(sleepMs / 60000));
+  }
+  
+  // E-paper keeps its image through deep sleep, an identical screen is not refreshed again
+  DisplayUpdater::getInstance()->present(renderSleepScreen, &sleepScreen);
+}
+
+// The WiFi manager gave up: sleep to save power, longer the longer the network stays away
+void onWiFiUnavailable(WiFiUnavailableReason reason) {
+  uint32_t sleepMs = sleepPolicyRecordFailure(rtcState.sleepPolicy, rtcStateUptimeMs());
+  drawSleepScreen(reason == WIFI_NETWORK_NOT_FOUND ? "No WiFi found" : "WiFi connect failed", sleepMs);
+  
+  Serial.printf("Network absent %u times in a row, going to deep sleep for %lu s...\n",
+                rtcState.sleepPolicy.consecutiveFailures, (unsigned long)(sleepMs / 1000));
+  Serial.flush();
+  
+  // Code will continue from setup() after waking up
+  enterDeepSleep((uint64_t)sleepMs * 1000);
+}
+
+// Set up OTA updates
+void setupOTA() {
   ArduinoOTA.setHostname(OTA_HOSTNAME);
   
+  // Full clock while an image comes in; the lock is never released on success since the watch reboots
   ArduinoOTA.onStart([]() {
+    otaInProgress = true;
+    powerLock(POWER_OTA);
     Serial.println("OTA update starting...");
   });
   
@@ -721,6 +920,8 @@ bool setupWiFiAndOTA() {
   });
   
   ArduinoOTA.onError([](ota_error_t error) {
+    otaInProgress = false;
+    powerUnlock(POWER_OTA);
     Serial.printf("Error[%u]: ", error);
     if (error == OTA_AUTH_ERROR) Serial.println("Auth Failed");
     else if (error == OTA_BEGIN_ERROR) Serial.println("Begin Failed");
@@ -731,22 +932,90 @@ bool setupWiFiAndOTA() {
   
   ArduinoOTA.begin();
   Serial.println("OTA setup complete");
-  
-  return true;
 }
 
 // Function to setup web server
 void setupWebServer() {
-  server.on("/", handleRoot);
-  server.on("/reboot", handleReboot);
+  const struct {
+    const char* uri;
+    void (*handler)();
+  } routes[] = {
+    { "/", handleRoot },
+    { "/diag", handleDiagnostics },
+    { "/api/battery", handleBatteryApi },
+    { "/refresh-names", handleRefreshNames },
+    { "/reboot", handleReboot }
+  };
+  
+  // Every request keeps the loop polling the server quickly for a while
+  for (const auto& route : routes) {
+    void (*handler)() = route.handler;
+    server.on(route.uri, [handler]() {
+      lastWebRequestMs = millis();
+      handler();
+    });
+  }
   server.begin();
   Serial.println("Web server started");
 }
 
+// Start everything that needs the network, once, after the first connection
+void startServices() {
+  setupOTA();
+  setupWebServer();
+  
+  // Start background vehicle discovery; its first query is awaited by loop()
+  VehicleDiscovery::getInstance()->begin();
+  
+  // Start streaming battery updates from mavlink2rest
+  BatteryStream::getInstance()->begin();
+#if MAVLINK_UDP_ENABLED
+  // And listen to the vehicles' MAVLink UDP endpoints directly
+  MavlinkUdpSource::getInstance()->begin();
+#endif
+  
+  servicesStarted = true;
+}
+
+#if DUTY_CYCLE_MODE
+// One wake of duty-cycle mode: reconnect, fetch, render and sleep until the next interval
+void runDutyCycle() {
+  rtcState.wakeCount++;
+  
+  // Nothing else to do until the link is up; the manager deep sleeps when the network is absent
+  while (!WiFiManager::getInstance()->isConnected()) {
+    WiFiManager::getInstance()->poll();
+    delay(10);
+  }
+  
+  // Only ask mDNS when nothing is remembered or the table got old
+  if (rtcState.vehicleCount == 0 || rtcState.wakesSinceDiscovery >= DUTY_CYCLE_REDISCOVER_WAKES) {
+    VehicleDiscovery::getInstance()->queryNow();
+    rtcState.wakesSinceDiscovery = 0;
+  } else {
+    rtcState.wakesSinceDiscovery++;
+  }
+  
+  drawUI();
+  saveToRtc(latestSnapshot);
+  
+  // Keep the wake period constant regardless of how long this cycle took
+  unsigned long awakeMs = millis();
+  unsigned long sleepMs = awakeMs < DUTY_CYCLE_INTERVAL_MS ? DUTY_CYCLE_INTERVAL_MS - awakeMs : 1000;
+  Serial.printf("Duty cycle done in %lu ms, sleeping for %lu ms\n", awakeMs, sleepMs);
+  Serial.flush();
+  
+  enterDeepSleep((uint64_t)sleepMs * 1000);
+}
+#endif
+
 // Arduino setup function
 void setup() {
   Serial.begin(115200);
   Serial.println("Starting Watchy without LVGL application");
+  
+  // Scale the clock down and light sleep between events, before anything takes a power lock
+  powerManagerBegin();
 
   // Setup button pins with pullups
   pinMode(BUTTON_BACK, INPUT_PULLUP);
@@ -757,55 +1026,104 @@ void setup() {
   // Initialize SPI for the display
   SPI.begin(18, 19, 23, DISPLAY_CS); // SCK, MISO, MOSI, SS
   
-  // Initialize the e-paper display
-  display.init(115200);
-  display.setRotation(0);
-  display.setTextColor(GxEPD_BLACK);
-  display.setFont(&FreeMonoBold9pt7b);
+  // Initialize the e-paper display, updates run on their own task woken by the BUSY pin.
+  // After a deep sleep wake the controller still holds the frame on the panel: without
+  // the initial full refresh, the first update may be partial.
+  esp_sleep_wakeup_cause_t wakeCause = esp_sleep_get_wakeup_cause();
+  bool panelRetained = wakeCause == ESP_SLEEP_WAKEUP_TIMER || wakeCause == ESP_SLEEP_WAKEUP_EXT0;
+  panel.init(115200, !panelRetained);
+  DisplayUpdater::getInstance()->begin();
+  buildStaticLayers();
   
-  // Initialize battery monitor (do this early to get readings)
-  BatteryDisplay::getInstance();
+  // Start the vehicle fetch workers
+  VehicleFetcher::getInstance();
   
-  // Set up OTA update functionality using the reconnect function
-  // If WiFi is unavailable, this will go to deep sleep
-  if (!setupWiFiAndOTA()) {
-    // This code will actually never execute because deep sleep will restart the device
-    // But we include it for clarity
-    Serial.println("Failed to connect to WiFi, going to deep sleep");
-    return;
+  // Pick up counters and vehicles from before deep sleep
+  rtcStateInit();
+  if (panelRetained) {
+    DisplayUpdater::getInstance()->resume();
   }
   
-  // Setup web server
-  setupWebServer();
+  // Charge time to power states from here on, this boot included
+  powerAccountingBegin();
   
-  // Draw initial UI with real data
-  drawUI();
+  // Initialize battery monitor early, before the radio starts, continuing the filter from before deep sleep
+  BatteryDisplay::getInstance();
+  drawScheduleBegin(drawSchedule, millis());
+  
+  // Time the WiFi connection phases
+  wifiTimingBegin();
+  
+  // Start from the vehicles remembered before deep sleep
+  restoreFromRtc();
+  
+  // Start connecting, loop() advances the connection from WiFi events
+  powerStateLeave(ENERGY_BOOT);
+  WiFiManager::getInstance()->begin(WIFI_SSID, WIFI_PASSWORD, onWiFiConnected, onWiFiUnavailable);
+  
+#if DUTY_CYCLE_MODE
+  // A MENU press keeps the watch awake with web server and OTA, anything else is a duty cycle
+  if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_EXT0) {
+    runDutyCycle();
+  }
+#endif
   
   Serial.println("Setup complete");
 }
 
 // Arduino loop function
 void loop() {
-  static unsigned long lastDrawTime = 0;
-  static unsigned long lastWiFiCheck = 0;
+  static unsigned long lastEnergyLogTime = 0;
   unsigned long currentTime = millis();
-
-  // Check and reconnect WiFi if disconnected (every 15 seconds instead of 30)
-  if (currentTime - lastWiFiCheck >= 15000) {
-    checkAndReconnectWiFi();
-    lastWiFiCheck = currentTime;
+  
+  // Advance the WiFi connection, never blocks
+  WiFiManager::getInstance()->poll();
+  
+  if (!servicesStarted) {
+    if (!WiFiManager::getInstance()->isConnected()) {
+      delay(10);
+      return;
+    }
+    startServices();
+    drawScheduleServicesStarted(drawSchedule, currentTime, DISCOVERY_QUERY_TIMEOUT_MS + 1000);
   }
-
-  if (currentTime - lastDrawTime >= 60000 || BatteryDisplay::getInstance()->shouldUpdate()) {
-    drawUI();
-    lastDrawTime = currentTime;
+  
+  // Teach the sleep policy that this hour has the network too, once per hour slot
+  if (WiFiManager::getInstance()->isConnected()) {
+    sleepPolicyRecordConnected(rtcState.sleepPolicy, rtcStateUptimeMs());
   }
   
+  // A panel update still in flight owns the frame buffer, draw on a later iteration
+  if (!DisplayUpdater::getInstance()->isBusy()) {
+    // Give discovery one query to fill the table before the first screen
+    bool discoveryDone = drawSchedule.firstDrawPending && VehicleDiscovery::getInstance()->waitForFirstQuery(0);
+    bool sampleBattery = false;
+    if (drawScheduleDue(drawSchedule, currentTime, discoveryDone, sampleBattery)) {
+      if (sampleBattery) {
+        BatteryDisplay::getInstance()->updateVoltage();
+      }
+      drawUI();
+      saveToRtc(latestSnapshot);
+    }
+  }
+  
+  if (currentTime - lastEnergyLogTime >= POWER_ENERGY_LOG_INTERVAL_MS) {
+    powerLogEnergy();
+    lastEnergyLogTime = currentTime;
+  }
+  
+  // Take a battery sample put off while the radio was busy
+  BatteryDisplay::getInstance()->poll();
+  
   // Handle OTA updates - moved higher in the loop for priority
   ArduinoOTA.handle();
   
   // Handle web server client requests
   server.handleClient();
-
-  delay(10);  // Reduced from 50ms to 10ms to make the loop more responsive
-}
\ No newline at end of file
+  
+  // Sleep until the next draw is due, but no longer than LOOP_IDLE_MAX_MS
+  bool busy = !WiFiManager::getInstance()->isConnected() || DisplayUpdater::getInstance()->isBusy() ||
+              otaInProgress || millis() - lastWebRequestMs < LOOP_WEB_ACTIVE_MS;
+  uint32_t idleMs = busy ? 0 : drawScheduleIdleMs(drawSchedule, millis(), LOOP_IDLE_MAX_MS);
+  delay(max(idleMs, (uint32_t)LOOP_BUSY_DELAY_MS));
+}
@@ -0,0 +1,204 @@
+/**
+  ******************************************************************************
+  * @file    mavlink_parser.cpp
+  * @brief   Minimal MAVLink v2 frame parser for HEARTBEAT, SYS_STATUS and BATTERY_STATUS
+  ******************************************************************************
+*/
+
+#include "mavlink_parser.h"
+#include <string.h>
+
+#define MAVLINK_STX_V2 0xFD
+#define MAVLINK_HEADER_LENGTH 10 // Including the start byte
+#define MAVLINK_CHECKSUM_LENGTH 2
+#define MAVLINK_SIGNATURE_LENGTH 13
+#define MAVLINK_IFLAG_SIGNED 0x01
+
+// Full (untruncated) payload lengths
+#define HEARTBEAT_LENGTH 9
+#define SYS_STATUS_LENGTH 31
+#define BATTERY_STATUS_LENGTH 36
+
+// CRC_EXTRA seeds from the common message definitions
+#define HEARTBEAT_CRC_EXTRA 50
+#define SYS_STATUS_CRC_EXTRA 124
+#define BATTERY_STATUS_CRC_EXTRA 154
+
+// X.25 / CRC-16-MCRF4XX, as used by MAVLink
+static inline void crcAccumulate(uint8_t data, uint16_t& crc) {
+  uint8_t tmp = data ^ (uint8_t)(crc & 0xFF);
+  tmp ^= (tmp << 4);
+  crc = (crc >> 8) ^ ((uint16_t)tmp << 8) ^ ((uint16_t)tmp << 3) ^ (tmp >> 4);
+}
+
+static uint16_t crcCalculate(const uint8_t* data, size_t length) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crcAccumulate(data[i], crc);
+  }
+  return crc;
+}
+
+static inline uint16_t readU16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// @return CRC_EXTRA and full payload length of a supported message, false otherwise
+static bool lookupMessage(uint32_t messageId, uint8_t& crcExtra, uint8_t& fullLength) {
+  switch (messageId) {
+    case MAVLINK_MSG_ID_HEARTBEAT:
+      crcExtra = HEARTBEAT_CRC_EXTRA;
+      fullLength = HEARTBEAT_LENGTH;
+      return true;
+    case MAVLINK_MSG_ID_SYS_STATUS:
+      crcExtra = SYS_STATUS_CRC_EXTRA;
+      fullLength = SYS_STATUS_LENGTH;
+      return true;
+    case MAVLINK_MSG_ID_BATTERY_STATUS:
+      crcExtra = BATTERY_STATUS_CRC_EXTRA;
+      fullLength = BATTERY_STATUS_LENGTH;
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Payload is zero-padded to its full length, undoing v2 trailing-zero truncation
+static void decodePayload(const uint8_t* payload, MavlinkMessage& message) {
+  message.voltage = -1.0f;
+  message.batteryRemaining = -1;
+  
+  switch (message.messageId) {
+    case MAVLINK_MSG_ID_HEARTBEAT:
+      // uint32 custom_mode, uint8 type, autopilot, base_mode, system_status, mavlink_version
+      message.vehicleType = payload[4];
+      message.autopilot = payload[5];
+      message.baseMode = payload[6];
+      message.systemStatus = payload[7];
+      break;
+      
+    case MAVLINK_MSG_ID_SYS_STATUS: {
+      // voltage_battery (uint16, mV) at offset 14, battery_remaining (int8) at 30
+      uint16_t millivolts = readU16(payload + 14);
+      if (millivolts != 0 && millivolts != UINT16_MAX) {
+        message.voltage = millivolts / 1000.0f;
+      }
+      message.batteryRemaining = (int8_t)payload[30];
+      break;
+    }
+    
+    case MAVLINK_MSG_ID_BATTERY_STATUS: {
+      // voltages[10] (uint16, mV) at offset 10, id (uint8) at 32, battery_remaining (int8) at 35
+      uint16_t millivolts = readU16(payload + 10);
+      if (millivolts != 0 && millivolts != UINT16_MAX) {
+        message.voltage = millivolts / 1000.0f;
+      }
+      message.batteryId = payload[32];
+      message.batteryRemaining = (int8_t)payload[35];
+      break;
+    }
+  }
+}
+
+int mavlinkParseDatagram(const uint8_t* data, size_t length, MavlinkMessageHandler handler,
+                         void* context, MavlinkParseStats* stats) {
+  int handled = 0;
+  size_t offset = 0;
+  
+  while (offset < length) {
+    if (data[offset] != MAVLINK_STX_V2) {
+      // Not a v2 frame start (MAVLink v1 frames are ignored too)
+      offset++;
+      if (stats) stats->skippedBytes++;
+      continue;
+    }
+    
+    if (length - offset < MAVLINK_HEADER_LENGTH + MAVLINK_CHECKSUM_LENGTH) {
+      if (stats) stats->skippedBytes += length - offset;
+      break;
+    }
+    
+    const uint8_t* frame = data + offset;
+    uint8_t payloadLength = frame[1];
+    uint8_t incompatFlags = frame[2];
+    size_t frameLength = MAVLINK_HEADER_LENGTH + payloadLength + MAVLINK_CHECKSUM_LENGTH;
+    if (incompatFlags & MAVLINK_IFLAG_SIGNED) {
+      frameLength += MAVLINK_SIGNATURE_LENGTH;
+    }
+    if (frameLength > length - offset) {
+      // Truncated datagram, nothing more to parse
+      if (stats) stats->skippedBytes += length - offset;
+      break;
+    }
+    
+    uint32_t messageId = frame[7] | ((uint32_t)frame[8] << 8) | ((uint32_t)frame[9] << 16);
+    uint8_t crcExtra;
+    uint8_t fullLength;
+    if (!lookupMessage(messageId, crcExtra, fullLength)) {
+      // Unsupported message: skip it without the checksum work. Its CRC_EXTRA is
+      // unknown, so a corrupt length here can also skip the frames after it.
+      offset += frameLength;
+      if (stats) stats->unchecked++;
+      continue;
+    }
+    
+    // Checksum covers the header after the start byte, the payload and CRC_EXTRA
+    uint16_t crc = crcCalculate(frame + 1, MAVLINK_HEADER_LENGTH - 1 + payloadLength);
+    crcAccumulate(crcExtra, crc);
+    if (crc != readU16(frame + MAVLINK_HEADER_LENGTH + payloadLength)) {
+      // Resynchronize on the next byte
+      offset++;
+      if (stats) stats->crcErrors++;
+      continue;
+    }
+    
+    uint8_t payload[BATTERY_STATUS_LENGTH];
+    memset(payload, 0, sizeof(payload));
+    memcpy(payload, frame + MAVLINK_HEADER_LENGTH, payloadLength < fullLength ? payloadLength : fullLength);
+    
+    MavlinkMessage message;
+    memset(&message, 0, sizeof(message));
+    message.systemId = frame[5];
+    message.componentId = frame[6];
+    message.messageId = messageId;
+    decodePayload(payload, message);
+    
+    handler(message, context);
+    handled++;
+    if (stats) {
+      stats->frames++;
+      stats->decoded++;
+    }
+    offset += frameLength;
+  }
+  
+  return handled;
+}
+
+size_t mavlinkPackHeartbeat(uint8_t* buffer, uint8_t sequence, uint8_t systemId, uint8_t componentId) {
+  buffer[0] = MAVLINK_STX_V2;
+  buffer[1] = HEARTBEAT_LENGTH;
+  buffer[2] = 0; // incompat_flags
+  buffer[3] = 0; // compat_flags
+  buffer[4] = sequence;
+  buffer[5] = systemId;
+  buffer[6] = componentId;
+  buffer[7] = MAVLINK_MSG_ID_HEARTBEAT;
+  buffer[8] = 0;
+  buffer[9] = 0;
+  
+  uint8_t* payload = buffer + MAVLINK_HEADER_LENGTH;
+  memset(payload, 0, 4); // custom_mode
+  payload[4] = 6;        // MAV_TYPE_GCS
+  payload[5] = 8;        // MAV_AUTOPILOT_INVALID
+  payload[6] = 0;        // base_mode
+  payload[7] = 4;        // MAV_STATE_ACTIVE
+  payload[8] = 3;        // mavlink_version
+  
+  uint16_t crc = crcCalculate(buffer + 1, MAVLINK_HEADER_LENGTH - 1 + HEARTBEAT_LENGTH);
+  crcAccumulate(HEARTBEAT_CRC_EXTRA, crc);
+  buffer[MAVLINK_HEADER_LENGTH + HEARTBEAT_LENGTH] = crc & 0xFF;
+  buffer[MAVLINK_HEADER_LENGTH + HEARTBEAT_LENGTH + 1] = crc >> 8;
+  
+  return MAVLINK_HEARTBEAT_FRAME_LENGTH;
+}
@@ -0,0 +1,70 @@
+/**
+  ******************************************************************************
+  * @file    mavlink_parser.h
+  * @brief   Minimal MAVLink v2 frame parser for HEARTBEAT, SYS_STATUS and BATTERY_STATUS
+  ******************************************************************************
+*/
+
+#ifndef MAVLINK_PARSER_H
+#define MAVLINK_PARSER_H
+
+// Plain C/C++ only, so the parser can be built and benchmarked on the host
+#include <stdint.h>
+#include <stddef.h>
+
+#define MAVLINK_MSG_ID_HEARTBEAT 0
+#define MAVLINK_MSG_ID_SYS_STATUS 1
+#define MAVLINK_MSG_ID_BATTERY_STATUS 147
+
+// Largest frame we ever build: header, HEARTBEAT payload and checksum
+#define MAVLINK_HEARTBEAT_FRAME_LENGTH (10 + 9 + 2)
+
+// One decoded message, only the fields the watch needs
+struct MavlinkMessage {
+  uint8_t systemId;
+  uint8_t componentId;
+  uint32_t messageId;
+  
+  // HEARTBEAT
+  uint8_t vehicleType;
+  uint8_t autopilot;
+  uint8_t baseMode;
+  uint8_t systemStatus;
+  
+  // SYS_STATUS.voltage_battery or BATTERY_STATUS.voltages[0], in volts, < 0 if unknown
+  float voltage;
+  
+  // Remaining battery in percent, -1 if unknown
+  int8_t batteryRemaining;
+  
+  // BATTERY_STATUS.id, 0 for the main battery and for the other messages
+  uint8_t batteryId;
+};
+
+// Counters for the frames seen by the parser
+struct MavlinkParseStats {
+  uint32_t frames;        // Frames with a valid checksum
+  uint32_t decoded;       // Frames of a supported message
+  uint32_t unchecked;     // Frames of other messages, skipped without checking their checksum
+  uint32_t crcErrors;
+  uint32_t skippedBytes;  // Bytes not belonging to any v2 frame
+};
+
+typedef void (*MavlinkMessageHandler)(const MavlinkMessage& message, void* context);
+
+/**
+ * Parse every MAVLink v2 frame of one UDP datagram.
+ * The handler is called once per supported message with a valid checksum.
+ * @return number of messages passed to the handler
+ */
+int mavlinkParseDatagram(const uint8_t* data, size_t length, MavlinkMessageHandler handler,
+                         void* context, MavlinkParseStats* stats);
+
+/**
+ * Build a GCS HEARTBEAT frame, sent so the vehicle's router starts streaming to us
+ * @param buffer at least MAVLINK_HEARTBEAT_FRAME_LENGTH bytes
+ * @return frame length
+ */
+size_t mavlinkPackHeartbeat(uint8_t* buffer, uint8_t sequence, uint8_t systemId, uint8_t componentId);
+
+#endif // MAVLINK_PARSER_H
@@ -0,0 +1,186 @@
+/**
+  ******************************************************************************
+  * @file    mavlink_udp_source.cpp
+  * @brief   Native MAVLink UDP receiver feeding vehicle voltages without HTTP
+  ******************************************************************************
+*/
+
+#include "mavlink_udp_source.h"
+#include "vehicle_discovery.h"
+#include "live_voltage.h"
+#include <WiFi.h>
+#include <lwip/sockets.h>
+
+// Initialize static instance
+MavlinkUdpSource* MavlinkUdpSource::instance = nullptr;
+
+MavlinkUdpSource::MavlinkUdpSource()
+  : endpointCount(0), sock(-1), sequence(0), lastHeartbeatSent(0), task(nullptr) {
+  memset(&stats, 0, sizeof(stats));
+  mutex = xSemaphoreCreateMutex();
+}
+
+MavlinkUdpSource* MavlinkUdpSource::getInstance() {
+  if (instance == nullptr) {
+    instance = new MavlinkUdpSource();
+  }
+  return instance;
+}
+
+void MavlinkUdpSource::begin() {
+  if (task != nullptr) {
+    return;
+  }
+  
+  // A plain socket rather than WiFiUDP, so the task can block in select()
+  sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  sockaddr_in local = {};
+  local.sin_family = AF_INET;
+  local.sin_port = htons(MAVLINK_UDP_LOCAL_PORT);
+  local.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (sock < 0 || bind(sock, (sockaddr*)&local, sizeof(local)) < 0) {
+    Serial.printf("MAVLink UDP: failed to bind port %d\n", MAVLINK_UDP_LOCAL_PORT);
+    if (sock >= 0) {
+      close(sock);
+      sock = -1;
+    }
+    return;
+  }
+  xTaskCreate(receiveTask, "mavudp", 4096, this, 1, &task);
+  Serial.printf("MAVLink UDP: listening on port %d\n", MAVLINK_UDP_LOCAL_PORT);
+}
+
+void MavlinkUdpSource::setVehicles(const DiscoveredVehicle vehicles[], int count) {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  Endpoint previous[MAX_VEHICLES];
+  int previousCount = endpointCount;
+  for (int i = 0; i < previousCount; i++) {
+    previous[i] = endpoints[i];
+  }
+  
+  endpointCount = 0;
+  for (int i = 0; i < count && i < MAX_VEHICLES; i++) {
+    if (vehicles[i].port == 0) {
+      continue;
+    }
+    Endpoint& endpoint = endpoints[endpointCount++];
+    endpoint.ip = vehicles[i].ip;
+    endpoint.port = vehicles[i].port;
+    endpoint.lastHeartbeat = 0;
+    endpoint.lastBatteryStatus = 0;
+    
+    // Keep what we already learned about known vehicles
+    for (int j = 0; j < previousCount; j++) {
+      if (previous[j].ip == endpoint.ip) {
+        endpoint.lastHeartbeat = previous[j].lastHeartbeat;
+        endpoint.lastBatteryStatus = previous[j].lastBatteryStatus;
+        break;
+      }
+    }
+  }
+  xSemaphoreGive(mutex);
+}
+
+void MavlinkUdpSource::receiveTask(void* param) {
+  MavlinkUdpSource* source = static_cast<MavlinkUdpSource*>(param);
+  
+  while (true) {
+    if (WiFi.status() == WL_CONNECTED) {
+      source->sendHeartbeats();
+    }
+    
+    // Block until a datagram arrives or the next heartbeat is due
+    unsigned long sinceHeartbeat = millis() - source->lastHeartbeatSent;
+    source->receive(sinceHeartbeat < MAVLINK_HEARTBEAT_INTERVAL_MS ?
+                    MAVLINK_HEARTBEAT_INTERVAL_MS - sinceHeartbeat : MAVLINK_HEARTBEAT_INTERVAL_MS);
+  }
+}
+
+void MavlinkUdpSource::sendHeartbeats() {
+  unsigned long now = millis();
+  if (now - lastHeartbeatSent < MAVLINK_HEARTBEAT_INTERVAL_MS) {
+    return;
+  }
+  lastHeartbeatSent = now;
+  
+  uint8_t frame[MAVLINK_HEARTBEAT_FRAME_LENGTH];
+  size_t length = mavlinkPackHeartbeat(frame, sequence++, MAVLINK_GCS_SYSTEM_ID, MAVLINK_GCS_COMPONENT_ID);
+  
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  for (int i = 0; i < endpointCount; i++) {
+    IPAddress address;
+    if (address.fromString(endpoints[i].ip)) {
+      sockaddr_in remote = {};
+      remote.sin_family = AF_INET;
+      remote.sin_port = htons(endpoints[i].port);
+      remote.sin_addr.s_addr = (uint32_t)address;
+      sendto(sock, frame, length, 0, (sockaddr*)&remote, sizeof(remote));
+    }
+  }
+  xSemaphoreGive(mutex);
+}
+
+void MavlinkUdpSource::receive(uint32_t timeoutMs) {
+  fd_set readable;
+  FD_ZERO(&readable);
+  FD_SET(sock, &readable);
+  timeval timeout;
+  timeout.tv_sec = timeoutMs / 1000;
+  timeout.tv_usec = (timeoutMs % 1000) * 1000;
+  if (select(sock + 1, &readable, nullptr, nullptr, &timeout) <= 0) {
+    return;
+  }
+  
+  // Drain every datagram that arrived meanwhile
+  uint8_t datagram[512];
+  sockaddr_in remote;
+  socklen_t remoteLength = sizeof(remote);
+  int length;
+  while ((length = recvfrom(sock, datagram, sizeof(datagram), MSG_DONTWAIT,
+                            (sockaddr*)&remote, &remoteLength)) > 0) {
+    currentIP = IPAddress(remote.sin_addr.s_addr).toString();
+    mavlinkParseDatagram(datagram, length, handleMessage, this, &stats);
+    remoteLength = sizeof(remote);
+  }
+}
+
+void MavlinkUdpSource::handleMessage(const MavlinkMessage& message, void* context) {
+  MavlinkUdpSource* source = static_cast<MavlinkUdpSource*>(context);
+  
+  // Only the autopilot's main battery, like the mavlink2rest path (vehicles/1/components/1)
+  if (message.systemId != 1 || message.componentId != 1 || message.batteryId != 0) {
+    return;
+  }
+  
+  unsigned long now = millis();
+  bool publish = false;
+  
+  xSemaphoreTake(source->mutex, portMAX_DELAY);
+  for (int i = 0; i < source->endpointCount; i++) {
+    Endpoint& endpoint = source->endpoints[i];
+    if (endpoint.ip != source->currentIP) {
+      continue;
+    }
+    switch (message.messageId) {
+      case MAVLINK_MSG_ID_HEARTBEAT:
+        endpoint.lastHeartbeat = now;
+        break;
+      case MAVLINK_MSG_ID_BATTERY_STATUS:
+        endpoint.lastBatteryStatus = now;
+        publish = message.voltage > 0;
+        break;
+      case MAVLINK_MSG_ID_SYS_STATUS:
+        // Fallback for autopilots that don't send BATTERY_STATUS
+        publish = message.voltage > 0 &&
+                  (endpoint.lastBatteryStatus == 0 ||
+                   now - endpoint.lastBatteryStatus > MAVLINK_BATTERY_STATUS_PREFERRED_MS);
+        break;
+    }
+    break;
+  }
+  xSemaphoreGive(source->mutex);
+  
+  if (publish) {
+    LiveVoltageStore::getInstance()->publish(source->currentIP, message.voltage, LIVE_SOURCE_MAVLINK_UDP);
+  }
+}
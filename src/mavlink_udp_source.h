@@ -0,0 +1,79 @@
+/**
+  ******************************************************************************
+  * @file    mavlink_udp_source.h
+  * @brief   Native MAVLink UDP receiver feeding vehicle voltages without HTTP
+  ******************************************************************************
+*/
+
+#ifndef MAVLINK_UDP_SOURCE_H
+#define MAVLINK_UDP_SOURCE_H
+
+#include <Arduino.h>
+#include "telemetry.h"
+#include "mavlink_parser.h"
+
+// Opt-in: routers stream every message to a GCS, which is more traffic than the
+// filtered WebSocket unless stream rates are limited on the vehicle
+#ifndef MAVLINK_UDP_ENABLED
+#define MAVLINK_UDP_ENABLED 0
+#endif
+
+// Local port the vehicles stream to
+#ifndef MAVLINK_UDP_LOCAL_PORT
+#define MAVLINK_UDP_LOCAL_PORT 14550
+#endif
+
+// Our identity on the MAVLink network
+#define MAVLINK_GCS_SYSTEM_ID 255
+#define MAVLINK_GCS_COMPONENT_ID 190
+
+// Heartbeats keep the vehicle's router sending to us
+#define MAVLINK_HEARTBEAT_INTERVAL_MS 1000
+
+// BATTERY_STATUS wins over SYS_STATUS while younger than this
+#define MAVLINK_BATTERY_STATUS_PREFERRED_MS 5000
+
+struct DiscoveredVehicle;
+
+// Receives and decodes MAVLink datagrams on a background task
+class MavlinkUdpSource {
+private:
+  struct Endpoint {
+    String ip;
+    uint16_t port;
+    unsigned long lastHeartbeat;      // Last HEARTBEAT received from the vehicle
+    unsigned long lastBatteryStatus;  // Last BATTERY_STATUS received from the vehicle
+  };
+  
+  static MavlinkUdpSource* instance;
+  Endpoint endpoints[MAX_VEHICLES];
+  int endpointCount;
+  MavlinkParseStats stats;
+  int sock; // lwIP UDP socket, -1 until bound
+  uint8_t sequence;
+  unsigned long lastHeartbeatSent;
+  SemaphoreHandle_t mutex;
+  TaskHandle_t task;
+  
+  // Datagram being parsed, used by the message handler
+  String currentIP;
+  
+  MavlinkUdpSource();
+  static void receiveTask(void* param);
+  static void handleMessage(const MavlinkMessage& message, void* context);
+  void sendHeartbeats();
+  void receive(uint32_t timeoutMs);
+
+public:
+  static MavlinkUdpSource* getInstance();
+  
+  // Bind the local port and start the background task
+  void begin();
+  
+  // Set the advertised MAVLink endpoints of the discovered vehicles
+  void setVehicles(const DiscoveredVehicle vehicles[], int count);
+  
+  MavlinkParseStats getStats() { return stats; }
+};
+
+#endif // MAVLINK_UDP_SOURCE_H
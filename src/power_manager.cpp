@@ -0,0 +1,174 @@
+/**
+  ******************************************************************************
+  * @file    power_manager.cpp
+  * @brief   Automatic light sleep and CPU frequency scaling while the firmware waits
+  ******************************************************************************
+*/
+
+#include "power_manager.h"
+#include <esp_pm.h>
+#include "rtc_state.h"
+
+static const char* LOCK_NAMES[POWER_ACTIVITY_COUNT] = { "render", "fetch", "ota" };
+
+static PowerMode mode = POWER_FIXED;
+static esp_pm_lock_handle_t locks[POWER_ACTIVITY_COUNT];
+static int lockCounts[POWER_ACTIVITY_COUNT];
+static portMUX_TYPE countLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Without ESP-IDF power management: holders of any lock, and the mutex serializing clock switches
+static int manualHolders = 0;
+static SemaphoreHandle_t manualMutex = nullptr;
+
+// Active power states, charged to rtcState.energy on every transition
+static EnergyTracker tracker;
+static bool accounting = false;
+static portMUX_TYPE trackerLock = portMUX_INITIALIZER_UNLOCKED;
+
+PowerMode powerManagerBegin() {
+  esp_pm_config_esp32_t config;
+  config.max_freq_mhz = POWER_MAX_CPU_MHZ;
+  config.min_freq_mhz = POWER_MIN_CPU_MHZ;
+  config.light_sleep_enable = POWER_AUTO_LIGHT_SLEEP;
+  
+  // Light sleep also needs tickless idle in the sdkconfig, retry with scaling alone
+  esp_err_t err = esp_pm_configure(&config);
+  if (err != ESP_OK && config.light_sleep_enable) {
+    config.light_sleep_enable = false;
+    err = esp_pm_configure(&config);
+  }
+  
+  if (err == ESP_OK) {
+    mode = config.light_sleep_enable ? POWER_LIGHT_SLEEP : POWER_AUTO_SCALE;
+    for (int i = 0; i < POWER_ACTIVITY_COUNT; i++) {
+      esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, LOCK_NAMES[i], &locks[i]);
+    }
+  } else {
+    // Framework built without CONFIG_PM_ENABLE: run slow and let the locks speed up
+    manualMutex = xSemaphoreCreateMutex();
+    if (manualMutex != nullptr && setCpuFrequencyMhz(POWER_MIN_CPU_MHZ)) {
+      mode = POWER_MANUAL_SCALE;
+    }
+    Serial.printf("ESP-IDF power management unavailable (%s)\n", esp_err_to_name(err));
+  }
+  
+  Serial.printf("Power: %s, CPU %d-%d MHz\n", powerModeName(mode), POWER_MIN_CPU_MHZ, POWER_MAX_CPU_MHZ);
+  return mode;
+}
+
+PowerMode powerManagerMode() {
+  return mode;
+}
+
+const char* powerModeName(PowerMode mode) {
+  switch (mode) {
+    case POWER_MANUAL_SCALE: return "clock switched by locks";
+    case POWER_AUTO_SCALE: return "automatic frequency scaling";
+    case POWER_LIGHT_SLEEP: return "automatic light sleep";
+    default: return "fixed clock";
+  }
+}
+
+void powerLock(PowerActivity activity) {
+  portENTER_CRITICAL(&countLock);
+  lockCounts[activity]++;
+  portEXIT_CRITICAL(&countLock);
+  
+  if (mode == POWER_AUTO_SCALE || mode == POWER_LIGHT_SLEEP) {
+    esp_pm_lock_acquire(locks[activity]);
+  } else if (mode == POWER_MANUAL_SCALE) {
+    xSemaphoreTake(manualMutex, portMAX_DELAY);
+    if (manualHolders++ == 0) {
+      setCpuFrequencyMhz(POWER_MAX_CPU_MHZ);
+    }
+    xSemaphoreGive(manualMutex);
+  }
+}
+
+void powerUnlock(PowerActivity activity) {
+  if (mode == POWER_AUTO_SCALE || mode == POWER_LIGHT_SLEEP) {
+    esp_pm_lock_release(locks[activity]);
+  } else if (mode == POWER_MANUAL_SCALE) {
+    xSemaphoreTake(manualMutex, portMAX_DELAY);
+    if (--manualHolders == 0) {
+      setCpuFrequencyMhz(POWER_MIN_CPU_MHZ);
+    }
+    xSemaphoreGive(manualMutex);
+  }
+  
+  portENTER_CRITICAL(&countLock);
+  lockCounts[activity]--;
+  portEXIT_CRITICAL(&countLock);
+}
+
+int powerLockCount(PowerActivity activity) {
+  return lockCounts[activity];
+}
+
+void powerAccountingBegin() {
+  // The uptime clock read 0 + elapsedMs at reset
+  energyTrackerBegin(tracker, rtcState.elapsedMs);
+  energyTrackerEnter(tracker, rtcState.energy, ENERGY_BOOT, rtcState.elapsedMs);
+  accounting = true;
+}
+
+void powerStateEnter(EnergyState state) {
+  if (!accounting) {
+    return;
+  }
+  portENTER_CRITICAL(&trackerLock);
+  energyTrackerEnter(tracker, rtcState.energy, state, rtcStateUptimeMs());
+  portEXIT_CRITICAL(&trackerLock);
+}
+
+void powerStateLeave(EnergyState state) {
+  if (!accounting) {
+    return;
+  }
+  portENTER_CRITICAL(&trackerLock);
+  energyTrackerLeave(tracker, rtcState.energy, state, rtcStateUptimeMs());
+  portEXIT_CRITICAL(&trackerLock);
+}
+
+bool powerRadioActive() {
+  bool active = false;
+  portENTER_CRITICAL(&trackerLock);
+  for (int i = ENERGY_SCAN; i <= ENERGY_HTTP; i++) {
+    active |= tracker.active[i] > 0;
+  }
+  portEXIT_CRITICAL(&trackerLock);
+  return active;
+}
+
+void powerChargeSleep(uint64_t ms) {
+  portENTER_CRITICAL(&trackerLock);
+  if (accounting) {
+    energyTrackerFlush(tracker, rtcState.energy, rtcStateUptimeMs());
+  }
+  energyCharge(rtcState.energy, ENERGY_SLEEP, ms);
+  portEXIT_CRITICAL(&trackerLock);
+}
+
+void powerEnergySnapshot(EnergyCounters& counters) {
+  portENTER_CRITICAL(&trackerLock);
+  if (accounting) {
+    energyTrackerFlush(tracker, rtcState.energy, rtcStateUptimeMs());
+  }
+  counters = rtcState.energy;
+  portEXIT_CRITICAL(&trackerLock);
+}
+
+void powerLogEnergy() {
+  EnergyCounters counters;
+  powerEnergySnapshot(counters);
+  
+  uint64_t totalMs = energyTotalMs(counters);
+  double totalMah = energyTotalMilliampHours(counters);
+  Serial.printf("Energy since first boot: %.2f mAh in %lu s, %.2f mA average\n", totalMah,
+                (unsigned long)(totalMs / 1000), totalMs > 0 ? totalMah * 3600000.0 / totalMs : 0.0);
+  for (int i = 0; i < ENERGY_STATE_COUNT; i++) {
+    EnergyState state = (EnergyState)i;
+    Serial.printf("  %-10s %8lu s %8.3f mAh\n", energyStateName(state),
+                  (unsigned long)(counters.stateMs[i] / 1000), energyMilliampHours(counters, state));
+  }
+}
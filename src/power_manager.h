@@ -0,0 +1,94 @@
+/**
+  ******************************************************************************
+  * @file    power_manager.h
+  * @brief   Automatic light sleep and CPU frequency scaling while the firmware waits
+  ******************************************************************************
+*/
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include "energy_model.h"
+
+// CPU clock while something holds a power lock, and while nothing does
+#ifndef POWER_MAX_CPU_MHZ
+#define POWER_MAX_CPU_MHZ 240
+#endif
+
+#ifndef POWER_MIN_CPU_MHZ
+#define POWER_MIN_CPU_MHZ 80
+#endif
+
+// Let the idle task enter light sleep when no task is ready, 0 to only scale the clock
+#ifndef POWER_AUTO_LIGHT_SLEEP
+#define POWER_AUTO_LIGHT_SLEEP 1
+#endif
+
+// How often the always-on loop logs the energy estimate
+#ifndef POWER_ENERGY_LOG_INTERVAL_MS
+#define POWER_ENERGY_LOG_INTERVAL_MS (10UL * 60UL * 1000UL)
+#endif
+
+// Work that needs the full clock while it runs
+enum PowerActivity : uint8_t {
+  POWER_RENDER, // Drawing frames and sending them to the panel
+  POWER_FETCH,  // HTTP requests to the vehicles
+  POWER_OTA,    // Receiving and flashing a firmware image
+  POWER_ACTIVITY_COUNT
+};
+
+// How the clock is managed, depends on what the framework was built with
+enum PowerMode : uint8_t {
+  POWER_FIXED,        // Nothing managed, the CPU stays at the boot clock
+  POWER_MANUAL_SCALE, // No ESP-IDF power management, the locks switch the clock themselves
+  POWER_AUTO_SCALE,   // ESP-IDF scales the clock between the locks
+  POWER_LIGHT_SLEEP   // ESP-IDF scales the clock and light sleeps when idle
+};
+
+/**
+ * Configure power management, call once early in setup(). Prefers ESP-IDF
+ * automatic light sleep, then ESP-IDF frequency scaling, then switching the clock
+ * from the locks, depending on what the framework's sdkconfig enables.
+ */
+PowerMode powerManagerBegin();
+
+PowerMode powerManagerMode();
+
+const char* powerModeName(PowerMode mode);
+
+/**
+ * Hold the full clock and keep the CPU out of light sleep until the matching
+ * powerUnlock(). Locks nest and may be taken by several tasks at once.
+ */
+void powerLock(PowerActivity activity);
+
+void powerUnlock(PowerActivity activity);
+
+// Number of holders of each activity's lock, for diagnostics
+int powerLockCount(PowerActivity activity);
+
+/**
+ * Start charging time to power states in rtcState.energy, call right after
+ * rtcStateInit(). Time since reset counts as ENERGY_BOOT until powerStateLeave().
+ */
+void powerAccountingBegin();
+
+// Mark a power state active or inactive, from any task; calls nest like the locks
+void powerStateEnter(EnergyState state);
+
+void powerStateLeave(EnergyState state);
+
+// Whether a WiFi scan, connection, query or fetch is running, i.e. the radio is transmitting
+bool powerRadioActive();
+
+// Charge a deep sleep about to start, before rtcState.elapsedMs is advanced past it
+void powerChargeSleep(uint64_t ms);
+
+// Counters with the time up to now charged
+void powerEnergySnapshot(EnergyCounters& counters);
+
+// Print time and estimated charge per state to the serial log
+void powerLogEnergy();
+
+#endif // POWER_MANAGER_H
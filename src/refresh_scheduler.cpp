@@ -0,0 +1,36 @@
+/**
+  ******************************************************************************
+  * @file    refresh_scheduler.cpp
+  * @brief   Decides when partial e-paper updates must give way to a full refresh
+  ******************************************************************************
+*/
+
+#include "refresh_scheduler.h"
+#include <string.h>
+
+void refreshSchedulerReset(RefreshSchedulerState& state) {
+  memset(&state, 0, sizeof(state));
+}
+
+bool refreshSchedulerWantsFull(const RefreshSchedulerState& state, const uint32_t changedPixels[], int regionCount) {
+  if (state.partialsSinceFull + 1 > REFRESH_MAX_PARTIALS) {
+    return true;
+  }
+  for (int i = 0; i < regionCount && i < REFRESH_MAX_REGIONS; i++) {
+    if (state.regionPixels[i] + changedPixels[i] > REFRESH_MAX_REGION_PIXELS) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void refreshSchedulerRecordPartial(RefreshSchedulerState& state, const uint32_t changedPixels[], int regionCount) {
+  state.partialsSinceFull++;
+  for (int i = 0; i < regionCount && i < REFRESH_MAX_REGIONS; i++) {
+    state.regionPixels[i] += changedPixels[i];
+  }
+}
+
+bool refreshSchedulerHasGhosting(const RefreshSchedulerState& state) {
+  return state.partialsSinceFull > 0;
+}
@@ -0,0 +1,50 @@
+/**
+  ******************************************************************************
+  * @file    refresh_scheduler.h
+  * @brief   Decides when partial e-paper updates must give way to a full refresh
+  ******************************************************************************
+*/
+
+#ifndef REFRESH_SCHEDULER_H
+#define REFRESH_SCHEDULER_H
+
+// Plain C/C++ only, so the scheduler can run in host-side simulations
+#include <stdint.h>
+
+// Partial updates allowed between two full refreshes
+#ifndef REFRESH_MAX_PARTIALS
+#define REFRESH_MAX_PARTIALS 20
+#endif
+
+// Changed pixels one region may accumulate between two full refreshes
+#ifndef REFRESH_MAX_REGION_PIXELS
+#define REFRESH_MAX_REGION_PIXELS 30000
+#endif
+
+// Regions tracked, matches DISPLAY_MAX_REGIONS
+#ifndef REFRESH_MAX_REGIONS
+#define REFRESH_MAX_REGIONS 8
+#endif
+
+// Ghosting built up since the last full refresh
+struct RefreshSchedulerState {
+  uint16_t partialsSinceFull;
+  uint32_t regionPixels[REFRESH_MAX_REGIONS]; // Changed pixels per region since the last full refresh
+};
+
+// A full refresh just cleared the panel
+void refreshSchedulerReset(RefreshSchedulerState& state);
+
+/**
+ * Whether the next update should be full rather than partial
+ * @param changedPixels pixels the pending partial update would change, per region
+ */
+bool refreshSchedulerWantsFull(const RefreshSchedulerState& state, const uint32_t changedPixels[], int regionCount);
+
+// Account a partial update that changed these pixels per region
+void refreshSchedulerRecordPartial(RefreshSchedulerState& state, const uint32_t changedPixels[], int regionCount);
+
+// Any ghosting that a full refresh would clear, worth doing before a long deep sleep
+bool refreshSchedulerHasGhosting(const RefreshSchedulerState& state);
+
+#endif // REFRESH_SCHEDULER_H
@@ -0,0 +1,26 @@
+/**
+  ******************************************************************************
+  * @file    rtc_state.cpp
+  * @brief   State kept in RTC memory across deep sleep
+  ******************************************************************************
+*/
+
+#include "rtc_state.h"
+
+// Lives in RTC slow memory: kept during deep sleep, zeroed on power-on
+RTC_DATA_ATTR RtcState rtcState;
+
+void rtcStateInit() {
+  if (rtcState.magic != RTC_STATE_MAGIC) {
+    Serial.println("RTC state invalid, starting fresh");
+    memset(&rtcState, 0, sizeof(rtcState));
+    rtcState.magic = RTC_STATE_MAGIC;
+  }
+  rtcState.bootCount++;
+  Serial.printf("Boot %u, %u duty-cycle wakes, %u fetches\n",
+                rtcState.bootCount, rtcState.wakeCount, rtcState.fetchCount);
+}
+
+uint64_t rtcStateUptimeMs() {
+  return rtcState.elapsedMs + millis();
+}
@@ -0,0 +1,126 @@
+/**
+  ******************************************************************************
+  * @file    rtc_state.h
+  * @brief   State kept in RTC memory across deep sleep
+  ******************************************************************************
+*/
+
+#ifndef RTC_STATE_H
+#define RTC_STATE_H
+
+#include <Arduino.h>
+#include "telemetry.h"
+#include "sleep_policy.h"
+#include "energy_model.h"
+#include "battery_filter.h"
+#include "charge_estimator.h"
+#include "circuit_breaker.h"
+#include "rtt_estimator.h"
+#include "refresh_scheduler.h"
+
+// Changes whenever the layout below changes, so stale RTC contents are discarded
+#define RTC_STATE_MAGIC 0x5741540D
+
+#define RTC_VEHICLE_NAME_LENGTH 24
+
+// BlueOS services with learned timeouts per vehicle, mavlink2rest and the name service
+#define RTC_VEHICLE_SERVICES 2
+
+// A vehicle remembered across deep sleep
+struct RtcVehicle {
+  uint32_t ip;       // IPv4 address, as stored by IPAddress
+  uint16_t port;     // Advertised MAVLink UDP port
+  char name[RTC_VEHICLE_NAME_LENGTH];
+  uint64_t nameFetchedAtMs; // rtcStateUptimeMs() when the name was fetched, so its TTL spans wakes
+  float lastVoltage; // Volts, <= 0 if unknown
+  BreakerRecord breaker;
+  RttServiceRecord services[RTC_VEHICLE_SERVICES];
+};
+
+// Access point and IP configuration of the last successful connection
+struct RtcWifiCache {
+  bool valid;
+  uint8_t channel;
+  uint8_t bssid[6];
+  uint32_t ip;         // IPv4 addresses, as stored by IPAddress
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+  uint64_t savedAtMs;  // rtcStateUptimeMs() when the lease was obtained
+};
+
+// Duration of each connection phase, last attempt and running totals
+struct RtcWifiTimings {
+  uint32_t scanMs;
+  uint32_t associateMs;
+  uint32_t dhcpMs;
+  uint32_t totalMs;
+  bool fastPath;          // Last connection used the cached AP and IP
+  uint32_t fastConnects;
+  uint32_t fastFailures;  // Directed connects that fell back to a scan
+  uint32_t fullConnects;
+  uint64_t fastTotalMs;
+  uint64_t fullTotalMs;
+};
+
+// Discharge history of one vehicle pack
+struct RtcVehicleCharge {
+  uint32_t ip; // IPv4 address, 0 for a free slot
+  ChargeEstimatorState state;
+};
+
+// Everything that survives deep sleep, plain data only (no String or heap)
+struct RtcState {
+  uint32_t magic;
+  
+  // Counters
+  uint32_t bootCount;      // Any start, cold or from deep sleep
+  uint32_t wakeCount;      // Duty-cycle wakes
+  uint32_t fetchCount;     // Completed fetch cycles
+  uint64_t elapsedMs;      // Time since the first boot, advanced before every deep sleep
+  
+  // Vehicles found at the last wake
+  uint8_t vehicleCount;
+  uint32_t wakesSinceDiscovery;
+  RtcVehicle vehicles[MAX_VEHICLES];
+  
+  // WiFi fast reconnect
+  RtcWifiCache wifiCache;
+  RtcWifiTimings wifiTimings;
+  
+  // Deep sleep while the network is absent
+  SleepPolicyState sleepPolicy;
+  
+  // E-paper keeps its image through deep sleep, so the frame on it is known after a wake
+  uint32_t panelHash;      // FrameBuffer::hash() of the frame on the panel, 0 if unknown
+  uint32_t panelRefreshes; // Full updates
+  uint32_t panelPartials;  // Partial updates of the dirty regions
+  uint32_t panelSkips;     // Frames not sent because the panel already showed them
+  
+  // Display list of the frame on the panel and its ghosting, so a wake can update it partially
+  uint32_t panelLayoutHash; // Hash of the region rectangles, 0 without a layout
+  uint8_t panelRegionCount;
+  uint32_t panelRegionHash[REFRESH_MAX_REGIONS];
+  uint16_t panelRegionBlack[REFRESH_MAX_REGIONS];
+  RefreshSchedulerState panelScheduler;
+  
+  // Time per power state since the first boot, for the energy estimate
+  EnergyCounters energy;
+  
+  // Filtered battery voltage, so each wake continues from the last estimate
+  BatteryFilterState batteryFilter;
+  
+  // State of charge and discharge rate of the watch and the vehicles
+  ChargeEstimatorState watchCharge;
+  RtcVehicleCharge vehicleCharge[MAX_VEHICLES];
+};
+
+extern RtcState rtcState;
+
+// Validate the RTC contents after a start and reset them if unusable
+void rtcStateInit();
+
+// Milliseconds since the first boot, including time spent in deep sleep
+uint64_t rtcStateUptimeMs();
+
+#endif // RTC_STATE_H
@@ -0,0 +1,174 @@
+/**
+  ******************************************************************************
+  * @file    rtt_estimator.cpp
+  * @brief   Per-vehicle round-trip time tracking driving adaptive HTTP timeouts
+  ******************************************************************************
+*/
+
+#include "rtt_estimator.h"
+
+void RttEstimator::reset(uint32_t initialTimeout, uint32_t minMs, uint32_t maxMs) {
+  srtt = 0;
+  rttvar = 0;
+  minTimeout = minMs;
+  maxTimeout = maxMs;
+  rto = constrain(initialTimeout, minMs, maxMs);
+  samples = 0;
+  timeouts = 0;
+}
+
+void RttEstimator::addSample(uint32_t rttMs) {
+  float sample = (float)rttMs;
+  
+  if (samples == 0) {
+    srtt = sample;
+    rttvar = sample / 2;
+  } else {
+    // alpha = 1/8, beta = 1/4
+    rttvar = 0.75f * rttvar + 0.25f * fabsf(srtt - sample);
+    srtt = 0.875f * srtt + 0.125f * sample;
+  }
+  samples++;
+  
+  uint32_t timeout = (uint32_t)(srtt + 4 * rttvar);
+  rto = constrain(timeout, minTimeout, maxTimeout);
+}
+
+void RttEstimator::backoff() {
+  timeouts++;
+  rto = min(rto * 2, maxTimeout);
+}
+
+void RttEstimator::save(RttRecord& record) const {
+  record.srtt = srtt;
+  record.rttvar = rttvar;
+  record.rto = rto;
+  record.samples = samples;
+}
+
+// Keeps the bounds given to reset(), so a record saved by an older build can't bring back old ones
+void RttEstimator::restore(const RttRecord& record) {
+  srtt = record.srtt;
+  rttvar = record.rttvar;
+  rto = constrain(record.rto, minTimeout, maxTimeout);
+  samples = record.samples;
+  timeouts = 0;
+}
+
+// Initialize static instance
+AdaptiveTimeouts* AdaptiveTimeouts::instance = nullptr;
+
+AdaptiveTimeouts::AdaptiveTimeouts() : entryCount(0) {
+  mutex = xSemaphoreCreateMutex();
+}
+
+AdaptiveTimeouts* AdaptiveTimeouts::getInstance() {
+  if (instance == nullptr) {
+    instance = new AdaptiveTimeouts();
+  }
+  return instance;
+}
+
+// Caller must hold the mutex
+RttEntry& AdaptiveTimeouts::findOrCreate(const String& host, uint16_t port, uint32_t maxResponseTimeout) {
+  for (int i = 0; i < entryCount; i++) {
+    if (entries[i].port == port && entries[i].host == host) {
+      return entries[i];
+    }
+  }
+  
+  // Reuse the least used entry when the table is full
+  int index = entryCount;
+  if (entryCount < RTT_TABLE_SIZE) {
+    entryCount++;
+  } else {
+    index = 0;
+    for (int i = 1; i < RTT_TABLE_SIZE; i++) {
+      if (entries[i].response.samples < entries[index].response.samples) {
+        index = i;
+      }
+    }
+  }
+  
+  RttEntry& entry = entries[index];
+  entry.host = host;
+  entry.port = port;
+  entry.connect.reset(RTT_INITIAL_CONNECT_TIMEOUT_MS, RTT_MIN_TIMEOUT_MS, RTT_MAX_CONNECT_TIMEOUT_MS);
+  entry.response.reset(maxResponseTimeout, RTT_MIN_TIMEOUT_MS, maxResponseTimeout);
+  return entry;
+}
+
+void AdaptiveTimeouts::getTimeouts(const String& host, uint16_t port, uint32_t maxResponseTimeout,
+                                   uint32_t& connectTimeout, uint32_t& responseTimeout) {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  RttEntry& entry = findOrCreate(host, port, maxResponseTimeout);
+  connectTimeout = entry.connect.timeout();
+  responseTimeout = min(entry.response.timeout(), maxResponseTimeout);
+  xSemaphoreGive(mutex);
+}
+
+void AdaptiveTimeouts::recordConnect(const String& host, uint16_t port, uint32_t elapsedMs, bool success) {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  for (int i = 0; i < entryCount; i++) {
+    if (entries[i].port == port && entries[i].host == host) {
+      if (success) {
+        entries[i].connect.addSample(elapsedMs);
+      } else {
+        entries[i].connect.backoff();
+      }
+      break;
+    }
+  }
+  xSemaphoreGive(mutex);
+}
+
+void AdaptiveTimeouts::recordResponse(const String& host, uint16_t port, uint32_t elapsedMs, bool success) {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  for (int i = 0; i < entryCount; i++) {
+    if (entries[i].port == port && entries[i].host == host) {
+      if (success) {
+        entries[i].response.addSample(elapsedMs);
+      } else {
+        entries[i].response.backoff();
+      }
+      break;
+    }
+  }
+  xSemaphoreGive(mutex);
+}
+
+int AdaptiveTimeouts::saveHost(const String& host, RttServiceRecord out[], int maxCount) {
+  int count = 0;
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  for (int i = 0; i < entryCount && count < maxCount; i++) {
+    if (entries[i].host == host) {
+      out[count].port = entries[i].port;
+      entries[i].connect.save(out[count].connect);
+      entries[i].response.save(out[count].response);
+      count++;
+    }
+  }
+  xSemaphoreGive(mutex);
+  return count;
+}
+
+void AdaptiveTimeouts::restoreService(const String& host, const RttServiceRecord& record, uint32_t maxResponseTimeout) {
+  if (record.port == 0) {
+    return;
+  }
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  RttEntry& entry = findOrCreate(host, record.port, maxResponseTimeout);
+  entry.connect.restore(record.connect);
+  entry.response.restore(record.response);
+  xSemaphoreGive(mutex);
+}
+
+int AdaptiveTimeouts::getEntries(RttEntry out[], int maxCount) {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  int count = min(entryCount, maxCount);
+  for (int i = 0; i < count; i++) {
+    out[i] = entries[i];
+  }
+  xSemaphoreGive(mutex);
+  return count;
+}
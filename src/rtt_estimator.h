@@ -0,0 +1,125 @@
+/**
+  ******************************************************************************
+  * @file    rtt_estimator.h
+  * @brief   Per-vehicle round-trip time tracking driving adaptive HTTP timeouts
+  ******************************************************************************
+*/
+
+#ifndef RTT_ESTIMATOR_H
+#define RTT_ESTIMATOR_H
+
+#include <Arduino.h>
+#include "telemetry.h"
+
+// Bounds of the learned timeouts. The floor is RFC 6298's 1 s minimum RTO: with
+// modem sleep and automatic light sleep, a reply can wait several DTIM beacon
+// intervals (about 100 ms each), and a spurious timeout costs a closed keep-alive
+// socket, a retry and a circuit breaker failure.
+#ifndef RTT_MIN_TIMEOUT_MS
+#define RTT_MIN_TIMEOUT_MS 1000
+#endif
+#define RTT_MAX_CONNECT_TIMEOUT_MS 3000
+
+// Timeouts used before the first sample, like the initial TCP RTO
+#define RTT_INITIAL_CONNECT_TIMEOUT_MS 1000
+
+// Number of (host, port) pairs tracked, one per BlueOS service and vehicle
+#define RTT_TABLE_SIZE (MAX_VEHICLES * 2)
+
+// Estimator kept in RTC memory across deep sleep, plain data. The bounds are not
+// kept: they come from this build's defaults, so a firmware update applies them.
+struct RttRecord {
+  float srtt;
+  float rttvar;
+  uint32_t rto;     // Including a backoff in progress
+  uint32_t samples;
+};
+
+// Both estimators of one service on a vehicle, see RttEntry
+struct RttServiceRecord {
+  uint16_t port; // 0 for an unused record
+  RttRecord connect;
+  RttRecord response;
+};
+
+/**
+ * Smoothed RTT and variance, as TCP computes its retransmission timeout (RFC 6298):
+ * SRTT and RTTVAR are exponentially weighted averages, the timeout is SRTT + 4 * RTTVAR.
+ */
+class RttEstimator {
+private:
+  float srtt;
+  float rttvar;
+  uint32_t rto;
+  uint32_t minTimeout;
+  uint32_t maxTimeout;
+
+public:
+  uint32_t samples;
+  uint32_t timeouts;
+  
+  RttEstimator() : srtt(0), rttvar(0), rto(0), minTimeout(0), maxTimeout(0), samples(0), timeouts(0) {}
+  
+  void reset(uint32_t initialTimeout, uint32_t minMs, uint32_t maxMs);
+  
+  // Feed a successful measurement
+  void addSample(uint32_t rttMs);
+  
+  // Double the timeout after it expired, without taking a sample (Karn's rule)
+  void backoff();
+  
+  // Copy to and from RTC memory; the timeout counter and the bounds are not kept
+  void save(RttRecord& record) const;
+  void restore(const RttRecord& record);
+  
+  uint32_t timeout() const { return rto; }
+  float smoothedRtt() const { return srtt; }
+  float variance() const { return rttvar; }
+};
+
+// Learned timeouts of one service on one vehicle
+struct RttEntry {
+  String host;
+  uint16_t port;
+  RttEstimator connect;   // TCP handshake
+  RttEstimator response;  // Request sent until response headers received
+};
+
+// Thread-safe table of estimators shared by the fetch workers
+class AdaptiveTimeouts {
+private:
+  static AdaptiveTimeouts* instance;
+  RttEntry entries[RTT_TABLE_SIZE];
+  int entryCount;
+  SemaphoreHandle_t mutex;
+  
+  AdaptiveTimeouts();
+  RttEntry& findOrCreate(const String& host, uint16_t port, uint32_t maxResponseTimeout);
+
+public:
+  static AdaptiveTimeouts* getInstance();
+  
+  // Current timeouts for a service, the response timeout never exceeds maxResponseTimeout
+  void getTimeouts(const String& host, uint16_t port, uint32_t maxResponseTimeout,
+                   uint32_t& connectTimeout, uint32_t& responseTimeout);
+  
+  // Record the outcome of a connection attempt, elapsed is ignored on failure
+  void recordConnect(const String& host, uint16_t port, uint32_t elapsedMs, bool success);
+  
+  // Record the outcome of a request on an open connection
+  void recordResponse(const String& host, uint16_t port, uint32_t elapsedMs, bool success);
+  
+  // Copy the estimators of every service on a host for RTC memory
+  int saveHost(const String& host, RttServiceRecord out[], int maxCount);
+  
+  /**
+   * Restore a service's estimators saved before deep sleep, so a wake starts from the learned timeouts
+   * @param maxResponseTimeout this build's cap for the service, as later passed to getTimeouts()
+   */
+  void restoreService(const String& host, const RttServiceRecord& record, uint32_t maxResponseTimeout);
+  
+  // Copy the table for diagnostics
+  int getEntries(RttEntry out[], int maxCount);
+};
+
+#endif // RTT_ESTIMATOR_H
@@ -0,0 +1,95 @@
+/**
+  ******************************************************************************
+  * @file    sleep_policy.cpp
+  * @brief   Deep-sleep backoff while the network is absent, with learned availability windows
+  ******************************************************************************
+*/
+
+#include "sleep_policy.h"
+#include <string.h>
+
+// A slot counts as a usual availability window from this score on
+#define SLEEP_WINDOW_AVAILABLE_SCORE 160
+
+static int slotOf(uint64_t nowMs) {
+  return (int)((nowMs % SLEEP_WINDOW_PERIOD_MS) / SLEEP_WINDOW_SLOT_MS);
+}
+
+static bool trusted(const SleepPolicyState& state, int slot) {
+  return state.observations[slot] >= SLEEP_WINDOW_MIN_OBSERVATIONS;
+}
+
+static bool usuallyAvailable(const SleepPolicyState& state, int slot) {
+  return trusted(state, slot) && state.availability[slot] >= SLEEP_WINDOW_AVAILABLE_SCORE;
+}
+
+// Exponential moving average with weight 1/4, quick to follow a changed routine
+static void observe(SleepPolicyState& state, uint64_t nowMs, bool available) {
+  int slot = slotOf(nowMs);
+  int score = state.availability[slot];
+  if (state.observations[slot] == 0) {
+    score = available ? 255 : 0;
+  } else {
+    score += ((available ? 255 : 0) - score) / 4;
+  }
+  state.availability[slot] = (uint8_t)score;
+  if (state.observations[slot] < 255) {
+    state.observations[slot]++;
+  }
+}
+
+void sleepPolicyReset(SleepPolicyState& state) {
+  memset(&state, 0, sizeof(state));
+}
+
+void sleepPolicyRecordSuccess(SleepPolicyState& state, uint64_t nowMs) {
+  observe(state, nowMs, true);
+  state.consecutiveFailures = 0;
+  state.lastSleepMs = 0;
+  state.connectedSlot = slotOf(nowMs) + 1;
+}
+
+void sleepPolicyRecordConnected(SleepPolicyState& state, uint64_t nowMs) {
+  if (state.connectedSlot != slotOf(nowMs) + 1) {
+    sleepPolicyRecordSuccess(state, nowMs);
+  }
+}
+
+uint32_t sleepPolicyRecordFailure(SleepPolicyState& state, uint64_t nowMs) {
+  observe(state, nowMs, false);
+  state.connectedSlot = 0;
+  if (state.consecutiveFailures < 255) {
+    state.consecutiveFailures++;
+  }
+  
+  // Exponential backoff, shifts capped so the multiplication cannot overflow
+  uint32_t sleepMs = SLEEP_BACKOFF_MAX_MS;
+  int shift = state.consecutiveFailures - 1;
+  if (shift < 16 && ((uint64_t)SLEEP_BACKOFF_BASE_MS << shift) < SLEEP_BACKOFF_MAX_MS) {
+    sleepMs = (uint32_t)(SLEEP_BACKOFF_BASE_MS << shift);
+  }
+  
+  int slot = slotOf(nowMs);
+  if (usuallyAvailable(state, slot)) {
+    // The network is normally back during this slot, keep checking often
+    sleepMs = SLEEP_BACKOFF_BASE_MS;
+  } else {
+    // Do not sleep through the start of a slot where the network usually is
+    uint64_t untilNextSlot = SLEEP_WINDOW_SLOT_MS - nowMs % SLEEP_WINDOW_SLOT_MS;
+    for (int i = 1; i <= SLEEP_WINDOW_SLOTS && untilNextSlot < sleepMs; i++) {
+      if (usuallyAvailable(state, (slot + i) % SLEEP_WINDOW_SLOTS)) {
+        sleepMs = untilNextSlot < SLEEP_BACKOFF_BASE_MS ? SLEEP_BACKOFF_BASE_MS : (uint32_t)untilNextSlot;
+        break;
+      }
+      untilNextSlot += SLEEP_WINDOW_SLOT_MS;
+    }
+  }
+  
+  state.lastSleepMs = sleepMs;
+  return sleepMs;
+}
+
+int sleepPolicyAvailability(const SleepPolicyState& state, uint64_t nowMs) {
+  int slot = slotOf(nowMs);
+  return trusted(state, slot) ? state.availability[slot] : -1;
+}
@@ -0,0 +1,75 @@
+/**
+  ******************************************************************************
+  * @file    sleep_policy.h
+  * @brief   Deep-sleep backoff while the network is absent, with learned availability windows
+  ******************************************************************************
+*/
+
+#ifndef SLEEP_POLICY_H
+#define SLEEP_POLICY_H
+
+// Plain C/C++ only, so the policy can run in host-side simulations
+#include <stdint.h>
+
+// Sleep after the first failed connection
+#ifndef SLEEP_BACKOFF_BASE_MS
+#define SLEEP_BACKOFF_BASE_MS 60000UL
+#endif
+
+// Longest backoff sleep
+#ifndef SLEEP_BACKOFF_MAX_MS
+#define SLEEP_BACKOFF_MAX_MS (30UL * 60UL * 1000UL)
+#endif
+
+// The day is split into this many slots, each learning how often the network is there
+#ifndef SLEEP_WINDOW_SLOTS
+#define SLEEP_WINDOW_SLOTS 24
+#endif
+
+// Observations a slot needs before its score is trusted
+#ifndef SLEEP_WINDOW_MIN_OBSERVATIONS
+#define SLEEP_WINDOW_MIN_OBSERVATIONS 3
+#endif
+
+#define SLEEP_WINDOW_PERIOD_MS (24ULL * 60ULL * 60ULL * 1000ULL)
+#define SLEEP_WINDOW_SLOT_MS (SLEEP_WINDOW_PERIOD_MS / SLEEP_WINDOW_SLOTS)
+
+/**
+ * Backoff and learned schedule, kept in RTC memory.
+ * There is no wall clock, so slots are phases of the uptime clock modulo one day;
+ * that keeps daily habits aligned as long as the uptime clock does not drift far.
+ */
+struct SleepPolicyState {
+  uint8_t consecutiveFailures;
+  uint32_t lastSleepMs;
+  uint8_t availability[SLEEP_WINDOW_SLOTS]; // 0 = never seen the network, 255 = always
+  uint8_t observations[SLEEP_WINDOW_SLOTS]; // Saturating
+  uint8_t connectedSlot;                    // Slot + 1 of the last success while connected, 0 if none
+};
+
+// Forget backoff and schedule
+void sleepPolicyReset(SleepPolicyState& state);
+
+// The network was there at nowMs: reset the backoff and teach the schedule
+void sleepPolicyRecordSuccess(SleepPolicyState& state, uint64_t nowMs);
+
+/**
+ * The link is still up at nowMs, call as often as convenient while connected.
+ * Records one success per slot, so hours spent connected are learned as
+ * available just like the failures of hours spent without the network.
+ */
+void sleepPolicyRecordConnected(SleepPolicyState& state, uint64_t nowMs);
+
+/**
+ * The network was absent at nowMs: teach the schedule and pick the next sleep.
+ * The backoff doubles per consecutive failure up to SLEEP_BACKOFF_MAX_MS. It is cut
+ * short to wake at the start of a slot where the network is usually there, and
+ * kept at the base while the current slot is one of those.
+ * @return sleep duration in milliseconds
+ */
+uint32_t sleepPolicyRecordFailure(SleepPolicyState& state, uint64_t nowMs);
+
+// Learned availability of the slot containing nowMs, -1 while not yet trusted
+int sleepPolicyAvailability(const SleepPolicyState& state, uint64_t nowMs);
+
+#endif // SLEEP_POLICY_H
@@ -0,0 +1,61 @@
+/**
+  ******************************************************************************
+  * @file    stream_subscriptions.cpp
+  * @brief   Which vehicles the battery stream subscribes to, and its watch-side throttle
+  ******************************************************************************
+*/
+
+#include "stream_subscriptions.h"
+
+static bool contains(const uint32_t list[], int count, uint32_t value) {
+  for (int i = 0; i < count; i++) {
+    if (list[i] == value) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int streamSubscriptionsAssign(uint32_t slots[], int slotCount, const uint32_t wanted[], int wantedCount) {
+  // Free the slots of endpoints no longer wanted
+  for (int i = 0; i < slotCount; i++) {
+    if (slots[i] != 0 && !contains(wanted, wantedCount, slots[i])) {
+      slots[i] = 0;
+    }
+  }
+  
+  // New endpoints, each once, into the first free slots
+  int unassigned = 0;
+  for (int j = 0; j < wantedCount; j++) {
+    if (wanted[j] == 0 || contains(slots, slotCount, wanted[j]) || contains(wanted, j, wanted[j])) {
+      continue;
+    }
+    int freeIndex = -1;
+    for (int i = 0; i < slotCount && freeIndex < 0; i++) {
+      if (slots[i] == 0) {
+        freeIndex = i;
+      }
+    }
+    if (freeIndex < 0) {
+      unassigned++;
+    } else {
+      slots[freeIndex] = wanted[j];
+    }
+  }
+  return unassigned;
+}
+
+void streamThrottleReset(StreamThrottle& throttle) {
+  throttle.accepted = false;
+  throttle.lastAcceptedMs = 0;
+}
+
+bool streamThrottleReady(const StreamThrottle& throttle, uint32_t nowMs, uint32_t intervalMs) {
+  // Unsigned difference, correct across the millis() wrap
+  return !throttle.accepted || nowMs - throttle.lastAcceptedMs >= intervalMs;
+}
+
+void streamThrottleAccept(StreamThrottle& throttle, uint32_t nowMs) {
+  throttle.accepted = true;
+  throttle.lastAcceptedMs = nowMs;
+}
@@ -0,0 +1,38 @@
+/**
+  ******************************************************************************
+  * @file    stream_subscriptions.h
+  * @brief   Which vehicles the battery stream subscribes to, and its watch-side throttle
+  ******************************************************************************
+*/
+
+#ifndef STREAM_SUBSCRIPTIONS_H
+#define STREAM_SUBSCRIPTIONS_H
+
+// Plain C/C++ only, so the subscription logic can be tested on the host
+#include <stdint.h>
+
+/**
+ * Assign the wanted endpoints to subscription slots. A slot holding a wanted endpoint
+ * keeps it, so its connection stays up; the other slots are freed and the new endpoints
+ * take the first free ones.
+ * @param slots IPv4 address per slot, 0 for a free slot, updated in place
+ * @return number of wanted endpoints left without a slot
+ */
+int streamSubscriptionsAssign(uint32_t slots[], int slotCount, const uint32_t wanted[], int wantedCount);
+
+// Messages of one subscription taken since it was opened, times are millis()
+struct StreamThrottle {
+  bool accepted;           // A message was taken since the subscription opened
+  uint32_t lastAcceptedMs;
+};
+
+// Open or reopen a subscription, its next message is taken right away
+void streamThrottleReset(StreamThrottle& throttle);
+
+// Whether a message arriving at nowMs is worth parsing, intervalMs after the last one taken
+bool streamThrottleReady(const StreamThrottle& throttle, uint32_t nowMs, uint32_t intervalMs);
+
+// A message arriving at nowMs was parsed and taken
+void streamThrottleAccept(StreamThrottle& throttle, uint32_t nowMs);
+
+#endif // STREAM_SUBSCRIPTIONS_H
@@ -0,0 +1,42 @@
+/**
+  ******************************************************************************
+  * @file    telemetry.h
+  * @brief   Immutable snapshot of everything shown on the status screen
+  ******************************************************************************
+*/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+#include "charge_estimator.h"
+
+// Maximum number of vehicles tracked at once (the display shows the first rows only)
+#define MAX_VEHICLES 8
+
+// One vehicle as seen during a collection cycle
+struct VehicleTelemetry {
+  String ip;
+  String name;
+  float voltage; // Volts, <= 0 when unknown
+  bool stale;    // Vehicle unreachable, voltage is the last known value
+  ChargeEstimate charge;
+};
+
+/**
+ * Data gathered once per refresh cycle, before anything is drawn.
+ * Rendering and the web server only read a snapshot, they never
+ * touch the network or the shared state used to build it.
+ */
+struct TelemetrySnapshot {
+  float batteryVoltage;
+  ChargeEstimate batteryCharge;
+  VehicleTelemetry vehicles[MAX_VEHICLES];
+  int vehicleCount;
+  bool wifiConnected;
+  String ipAddress;
+  unsigned long uptimeMinutes;
+  unsigned long collectedAt; // millis() at the end of the collection
+};
+
+#endif // TELEMETRY_H
@@ -0,0 +1,149 @@
+/**
+  ******************************************************************************
+  * @file    vehicle_api.cpp
+  * @brief   HTTP requests against the BlueOS services running on a vehicle
+  ******************************************************************************
+*/
+
+#include "vehicle_api.h"
+#include "http_pool.h"
+
+// Describe a negative HTTPClient error code
+static const char* httpErrorToString(int httpResponseCode) {
+  switch (httpResponseCode) {
+    case -1:
+      return "Connection failed";
+    case -2:
+      return "Connection lost";
+    case -3:
+      return "Connection timed out";
+    case -4:
+      return "Server sent invalid response";
+    case -5:
+      return "Connection refused";
+    case -6:
+      return "Invalid server response";
+    case -7:
+      return "Failed to allocate stream";
+    case -8:
+      return "Not enough memory";
+    case -9:
+      return "Invalid HTTP response";
+    case -10:
+      return "More data pending";
+    case -11:
+      return "Connection timeout";
+    default:
+      return "Unknown error";
+  }
+}
+
+// Function to get battery voltage from Mavlink HTTP API
+float getMavlinkBatteryVoltage(const String& vehicleIP, bool* reachable) {
+  float batteryVoltage = -1.0f; // Default value indicating failure
+  
+  if (reachable != nullptr) {
+    *reachable = false;
+  }
+  
+  if (vehicleIP.length() == 0 || vehicleIP == "Not found" || vehicleIP == "0.0.0.0") {
+    Serial.println("Invalid vehicle IP address");
+    return batteryVoltage;
+  }
+  
+  // Path of the battery voltage endpoint
+  const String path = "/v1/mavlink/vehicles/1/components/1/messages/BATTERY_STATUS/message/voltages/0";
+  
+  Serial.println("Making request to: http://" + vehicleIP + ":" + String(MAVLINK2REST_PORT) + path);
+  
+  // Send GET request over a pooled connection, learned timeout of at most MAVLINK2REST_MAX_TIMEOUT_MS
+  String payload;
+  int httpResponseCode = HttpConnectionPool::getInstance()->get(vehicleIP, MAVLINK2REST_PORT, path,
+                                                                MAVLINK2REST_MAX_TIMEOUT_MS, payload);
+  
+  if (httpResponseCode > 0) {
+    if (reachable != nullptr) {
+      *reachable = true;
+    }
+    Serial.printf("HTTP Response code: %d\n", httpResponseCode);
+    Serial.println("Payload: " + payload);
+    
+    // Parse the plain text number response
+    // No need for JSON parsing since the response is just a number
+    int millivolts = payload.toInt();
+    if (millivolts > 0) {
+      // The API returns millivolts, convert to volts
+      batteryVoltage = millivolts / 1000.0f;
+      Serial.printf("Battery voltage: %.2f V\n", batteryVoltage);
+    } else {
+      Serial.println("Failed to parse voltage value from response");
+    }
+  } else {
+    Serial.printf("HTTP request failed, error: %d (%s)\n", httpResponseCode, httpErrorToString(httpResponseCode));
+  }
+  
+  return batteryVoltage;
+}
+
+// Function to get vehicle name from the API
+String getVehicleName(const String& vehicleIP, bool* success) {
+  String vehicleName = "Vehicle";  // Default name if API call fails
+  
+  if (success != nullptr) {
+    *success = false;
+  }
+  
+  if (vehicleIP.length() == 0 || vehicleIP == "0.0.0.0") {
+    Serial.println("Invalid vehicle IP for name lookup");
+    return vehicleName;
+  }
+  
+  // Path of the vehicle name endpoint
+  const String path = "/v1.0/vehicle_name";
+  
+  Serial.println("Getting vehicle name from: http://" + vehicleIP + ":" + String(BLUEOS_BOOTSTRAP_PORT) + path);
+  
+  // Send GET request over a pooled connection, learned timeout of at most VEHICLE_NAME_MAX_TIMEOUT_MS
+  String payload;
+  int httpResponseCode = HttpConnectionPool::getInstance()->get(vehicleIP, BLUEOS_BOOTSTRAP_PORT, path,
+                                                                VEHICLE_NAME_MAX_TIMEOUT_MS, payload);
+  
+  if (httpResponseCode > 0) {
+    Serial.printf("HTTP Response code: %d\n", httpResponseCode);
+    Serial.println("Name payload: " + payload);
+    
+    // Trim whitespace and use the response as vehicle name
+    vehicleName = payload;
+    vehicleName.trim();
+    
+    // Remove any double quotes from the name
+    for (int i = 0; i < vehicleName.length(); i++) {
+      if (vehicleName[i] == '"') {
+        vehicleName.remove(i, 1);
+        i--; // Adjust index after removal
+      }
+    }
+    
+    // If empty response, use default
+    if (vehicleName.length() == 0) {
+      vehicleName = "Vehicle";
+    } else if (success != nullptr && httpResponseCode == HTTP_CODE_OK) {
+      *success = true;
+    }
+  } else {
+    Serial.printf("Name request failed, error: %d (%s)\n", httpResponseCode, httpErrorToString(httpResponseCode));
+  }
+  
+  return vehicleName;
+}
+
+uint32_t vehicleServiceMaxTimeout(uint16_t port) {
+  switch (port) {
+    case MAVLINK2REST_PORT:
+      return MAVLINK2REST_MAX_TIMEOUT_MS;
+    case BLUEOS_BOOTSTRAP_PORT:
+      return VEHICLE_NAME_MAX_TIMEOUT_MS;
+    default:
+      return 0;
+  }
+}
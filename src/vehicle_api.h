@@ -0,0 +1,45 @@
+/**
+  ******************************************************************************
+  * @file    vehicle_api.h
+  * @brief   HTTP requests against the BlueOS services running on a vehicle
+  ******************************************************************************
+*/
+
+#ifndef VEHICLE_API_H
+#define VEHICLE_API_H
+
+#include <Arduino.h>
+
+// BlueOS service ports
+#define MAVLINK2REST_PORT 6040
+#define BLUEOS_BOOTSTRAP_PORT 9111
+
+// Caps of the learned response timeouts, per service
+#ifndef MAVLINK2REST_MAX_TIMEOUT_MS
+#define MAVLINK2REST_MAX_TIMEOUT_MS 5000
+#endif
+#ifndef VEHICLE_NAME_MAX_TIMEOUT_MS
+#define VEHICLE_NAME_MAX_TIMEOUT_MS 3000
+#endif
+
+/**
+ * Read the first battery cell voltage from mavlink2rest (port 6040)
+ * @param reachable optional, set to true when the vehicle answered at all
+ * @return voltage in volts, or -1.0 on failure
+ */
+float getMavlinkBatteryVoltage(const String& vehicleIP, bool* reachable = nullptr);
+
+/**
+ * Read the vehicle name from BlueOS (port 9111)
+ * @param success optional, set to true only when the name came from the vehicle
+ * @return the name, or "Vehicle" on failure
+ */
+String getVehicleName(const String& vehicleIP, bool* success = nullptr);
+
+/**
+ * Response timeout cap of the service on a port
+ * @return the cap in milliseconds, or 0 for a port no request goes to
+ */
+uint32_t vehicleServiceMaxTimeout(uint16_t port);
+
+#endif // VEHICLE_API_H
@@ -0,0 +1,163 @@
+/**
+  ******************************************************************************
+  * @file    vehicle_discovery.cpp
+  * @brief   Background mDNS discovery of vehicles advertising _mavlink._udp
+  ******************************************************************************
+*/
+
+#include "vehicle_discovery.h"
+#include <WiFi.h>
+#include <mdns.h>
+#include "power_manager.h"
+
+// Initialize static instance
+VehicleDiscovery* VehicleDiscovery::instance = nullptr;
+
+VehicleDiscovery::VehicleDiscovery() : vehicleCount(0), queryCount(0), task(nullptr) {
+  mutex = xSemaphoreCreateMutex();
+  queryLock = xSemaphoreCreateMutex();
+}
+
+VehicleDiscovery* VehicleDiscovery::getInstance() {
+  if (instance == nullptr) {
+    instance = new VehicleDiscovery();
+  }
+  return instance;
+}
+
+void VehicleDiscovery::begin() {
+  if (task == nullptr) {
+    xTaskCreate(discoveryTask, "discovery", 4096, this, 1, &task);
+  }
+}
+
+void VehicleDiscovery::requestQuery() {
+  if (task != nullptr) {
+    xTaskNotifyGive(task);
+  }
+}
+
+void VehicleDiscovery::pause() {
+  xSemaphoreTake(queryLock, portMAX_DELAY);
+}
+
+void VehicleDiscovery::resume() {
+  xSemaphoreGive(queryLock);
+}
+
+bool VehicleDiscovery::waitForFirstQuery(unsigned long timeoutMs) {
+  unsigned long startTime = millis();
+  while (queryCount == 0 && millis() - startTime < timeoutMs) {
+    delay(10);
+  }
+  return queryCount > 0;
+}
+
+void VehicleDiscovery::seed(const DiscoveredVehicle seeded[], int count) {
+  unsigned long now = millis();
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  for (int i = 0; i < count; i++) {
+    upsert(seeded[i].ip, seeded[i].port, now);
+  }
+  xSemaphoreGive(mutex);
+}
+
+int VehicleDiscovery::getVehicles(DiscoveredVehicle out[], int maxCount) {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  int count = min(vehicleCount, maxCount);
+  for (int i = 0; i < count; i++) {
+    out[i] = vehicles[i];
+  }
+  xSemaphoreGive(mutex);
+  return count;
+}
+
+void VehicleDiscovery::discoveryTask(void* param) {
+  VehicleDiscovery* discovery = static_cast<VehicleDiscovery*>(param);
+  
+  while (true) {
+    if (WiFi.status() == WL_CONNECTED) {
+      discovery->runQuery();
+    }
+    
+    // Sleep until the next interval, or until someone asks for a query
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DISCOVERY_INTERVAL_MS));
+  }
+}
+
+// Caller must hold the mutex
+void VehicleDiscovery::upsert(const String& ip, uint16_t port, unsigned long now) {
+  for (int i = 0; i < vehicleCount; i++) {
+    if (vehicles[i].ip == ip) {
+      vehicles[i].port = port;
+      vehicles[i].lastSeen = now;
+      return;
+    }
+  }
+  
+  if (vehicleCount < MAX_VEHICLES) {
+    vehicles[vehicleCount].ip = ip;
+    vehicles[vehicleCount].port = port;
+    vehicles[vehicleCount].lastSeen = now;
+    vehicleCount++;
+    Serial.println("Found unique vehicle IP: " + ip);
+  }
+}
+
+// Caller must hold the mutex
+void VehicleDiscovery::expire(unsigned long now) {
+  int kept = 0;
+  for (int i = 0; i < vehicleCount; i++) {
+    if (now - vehicles[i].lastSeen < DISCOVERY_ENTRY_TTL_MS) {
+      if (kept != i) {
+        vehicles[kept] = vehicles[i];
+      }
+      kept++;
+    } else {
+      Serial.println("Vehicle expired from discovery table: " + vehicles[i].ip);
+    }
+  }
+  vehicleCount = kept;
+}
+
+void VehicleDiscovery::runQuery() {
+  mdns_result_t* results = nullptr;
+  
+  // Runs on this task only, so the render loop, web server and OTA keep going
+  xSemaphoreTake(queryLock, portMAX_DELAY);
+  powerStateEnter(ENERGY_MDNS);
+  esp_err_t err = mdns_query_ptr("_mavlink", "_udp", DISCOVERY_QUERY_TIMEOUT_MS, MAX_VEHICLES * 2, &results);
+  powerStateLeave(ENERGY_MDNS);
+  xSemaphoreGive(queryLock);
+  if (err != ESP_OK) {
+    Serial.printf("mDNS query failed: %d\n", err);
+    return;
+  }
+  
+  unsigned long now = millis();
+  
+  // Merge the answers into the table instead of rebuilding it
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  for (mdns_result_t* result = results; result != nullptr; result = result->next) {
+    for (mdns_ip_addr_t* addr = result->addr; addr != nullptr; addr = addr->next) {
+      if (addr->addr.type != IPADDR_TYPE_V4) {
+        continue;
+      }
+      
+      String currentIP = IPAddress(addr->addr.u_addr.ip4.addr).toString();
+      
+      // Filter out invalid IPs like 0.0.0.0 early
+      if (currentIP == "0.0.0.0" || currentIP.length() == 0) {
+        Serial.println("Skipping invalid IP: " + currentIP);
+        continue;
+      }
+      
+      upsert(currentIP, result->port, now);
+    }
+  }
+  expire(now);
+  queryCount++;
+  xSemaphoreGive(mutex);
+  
+  mdns_query_results_free(results);
+}
@@ -0,0 +1,90 @@
+/**
+  ******************************************************************************
+  * @file    vehicle_discovery.h
+  * @brief   Background mDNS discovery of vehicles advertising _mavlink._udp
+  ******************************************************************************
+*/
+
+#ifndef VEHICLE_DISCOVERY_H
+#define VEHICLE_DISCOVERY_H
+
+#include <Arduino.h>
+#include "telemetry.h"
+#include "draw_schedule.h"
+
+// Time between two background queries. Each query keeps the radio busy for up to
+// DISCOVERY_QUERY_TIMEOUT_MS, so querying faster than the screen is drawn only
+// costs energy for tables that are never shown.
+#ifndef DISCOVERY_INTERVAL_MS
+#define DISCOVERY_INTERVAL_MS DRAW_INTERVAL_MS
+#endif
+
+// How long one query listens for answers
+#ifndef DISCOVERY_QUERY_TIMEOUT_MS
+#define DISCOVERY_QUERY_TIMEOUT_MS 3000
+#endif
+
+// A vehicle not seen in any answer for this long is dropped from the table,
+// long enough to survive two missed answers in a row
+#ifndef DISCOVERY_ENTRY_TTL_MS
+#define DISCOVERY_ENTRY_TTL_MS (3 * DISCOVERY_INTERVAL_MS)
+#endif
+
+// One vehicle in the discovery table
+struct DiscoveredVehicle {
+  String ip;
+  uint16_t port;          // Advertised MAVLink UDP port
+  unsigned long lastSeen; // millis() of the last answer naming it
+};
+
+// Keeps the vehicle table up to date from a background task
+class VehicleDiscovery {
+private:
+  static VehicleDiscovery* instance;
+  DiscoveredVehicle vehicles[MAX_VEHICLES];
+  int vehicleCount;
+  uint32_t queryCount;
+  SemaphoreHandle_t mutex;
+  SemaphoreHandle_t queryLock; // Held for a whole query, so the responder can't go away under it
+  TaskHandle_t task;
+  
+  VehicleDiscovery();
+  static void discoveryTask(void* param);
+  void runQuery();
+  void upsert(const String& ip, uint16_t port, unsigned long now);
+  void expire(unsigned long now);
+
+public:
+  static VehicleDiscovery* getInstance();
+  
+  // Start the background task
+  void begin();
+  
+  // Ask the background task to query now instead of at the next interval
+  void requestQuery();
+  
+  // Block until the first query finished, only meant for setup()
+  bool waitForFirstQuery(unsigned long timeoutMs);
+  
+  // Run one query on the calling task, for short wake cycles without the background task
+  void queryNow() { runQuery(); }
+  
+  /**
+   * Wait for a running query to finish and hold off new ones, e.g. while the mDNS
+   * responder is restarted. Up to DISCOVERY_QUERY_TIMEOUT_MS; call resume() from the same task.
+   */
+  void pause();
+  
+  void resume();
+  
+  // Fill the table with vehicles remembered from a previous wake
+  void seed(const DiscoveredVehicle seeded[], int count);
+  
+  /**
+   * Copy the current table without touching the network
+   * @return number of vehicles copied
+   */
+  int getVehicles(DiscoveredVehicle out[], int maxCount);
+};
+
+#endif // VEHICLE_DISCOVERY_H
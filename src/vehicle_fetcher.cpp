@@ -0,0 +1,171 @@
+/**
+  ******************************************************************************
+  * @file    vehicle_fetcher.cpp
+  * @brief   Concurrent name/voltage fetching for all discovered vehicles
+  ******************************************************************************
+*/
+
+#include "vehicle_fetcher.h"
+#include "vehicle_api.h"
+#include "http_pool.h"
+#include "live_voltage.h"
+#include "circuit_breaker.h"
+#include "vehicle_name_cache.h"
+#include "power_manager.h"
+
+enum FetchJobType : uint8_t {
+  FETCH_NAME,
+  FETCH_VOLTAGE
+};
+
+// State shared by all jobs of one fetchAll() call
+struct FetchBatch {
+  const String* vehicleIPs;
+  VehicleFetchResult* results;
+  SemaphoreHandle_t done; // Given once per finished job
+};
+
+// Queue item, copied by value into the job queue
+struct FetchJob {
+  FetchBatch* batch;
+  uint8_t index;
+  FetchJobType type;
+};
+
+// Initialize static instance
+VehicleFetcher* VehicleFetcher::instance = nullptr;
+
+VehicleFetcher::VehicleFetcher() {
+  jobQueue = xQueueCreate(MAX_VEHICLES * 2, sizeof(FetchJob));
+  
+  for (int i = 0; i < FETCH_WORKER_COUNT; i++) {
+    char taskName[16];
+    snprintf(taskName, sizeof(taskName), "fetch%d", i);
+    xTaskCreate(workerTask, taskName, FETCH_WORKER_STACK_SIZE, this, 1, nullptr);
+  }
+}
+
+VehicleFetcher* VehicleFetcher::getInstance() {
+  if (instance == nullptr) {
+    instance = new VehicleFetcher();
+  }
+  return instance;
+}
+
+void VehicleFetcher::workerTask(void* param) {
+  VehicleFetcher* fetcher = static_cast<VehicleFetcher*>(param);
+  FetchJob job;
+  
+  while (true) {
+    if (xQueueReceive(fetcher->jobQueue, &job, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+    
+    // Each job writes its own field of its own slot, so no locking is needed
+    const String& vehicleIP = job.batch->vehicleIPs[job.index];
+    VehicleFetchResult& result = job.batch->results[job.index];
+    if (job.type == FETCH_NAME) {
+      bool success = false;
+      result.name = getVehicleName(vehicleIP, &success);
+      if (success) {
+        VehicleNameCache::getInstance()->put(vehicleIP, result.name);
+      } else {
+        // Keep an expired name rather than the placeholder
+        VehicleNameCache::getInstance()->getStale(vehicleIP, result.name);
+      }
+    } else {
+      bool reachable = false;
+      result.voltage = getMavlinkBatteryVoltage(vehicleIP, &reachable);
+      if (reachable) {
+        VehicleHealthTable::getInstance()->recordSuccess(vehicleIP, result.voltage);
+      } else {
+        VehicleHealthTable::getInstance()->recordFailure(vehicleIP);
+        // Show the last known value instead of nothing
+        result.stale = VehicleHealthTable::getInstance()->getLastVoltage(vehicleIP, result.voltage);
+      }
+    }
+    
+    xSemaphoreGive(job.batch->done);
+  }
+}
+
+void VehicleFetcher::fetchAll(const String vehicleIPs[], int count, VehicleFetchResult results[]) {
+  if (count <= 0) {
+    return;
+  }
+  if (count > MAX_VEHICLES) {
+    count = MAX_VEHICLES;
+  }
+  
+  unsigned long startTime = millis();
+  powerLock(POWER_FETCH);
+  powerStateEnter(ENERGY_HTTP);
+  
+  // Drop keep-alive connections to vehicles that went quiet
+  HttpConnectionPool::getInstance()->evictIdle();
+  
+  FetchBatch batch;
+  batch.vehicleIPs = vehicleIPs;
+  batch.results = results;
+  batch.done = xSemaphoreCreateCounting(count * 2, 0);
+  
+  // Queue every request up front so the workers run them in parallel
+  int jobCount = 0;
+  int cachedNames = 0;
+  int liveVoltages = 0;
+  int skippedVehicles = 0;
+  VehicleHealthTable* health = VehicleHealthTable::getInstance();
+  for (int i = 0; i < count; i++) {
+    results[i].name = "Vehicle";
+    results[i].voltage = -1.0f;
+    results[i].stale = false;
+    
+    // A fresh streamed value makes the HTTP voltage request unnecessary
+    if (LiveVoltageStore::getInstance()->get(vehicleIPs[i], LIVE_VOLTAGE_MAX_AGE_MS, results[i].voltage)) {
+      health->recordSuccess(vehicleIPs[i], results[i].voltage);
+      liveVoltages++;
+    }
+    
+    // Unreachable vehicles keep their last known values without any network call.
+    // A half-open breaker lets a single voltage request through as a probe.
+    bool isProbe = false;
+    if (results[i].voltage <= 0 && !health->allowRequest(vehicleIPs[i], isProbe)) {
+      VehicleNameCache::getInstance()->getStale(vehicleIPs[i], results[i].name);
+      results[i].stale = health->getLastVoltage(vehicleIPs[i], results[i].voltage);
+      skippedVehicles++;
+      continue;
+    }
+    
+    // Names rarely change, only ask BlueOS when the cache has no fresh entry
+    if (VehicleNameCache::getInstance()->get(vehicleIPs[i], results[i].name)) {
+      cachedNames++;
+    } else if (isProbe) {
+      VehicleNameCache::getInstance()->getStale(vehicleIPs[i], results[i].name);
+    } else {
+      FetchJob nameJob = { &batch, (uint8_t)i, FETCH_NAME };
+      if (xQueueSend(jobQueue, &nameJob, portMAX_DELAY) == pdTRUE) {
+        jobCount++;
+      }
+    }
+    
+    if (results[i].voltage > 0) {
+      continue;
+    }
+    
+    FetchJob voltageJob = { &batch, (uint8_t)i, FETCH_VOLTAGE };
+    if (xQueueSend(jobQueue, &voltageJob, portMAX_DELAY) == pdTRUE) {
+      jobCount++;
+    }
+  }
+  
+  // Wait for all jobs, the batch lives on this stack frame
+  for (int i = 0; i < jobCount; i++) {
+    xSemaphoreTake(batch.done, portMAX_DELAY);
+  }
+  vSemaphoreDelete(batch.done);
+  powerStateLeave(ENERGY_HTTP);
+  powerUnlock(POWER_FETCH);
+  
+  Serial.printf("Fetched %d vehicles (%d cached names, %d live voltages, %d unreachable) in %lu ms\n",
+                count, cachedNames, liveVoltages, skippedVehicles, millis() - startTime);
+}
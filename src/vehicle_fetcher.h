@@ -0,0 +1,51 @@
+/**
+  ******************************************************************************
+  * @file    vehicle_fetcher.h
+  * @brief   Concurrent name/voltage fetching for all discovered vehicles
+  ******************************************************************************
+*/
+
+#ifndef VEHICLE_FETCHER_H
+#define VEHICLE_FETCHER_H
+
+#include <Arduino.h>
+#include "telemetry.h"
+
+// Number of worker tasks issuing HTTP requests in parallel.
+// Each vehicle needs two requests, so 2 * vehicles workers fetch a whole fleet at once.
+#ifndef FETCH_WORKER_COUNT
+#define FETCH_WORKER_COUNT 6
+#endif
+
+#ifndef FETCH_WORKER_STACK_SIZE
+#define FETCH_WORKER_STACK_SIZE 6144
+#endif
+
+// Result of fetching one vehicle
+struct VehicleFetchResult {
+  String name;
+  float voltage;
+  bool stale; // Vehicle unreachable, voltage is the last known value
+};
+
+// Pool of worker tasks fetching vehicle data in parallel
+class VehicleFetcher {
+private:
+  static VehicleFetcher* instance;
+  QueueHandle_t jobQueue;
+
+  VehicleFetcher();
+  static void workerTask(void* param);
+
+public:
+  static VehicleFetcher* getInstance();
+
+  /**
+   * Fetch name and battery voltage of every vehicle concurrently.
+   * Blocks until all requests completed, so a cycle takes about as long as
+   * the slowest single request instead of the sum of all of them.
+   */
+  void fetchAll(const String vehicleIPs[], int count, VehicleFetchResult results[]);
+};
+
+#endif // VEHICLE_FETCHER_H
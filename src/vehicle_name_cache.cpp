@@ -0,0 +1,110 @@
+/**
+  ******************************************************************************
+  * @file    vehicle_name_cache.cpp
+  * @brief   TTL cache of vehicle names, keyed by vehicle identity (IP address)
+  ******************************************************************************
+*/
+
+#include "vehicle_name_cache.h"
+
+// Initialize static instance
+VehicleNameCache* VehicleNameCache::instance = nullptr;
+
+VehicleNameCache::VehicleNameCache() : ttlMs(VEHICLE_NAME_CACHE_TTL_MS) {
+  mutex = xSemaphoreCreateMutex();
+  for (int i = 0; i < VEHICLE_NAME_CACHE_SIZE; i++) {
+    entries[i].fetchedAt = 0;
+  }
+}
+
+VehicleNameCache* VehicleNameCache::getInstance() {
+  if (instance == nullptr) {
+    instance = new VehicleNameCache();
+  }
+  return instance;
+}
+
+// Caller must hold the mutex
+int VehicleNameCache::findIndex(const String& key) {
+  for (int i = 0; i < VEHICLE_NAME_CACHE_SIZE; i++) {
+    if (entries[i].key.length() > 0 && entries[i].key == key) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool VehicleNameCache::get(const String& key, String& name) {
+  bool hit = false;
+  
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  int index = findIndex(key);
+  if (index >= 0 && millis() - entries[index].fetchedAt < ttlMs) {
+    name = entries[index].name;
+    hit = true;
+  }
+  xSemaphoreGive(mutex);
+  
+  return hit;
+}
+
+bool VehicleNameCache::getStale(const String& key, String& name, unsigned long* ageMs) {
+  bool hit = false;
+  
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  int index = findIndex(key);
+  if (index >= 0) {
+    name = entries[index].name;
+    if (ageMs != nullptr) {
+      *ageMs = millis() - entries[index].fetchedAt;
+    }
+    hit = true;
+  }
+  xSemaphoreGive(mutex);
+  
+  return hit;
+}
+
+void VehicleNameCache::put(const String& key, const String& name, unsigned long ageMs) {
+  unsigned long now = millis();
+  
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  int index = findIndex(key);
+  if (index < 0) {
+    // Take a free slot, or the oldest one; ages rather than times, restored entries may predate boot
+    index = 0;
+    for (int i = 0; i < VEHICLE_NAME_CACHE_SIZE; i++) {
+      if (entries[i].key.length() == 0) {
+        index = i;
+        break;
+      }
+      if (now - entries[i].fetchedAt > now - entries[index].fetchedAt) {
+        index = i;
+      }
+    }
+  }
+  entries[index].key = key;
+  entries[index].name = name;
+  entries[index].fetchedAt = now - ageMs;
+  xSemaphoreGive(mutex);
+}
+
+void VehicleNameCache::invalidate(const String& key) {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  int index = findIndex(key);
+  if (index >= 0) {
+    entries[index].key = "";
+    entries[index].name = "";
+  }
+  xSemaphoreGive(mutex);
+}
+
+void VehicleNameCache::invalidateAll() {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  for (int i = 0; i < VEHICLE_NAME_CACHE_SIZE; i++) {
+    entries[i].key = "";
+    entries[i].name = "";
+  }
+  xSemaphoreGive(mutex);
+  Serial.println("Vehicle name cache cleared");
+}
@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file    vehicle_name_cache.h
+  * @brief   TTL cache of vehicle names, keyed by vehicle identity (IP address)
+  ******************************************************************************
+*/
+
+#ifndef VEHICLE_NAME_CACHE_H
+#define VEHICLE_NAME_CACHE_H
+
+#include <Arduino.h>
+#include "telemetry.h"
+
+// How long a fetched name is trusted before BlueOS is asked again
+#ifndef VEHICLE_NAME_CACHE_TTL_MS
+#define VEHICLE_NAME_CACHE_TTL_MS (30UL * 60UL * 1000UL) // 30 minutes
+#endif
+
+// Number of cached names, a bit larger than the fleet so short-lived entries don't evict it
+#define VEHICLE_NAME_CACHE_SIZE (MAX_VEHICLES * 2)
+
+// Thread-safe name cache shared by the fetch workers
+class VehicleNameCache {
+private:
+  struct Entry {
+    String key;
+    String name;
+    unsigned long fetchedAt;
+  };
+  
+  static VehicleNameCache* instance;
+  Entry entries[VEHICLE_NAME_CACHE_SIZE];
+  unsigned long ttlMs;
+  SemaphoreHandle_t mutex;
+  
+  VehicleNameCache();
+  int findIndex(const String& key);
+
+public:
+  static VehicleNameCache* getInstance();
+  
+  /**
+   * Look up a name that is younger than the TTL
+   * @return true and fills name on a hit
+   */
+  bool get(const String& key, String& name);
+  
+  // Look up a name regardless of its age, for vehicles that can't be asked right now
+  bool getStale(const String& key, String& name, unsigned long* ageMs = nullptr);
+  
+  // Store a name fetched ageMs ago, evicting the oldest entry when full
+  void put(const String& key, const String& name, unsigned long ageMs = 0);
+  
+  // Drop one vehicle, e.g. after it was renamed
+  void invalidate(const String& key);
+  
+  // Drop all names, the next refresh fetches every name again
+  void invalidateAll();
+  
+  void setTtl(unsigned long ttl) { ttlMs = ttl; }
+  unsigned long getTtl() { return ttlMs; }
+};
+
+#endif // VEHICLE_NAME_CACHE_H
@@ -0,0 +1,117 @@
+/**
+  ******************************************************************************
+  * @file    wifi_fast_connect.cpp
+  * @brief   Directed WiFi reconnect from the cached channel, BSSID and IP lease
+  ******************************************************************************
+*/
+
+#include "wifi_fast_connect.h"
+#include "rtc_state.h"
+#include <WiFi.h>
+
+// Set from the WiFi event task
+static volatile unsigned long associationStartedAt = 0;
+static volatile unsigned long associatedAt = 0;
+static volatile unsigned long gotIpAt = 0;
+
+// The cached lease is configured as a static address, so the connection did not run DHCP
+static bool staticIpApplied = false;
+
+void wifiTimingBegin() {
+  WiFi.onEvent([](WiFiEvent_t event, WiFiEventInfo_t info) {
+    associatedAt = millis();
+  }, ARDUINO_EVENT_WIFI_STA_CONNECTED);
+  
+  WiFi.onEvent([](WiFiEvent_t event, WiFiEventInfo_t info) {
+    gotIpAt = millis();
+  }, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+}
+
+void wifiTimingStart() {
+  associatedAt = 0;
+  gotIpAt = 0;
+  associationStartedAt = millis();
+}
+
+void wifiTimingFinish(bool fastPath, uint32_t scanMs) {
+  RtcWifiTimings& timings = rtcState.wifiTimings;
+  unsigned long now = millis();
+  unsigned long associated = associatedAt != 0 ? associatedAt : now;
+  unsigned long gotIp = gotIpAt != 0 ? gotIpAt : now;
+  
+  timings.scanMs = scanMs;
+  timings.associateMs = associated - associationStartedAt;
+  timings.dhcpMs = gotIp > associated ? gotIp - associated : 0;
+  timings.totalMs = scanMs + (now - associationStartedAt);
+  timings.fastPath = fastPath;
+  
+  if (fastPath) {
+    timings.fastConnects++;
+    timings.fastTotalMs += timings.totalMs;
+  } else {
+    timings.fullConnects++;
+    timings.fullTotalMs += timings.totalMs;
+  }
+  
+  Serial.printf("WiFi %s connect: scan %u ms, associate %u ms, DHCP %u ms, total %u ms\n",
+                fastPath ? "fast" : "full", timings.scanMs, timings.associateMs,
+                timings.dhcpMs, timings.totalMs);
+}
+
+FastConnectMode wifiFastConnectBegin(const char* ssid, const char* password) {
+  RtcWifiCache& cache = rtcState.wifiCache;
+  if (!cache.valid) {
+    return FAST_CONNECT_UNAVAILABLE;
+  }
+  
+  bool leaseFresh = rtcStateUptimeMs() - cache.savedAtMs < WIFI_LEASE_REUSE_MS;
+  Serial.printf("Fast WiFi connect on channel %u%s\n", cache.channel, leaseFresh ? " with cached IP" : "");
+  
+  WiFi.disconnect();
+  WiFi.mode(WIFI_STA);
+  if (leaseFresh) {
+    // Static configuration skips the DHCP exchange
+    WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet), IPAddress(cache.dns));
+    staticIpApplied = true;
+  } else {
+    // A static address from an earlier connect would otherwise stay, and outlive the lease
+    wifiUseDhcp();
+  }
+  
+  wifiTimingStart();
+  WiFi.begin(ssid, password, cache.channel, cache.bssid);
+  
+  return leaseFresh ? FAST_CONNECT_STATIC_IP : FAST_CONNECT_DHCP;
+}
+
+void wifiFastConnectFailed() {
+  // The AP moved, changed channel or is gone: forget it and go back to scan + DHCP
+  Serial.println("Fast WiFi connect failed, falling back to a full scan");
+  rtcState.wifiTimings.fastFailures++;
+  rtcState.wifiCache.valid = false;
+  WiFi.disconnect();
+  wifiUseDhcp();
+}
+
+void wifiUseDhcp() {
+  WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
+  staticIpApplied = false;
+}
+
+void wifiSaveConnectionCache() {
+  RtcWifiCache& cache = rtcState.wifiCache;
+  uint8_t* bssid = WiFi.BSSID();
+  if (bssid == nullptr || staticIpApplied) {
+    // Only a lease DHCP just handed out is fresh, not the cached one configured again
+    return;
+  }
+  
+  cache.channel = WiFi.channel();
+  memcpy(cache.bssid, bssid, sizeof(cache.bssid));
+  cache.ip = (uint32_t)WiFi.localIP();
+  cache.gateway = (uint32_t)WiFi.gatewayIP();
+  cache.subnet = (uint32_t)WiFi.subnetMask();
+  cache.dns = (uint32_t)WiFi.dnsIP();
+  cache.savedAtMs = rtcStateUptimeMs();
+  cache.valid = true;
+}
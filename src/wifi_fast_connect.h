@@ -0,0 +1,54 @@
+/**
+  ******************************************************************************
+  * @file    wifi_fast_connect.h
+  * @brief   Directed WiFi reconnect from the cached channel, BSSID and IP lease
+  ******************************************************************************
+*/
+
+#ifndef WIFI_FAST_CONNECT_H
+#define WIFI_FAST_CONNECT_H
+
+#include <Arduino.h>
+
+// How long a directed connect may take before falling back to a full scan
+#ifndef WIFI_FAST_CONNECT_TIMEOUT_MS
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 3000
+#endif
+
+// The cached IP is reused as a static address for this long, well inside typical DHCP leases
+#ifndef WIFI_LEASE_REUSE_MS
+#define WIFI_LEASE_REUSE_MS (60UL * 60UL * 1000UL)
+#endif
+
+// How a directed connect was started
+enum FastConnectMode : uint8_t {
+  FAST_CONNECT_UNAVAILABLE, // Nothing cached, a scan is needed
+  FAST_CONNECT_STATIC_IP,   // Cached AP and cached IP, no DHCP
+  FAST_CONNECT_DHCP         // Cached AP, lease too old so DHCP runs
+};
+
+// Register the event handler timing association and DHCP, call once before connecting
+void wifiTimingBegin();
+
+// Mark the start of an association, so its phases can be measured
+void wifiTimingStart();
+
+// Store the phase durations of a finished connection in RTC memory and log them
+void wifiTimingFinish(bool fastPath, uint32_t scanMs);
+
+/**
+ * Start connecting to the cached AP on its channel, with the cached static IP
+ * while the lease is fresh. Returns immediately, completion is signalled by WiFi events.
+ */
+FastConnectMode wifiFastConnectBegin(const char* ssid, const char* password);
+
+// Forget the cached AP and re-enable DHCP after a directed connect failed
+void wifiFastConnectFailed();
+
+// Drop a static address applied from the cache, so the next association runs DHCP
+void wifiUseDhcp();
+
+// Remember the current AP and the IP lease; ignored while the cached lease is configured
+void wifiSaveConnectionCache();
+
+#endif // WIFI_FAST_CONNECT_H
@@ -0,0 +1,306 @@
+/**
+  ******************************************************************************
+  * @file    wifi_manager.cpp
+  * @brief   Event-driven WiFi connection state machine, advanced from loop()
+  ******************************************************************************
+*/
+
+#include "wifi_manager.h"
+#include "power_manager.h"
+
+// Initialize static instance
+WiFiManager* WiFiManager::instance = nullptr;
+
+WiFiManager::WiFiManager()
+  : ssid(nullptr), password(nullptr), onConnected(nullptr), onUnavailable(nullptr),
+    state(WIFI_STATE_IDLE), stateSince(0), deadline(0), attempts(0), fastMode(FAST_CONNECT_UNAVAILABLE), scanMs(0),
+    associatedEvent(false), gotIpEvent(false), disconnectedEvent(false),
+    historyHead(0), historyCount(0) {
+  vPortCPUInitializeMutex(&lock);
+}
+
+WiFiManager* WiFiManager::getInstance() {
+  if (instance == nullptr) {
+    instance = new WiFiManager();
+  }
+  return instance;
+}
+
+void WiFiManager::begin(const char* ssid, const char* password,
+                        WiFiConnectedCallback onConnected, WiFiUnavailableCallback onUnavailable) {
+  this->ssid = ssid;
+  this->password = password;
+  this->onConnected = onConnected;
+  this->onUnavailable = onUnavailable;
+  
+  // Reconnection is ours, the driver retrying on its own would race the state machine
+  WiFi.persistent(false);
+  WiFi.setAutoReconnect(false);
+  
+  WiFi.onEvent([](WiFiEvent_t event, WiFiEventInfo_t info) {
+    instance->associatedEvent = true;
+  }, ARDUINO_EVENT_WIFI_STA_CONNECTED);
+  
+  WiFi.onEvent([](WiFiEvent_t event, WiFiEventInfo_t info) {
+    instance->gotIpEvent = true;
+  }, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+  
+  WiFi.onEvent([](WiFiEvent_t event, WiFiEventInfo_t info) {
+    instance->handleDisconnect(info.wifi_sta_disconnected.reason);
+  }, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+  
+  startConnecting();
+}
+
+// Runs on the WiFi event task
+void WiFiManager::handleDisconnect(uint8_t reason) {
+  portENTER_CRITICAL(&lock);
+  history[historyHead].reason = reason;
+  history[historyHead].at = millis();
+  historyHead = (historyHead + 1) % WIFI_DISCONNECT_HISTORY;
+  if (historyCount < WIFI_DISCONNECT_HISTORY) {
+    historyCount++;
+  }
+  portEXIT_CRITICAL(&lock);
+  
+  disconnectedEvent = true;
+}
+
+// Power state charged while the connection is in a WiFi state, ENERGY_STATE_COUNT for none
+static EnergyState energyStateFor(WiFiState state) {
+  switch (state) {
+    case WIFI_STATE_SCANNING: return ENERGY_SCAN;
+    case WIFI_STATE_FAST_CONNECT: return ENERGY_ASSOCIATE;
+    case WIFI_STATE_ASSOCIATING: return ENERGY_ASSOCIATE;
+    case WIFI_STATE_DHCP: return ENERGY_DHCP;
+    default: return ENERGY_STATE_COUNT;
+  }
+}
+
+void WiFiManager::enterState(WiFiState next, unsigned long timeoutMs) {
+  if (energyStateFor(state) != ENERGY_STATE_COUNT) {
+    powerStateLeave(energyStateFor(state));
+  }
+  if (energyStateFor(next) != ENERGY_STATE_COUNT) {
+    powerStateEnter(energyStateFor(next));
+  }
+  state = next;
+  stateSince = millis();
+  deadline = stateSince + timeoutMs;
+}
+
+void WiFiManager::startConnecting() {
+  associatedEvent = false;
+  gotIpEvent = false;
+  disconnectedEvent = false;
+  
+  // Try the cached AP and IP lease first, it skips both the scan and DHCP
+  fastMode = wifiFastConnectBegin(ssid, password);
+  if (fastMode != FAST_CONNECT_UNAVAILABLE) {
+    enterState(WIFI_STATE_FAST_CONNECT, WIFI_FAST_CONNECT_TIMEOUT_MS);
+    return;
+  }
+  
+  startScan();
+}
+
+void WiFiManager::startScan() {
+  Serial.println("Scanning for WiFi networks...");
+  fastMode = FAST_CONNECT_UNAVAILABLE;
+  WiFi.disconnect();
+  WiFi.mode(WIFI_STA);
+  wifiUseDhcp();
+  WiFi.scanNetworks(true);
+  enterState(WIFI_STATE_SCANNING, WIFI_SCAN_TIMEOUT_MS);
+}
+
+void WiFiManager::startAssociation() {
+  attempts++;
+  Serial.printf("WiFi network found, attempt %d of %d to connect...\n", attempts, WIFI_MAX_CONNECT_ATTEMPTS);
+  
+  associatedEvent = false;
+  gotIpEvent = false;
+  disconnectedEvent = false;
+  
+  wifiTimingStart();
+  WiFi.begin(ssid, password);
+  enterState(WIFI_STATE_ASSOCIATING, WIFI_ASSOCIATE_TIMEOUT_MS);
+}
+
+void WiFiManager::finishConnected() {
+  // Record the phases and remember the AP for a directed connect next time
+  bool fastPath = fastMode != FAST_CONNECT_UNAVAILABLE;
+  wifiTimingFinish(fastPath, fastPath ? 0 : scanMs);
+  if (fastMode != FAST_CONNECT_STATIC_IP) {
+    // DHCP ran, remember the new lease
+    wifiSaveConnectionCache();
+  }
+  
+  attempts = 0;
+  disconnectedEvent = false;
+  enterState(WIFI_STATE_CONNECTED, 0);
+  
+  if (onConnected != nullptr) {
+    onConnected();
+  }
+}
+
+void WiFiManager::attemptFailed() {
+  WiFi.disconnect();
+  if (attempts >= WIFI_MAX_CONNECT_ATTEMPTS) {
+    Serial.println("Maximum WiFi reconnection attempts reached.");
+    giveUp(WIFI_CONNECT_FAILED);
+    return;
+  }
+  enterState(WIFI_STATE_BACKOFF, WIFI_RETRY_BACKOFF_MS);
+}
+
+void WiFiManager::giveUp(WiFiUnavailableReason reason) {
+  attempts = 0;
+  enterState(WIFI_STATE_UNAVAILABLE, 0);
+  
+  if (onUnavailable != nullptr) {
+    onUnavailable(reason);
+  }
+  
+  // The owner did not sleep, keep trying at a slow pace
+  if (state == WIFI_STATE_UNAVAILABLE) {
+    enterState(WIFI_STATE_BACKOFF, WIFI_RETRY_BACKOFF_MS * 5);
+  }
+}
+
+void WiFiManager::poll() {
+  unsigned long now = millis();
+  bool timedOut = (long)(now - deadline) >= 0;
+  
+  // Take the events that arrived since the last poll
+  portENTER_CRITICAL(&lock);
+  bool associated = associatedEvent;
+  bool gotIp = gotIpEvent;
+  bool disconnected = disconnectedEvent;
+  associatedEvent = false;
+  gotIpEvent = false;
+  disconnectedEvent = false;
+  portEXIT_CRITICAL(&lock);
+  
+  switch (state) {
+    case WIFI_STATE_IDLE:
+      break;
+      
+    case WIFI_STATE_FAST_CONNECT:
+      // With the cached static IP there is no GOT_IP event to wait for
+      if (gotIp || WiFi.status() == WL_CONNECTED) {
+        finishConnected();
+      } else if (disconnected || timedOut) {
+        wifiFastConnectFailed();
+        startScan();
+      }
+      break;
+      
+    case WIFI_STATE_SCANNING: {
+      int16_t n = WiFi.scanComplete();
+      if (n == WIFI_SCAN_RUNNING && !timedOut) {
+        break;
+      }
+      scanMs = now - stateSince;
+      Serial.printf("Scan complete, %d networks found in %u ms\n", n, scanMs);
+      
+      bool networkFound = false;
+      for (int i = 0; i < n && !networkFound; i++) {
+        if (WiFi.SSID(i) == ssid) {
+          networkFound = true;
+          Serial.printf("Target network '%s' found with signal strength %d dBm\n", ssid, WiFi.RSSI(i));
+        }
+      }
+      WiFi.scanDelete();
+      
+      if (networkFound) {
+        startAssociation();
+      } else if (n < 0) {
+        // The driver refused or aborted the scan, not proof the network is gone
+        enterState(WIFI_STATE_BACKOFF, WIFI_RETRY_BACKOFF_MS);
+      } else {
+        Serial.printf("Target network '%s' not found in scan results\n", ssid);
+        giveUp(WIFI_NETWORK_NOT_FOUND);
+      }
+      break;
+    }
+      
+    case WIFI_STATE_ASSOCIATING:
+      if (gotIp) {
+        finishConnected();
+      } else if (associated) {
+        enterState(WIFI_STATE_DHCP, WIFI_DHCP_TIMEOUT_MS);
+      } else if (disconnected || timedOut) {
+        attemptFailed();
+      }
+      break;
+      
+    case WIFI_STATE_DHCP:
+      if (gotIp) {
+        finishConnected();
+      } else if (disconnected || timedOut) {
+        attemptFailed();
+      }
+      break;
+      
+    case WIFI_STATE_CONNECTED:
+      if (disconnected) {
+        Serial.println("WiFi disconnected, starting reconnection attempts...");
+        startConnecting();
+      }
+      break;
+      
+    case WIFI_STATE_BACKOFF:
+      if (timedOut) {
+        startConnecting();
+      }
+      break;
+      
+    case WIFI_STATE_UNAVAILABLE:
+      break;
+  }
+}
+
+int WiFiManager::getDisconnects(WiFiDisconnectRecord out[], int maxCount) {
+  portENTER_CRITICAL(&lock);
+  int count = historyCount < maxCount ? historyCount : maxCount;
+  for (int i = 0; i < count; i++) {
+    int index = (historyHead + WIFI_DISCONNECT_HISTORY - 1 - i) % WIFI_DISCONNECT_HISTORY;
+    out[i] = history[index];
+  }
+  portEXIT_CRITICAL(&lock);
+  return count;
+}
+
+const char* WiFiManager::stateName(WiFiState state) {
+  switch (state) {
+    case WIFI_STATE_IDLE: return "idle";
+    case WIFI_STATE_FAST_CONNECT: return "fast connect";
+    case WIFI_STATE_SCANNING: return "scanning";
+    case WIFI_STATE_ASSOCIATING: return "associating";
+    case WIFI_STATE_DHCP: return "DHCP";
+    case WIFI_STATE_CONNECTED: return "connected";
+    case WIFI_STATE_BACKOFF: return "backoff";
+    case WIFI_STATE_UNAVAILABLE: return "unavailable";
+  }
+  return "?";
+}
+
+// The wifi_err_reason_t codes seen in practice
+const char* WiFiManager::reasonName(uint8_t reason) {
+  switch (reason) {
+    case 2: return "auth expired";
+    case 3: return "auth leave";
+    case 4: return "assoc expired";
+    case 8: return "assoc leave";
+    case 15: return "4-way handshake timeout";
+    case 200: return "beacon timeout";
+    case 201: return "no AP found";
+    case 202: return "auth failed";
+    case 203: return "assoc failed";
+    case 204: return "handshake timeout";
+    case 205: return "connection failed";
+  }
+  return "other";
+}
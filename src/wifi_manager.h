@@ -0,0 +1,133 @@
+/**
+  ******************************************************************************
+  * @file    wifi_manager.h
+  * @brief   Event-driven WiFi connection state machine, advanced from loop()
+  ******************************************************************************
+*/
+
+#ifndef WIFI_MANAGER_H
+#define WIFI_MANAGER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "wifi_fast_connect.h"
+
+// How long association may take after WiFi.begin()
+#ifndef WIFI_ASSOCIATE_TIMEOUT_MS
+#define WIFI_ASSOCIATE_TIMEOUT_MS 5000
+#endif
+
+// How long DHCP may take after association
+#ifndef WIFI_DHCP_TIMEOUT_MS
+#define WIFI_DHCP_TIMEOUT_MS 5000
+#endif
+
+// Upper bound for an asynchronous scan
+#ifndef WIFI_SCAN_TIMEOUT_MS
+#define WIFI_SCAN_TIMEOUT_MS 10000
+#endif
+
+// Failed associations to a visible network before giving up
+#ifndef WIFI_MAX_CONNECT_ATTEMPTS
+#define WIFI_MAX_CONNECT_ATTEMPTS 1
+#endif
+
+// Pause between two connection attempts
+#ifndef WIFI_RETRY_BACKOFF_MS
+#define WIFI_RETRY_BACKOFF_MS 2000
+#endif
+
+// Number of disconnect reasons kept for diagnostics
+#ifndef WIFI_DISCONNECT_HISTORY
+#define WIFI_DISCONNECT_HISTORY 8
+#endif
+
+enum WiFiState : uint8_t {
+  WIFI_STATE_IDLE,
+  WIFI_STATE_FAST_CONNECT, // Directed connect to the cached AP
+  WIFI_STATE_SCANNING,
+  WIFI_STATE_ASSOCIATING,
+  WIFI_STATE_DHCP,
+  WIFI_STATE_CONNECTED,
+  WIFI_STATE_BACKOFF,      // Waiting before the next attempt
+  WIFI_STATE_UNAVAILABLE   // Gave up, the owner decides what happens next
+};
+
+// Why the manager gave up
+enum WiFiUnavailableReason : uint8_t {
+  WIFI_NETWORK_NOT_FOUND,
+  WIFI_CONNECT_FAILED
+};
+
+// One disconnect reported by the WiFi driver
+struct WiFiDisconnectRecord {
+  uint8_t reason;   // wifi_err_reason_t
+  unsigned long at; // millis()
+};
+
+typedef void (*WiFiConnectedCallback)();
+typedef void (*WiFiUnavailableCallback)(WiFiUnavailableReason reason);
+
+// Drives the connection from WiFi events, poll() never blocks
+class WiFiManager {
+private:
+  static WiFiManager* instance;
+  const char* ssid;
+  const char* password;
+  WiFiConnectedCallback onConnected;
+  WiFiUnavailableCallback onUnavailable;
+  
+  WiFiState state;
+  unsigned long stateSince;
+  unsigned long deadline;
+  uint8_t attempts;
+  FastConnectMode fastMode; // FAST_CONNECT_UNAVAILABLE on the scan path
+  uint32_t scanMs;
+  
+  // Set from the WiFi event task, consumed by poll()
+  volatile bool associatedEvent;
+  volatile bool gotIpEvent;
+  volatile bool disconnectedEvent;
+  
+  WiFiDisconnectRecord history[WIFI_DISCONNECT_HISTORY];
+  uint8_t historyHead;
+  uint8_t historyCount;
+  portMUX_TYPE lock;
+  
+  WiFiManager();
+  void handleDisconnect(uint8_t reason);
+  void enterState(WiFiState next, unsigned long timeoutMs);
+  void startConnecting();
+  void startScan();
+  void startAssociation();
+  void finishConnected();
+  void attemptFailed();
+  void giveUp(WiFiUnavailableReason reason);
+
+public:
+  static WiFiManager* getInstance();
+  
+  // Register the event handlers and start connecting
+  void begin(const char* ssid, const char* password,
+             WiFiConnectedCallback onConnected, WiFiUnavailableCallback onUnavailable);
+  
+  // Advance the state machine, call from every loop() iteration
+  void poll();
+  
+  WiFiState getState() const { return state; }
+  bool isConnected() const { return state == WIFI_STATE_CONNECTED; }
+  
+  // Milliseconds spent in the current state
+  unsigned long timeInState() const { return millis() - stateSince; }
+  
+  /**
+   * Copy the most recent disconnects, newest first
+   * @return number of records copied
+   */
+  int getDisconnects(WiFiDisconnectRecord out[], int maxCount);
+  
+  static const char* stateName(WiFiState state);
+  static const char* reasonName(uint8_t reason);
+};
+
+#endif // WIFI_MANAGER_H
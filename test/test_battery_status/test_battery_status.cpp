@@ -0,0 +1,236 @@
+/**
+  ******************************************************************************
+  * @file    test_battery_status.cpp
+  * @brief   mavlink2rest WebSocket messages through the BATTERY_STATUS parser
+  ******************************************************************************
+  *
+  * Run with PlatformIO:  pio test -e native -f test_battery_status
+  *
+  * The stream is what mavlink2rest sends on /v1/ws/mavlink?filter=BATTERY_STATUS
+  * for a vehicle with a second battery monitor and a gimbal reporting its own
+  * battery: only the autopilot's main battery may reach the watch, at most one
+  * voltage per throttle interval and vehicle.
+*/
+
+#include <unity.h>
+#include <string.h>
+#include "battery_status_parser.h"
+#include "stream_subscriptions.h"
+
+// BATTERY_STREAM_MIN_INTERVAL_MS, battery_stream.h needs the Arduino core
+#define INTERVAL_MS 5000
+
+static const char* const AUTOPILOT_MAIN =
+  "{\"header\":{\"system_id\":1,\"component_id\":1,\"sequence\":118},\"message\":{\"type\":\"BATTERY_STATUS\","
+  "\"id\":0,\"battery_function\":{\"type\":\"MAV_BATTERY_FUNCTION_ALL\"},\"mavtype\":{\"type\":\"MAV_BATTERY_TYPE_LIPO\"},"
+  "\"temperature\":32767,\"voltages\":[15894,65535,65535,65535,65535,65535,65535,65535,65535,65535],"
+  "\"current_battery\":1242,\"current_consumed\":612,\"energy_consumed\":-1,\"battery_remaining\":71,"
+  "\"time_remaining\":0,\"charge_state\":{\"type\":\"MAV_BATTERY_CHARGE_STATE_OK\"},"
+  "\"voltages_ext\":[0,0,0,0],\"mode\":{\"type\":\"MAV_BATTERY_MODE_UNKNOWN\"},\"fault_bitmask\":{\"bits\":0}}}";
+
+static const char* const AUTOPILOT_SECOND =
+  "{\"header\":{\"system_id\":1,\"component_id\":1,\"sequence\":119},\"message\":{\"type\":\"BATTERY_STATUS\","
+  "\"id\":1,\"battery_function\":{\"type\":\"MAV_BATTERY_FUNCTION_ALL\"},\"mavtype\":{\"type\":\"MAV_BATTERY_TYPE_LIPO\"},"
+  "\"temperature\":32767,\"voltages\":[4987,65535,65535,65535,65535,65535,65535,65535,65535,65535],"
+  "\"current_battery\":-1,\"current_consumed\":-1,\"energy_consumed\":-1,\"battery_remaining\":-1,"
+  "\"time_remaining\":0,\"charge_state\":{\"type\":\"MAV_BATTERY_CHARGE_STATE_UNDEFINED\"},"
+  "\"voltages_ext\":[0,0,0,0],\"mode\":{\"type\":\"MAV_BATTERY_MODE_UNKNOWN\"},\"fault_bitmask\":{\"bits\":0}}}";
+
+static const char* const GIMBAL =
+  "{\"header\":{\"system_id\":1,\"component_id\":154,\"sequence\":7},\"message\":{\"type\":\"BATTERY_STATUS\","
+  "\"id\":0,\"battery_function\":{\"type\":\"MAV_BATTERY_FUNCTION_PAYLOAD\"},\"mavtype\":{\"type\":\"MAV_BATTERY_TYPE_LIPO\"},"
+  "\"temperature\":32767,\"voltages\":[7612,65535,65535,65535,65535,65535,65535,65535,65535,65535],"
+  "\"current_battery\":-1,\"current_consumed\":-1,\"energy_consumed\":-1,\"battery_remaining\":88,"
+  "\"time_remaining\":0,\"charge_state\":{\"type\":\"MAV_BATTERY_CHARGE_STATE_OK\"},"
+  "\"voltages_ext\":[0,0,0,0],\"mode\":{\"type\":\"MAV_BATTERY_MODE_UNKNOWN\"},\"fault_bitmask\":{\"bits\":0}}}";
+
+// A second vehicle on the same mavlink2rest instance, e.g. a companion's simulator
+static const char* const OTHER_SYSTEM =
+  "{\"header\":{\"system_id\":2,\"component_id\":1,\"sequence\":64},\"message\":{\"type\":\"BATTERY_STATUS\","
+  "\"id\":0,\"battery_function\":{\"type\":\"MAV_BATTERY_FUNCTION_ALL\"},\"mavtype\":{\"type\":\"MAV_BATTERY_TYPE_LIPO\"},"
+  "\"temperature\":32767,\"voltages\":[12600,65535,65535,65535,65535,65535,65535,65535,65535,65535],"
+  "\"current_battery\":0,\"current_consumed\":0,\"energy_consumed\":-1,\"battery_remaining\":100,"
+  "\"time_remaining\":0,\"charge_state\":{\"type\":\"MAV_BATTERY_CHARGE_STATE_OK\"},"
+  "\"voltages_ext\":[0,0,0,0],\"mode\":{\"type\":\"MAV_BATTERY_MODE_UNKNOWN\"},\"fault_bitmask\":{\"bits\":0}}}";
+
+// Before the autopilot has a cell voltage
+static const char* const UNKNOWN_VOLTAGE =
+  "{\"header\":{\"system_id\":1,\"component_id\":1,\"sequence\":3},\"message\":{\"type\":\"BATTERY_STATUS\","
+  "\"id\":0,\"battery_function\":{\"type\":\"MAV_BATTERY_FUNCTION_ALL\"},\"mavtype\":{\"type\":\"MAV_BATTERY_TYPE_LIPO\"},"
+  "\"temperature\":32767,\"voltages\":[65535,65535,65535,65535,65535,65535,65535,65535,65535,65535],"
+  "\"current_battery\":-1,\"current_consumed\":-1,\"energy_consumed\":-1,\"battery_remaining\":-1,"
+  "\"time_remaining\":0,\"charge_state\":{\"type\":\"MAV_BATTERY_CHARGE_STATE_UNDEFINED\"},"
+  "\"voltages_ext\":[0,0,0,0],\"mode\":{\"type\":\"MAV_BATTERY_MODE_UNKNOWN\"},\"fault_bitmask\":{\"bits\":0}}}";
+
+static const char* const HEARTBEAT =
+  "{\"header\":{\"system_id\":1,\"component_id\":1,\"sequence\":120},\"message\":{\"type\":\"HEARTBEAT\","
+  "\"custom_mode\":19,\"mavtype\":{\"type\":\"MAV_TYPE_SUBMARINE\"},\"autopilot\":{\"type\":\"MAV_AUTOPILOT_ARDUPILOTMEGA\"},"
+  "\"base_mode\":{\"bits\":81},\"system_status\":{\"type\":\"MAV_STATE_STANDBY\"},\"mavlink_version\":3}}";
+
+static bool parse(const char* json, float& volts) {
+  return parseBatteryStatusVoltage(json, strlen(json), volts);
+}
+
+static void test_accepts_autopilot_main_battery() {
+  float volts = 0;
+  TEST_ASSERT_TRUE(parse(AUTOPILOT_MAIN, volts));
+  TEST_ASSERT_FLOAT_WITHIN(0.0005f, 15.894f, volts);
+}
+
+static void test_rejects_other_batteries_and_senders() {
+  float volts = -1;
+  TEST_ASSERT_FALSE(parse(AUTOPILOT_SECOND, volts));
+  TEST_ASSERT_FALSE(parse(GIMBAL, volts));
+  TEST_ASSERT_FALSE(parse(OTHER_SYSTEM, volts));
+  TEST_ASSERT_FALSE(parse(UNKNOWN_VOLTAGE, volts));
+  TEST_ASSERT_FALSE(parse(HEARTBEAT, volts));
+  TEST_ASSERT_FLOAT_WITHIN(0.0001f, -1.0f, volts);
+}
+
+// The recorded stream in order: the watch only ever sees the main battery
+static void test_stream_keeps_main_battery() {
+  const char* const stream[] = { UNKNOWN_VOLTAGE, HEARTBEAT, AUTOPILOT_MAIN, AUTOPILOT_SECOND, GIMBAL,
+                                 OTHER_SYSTEM, HEARTBEAT, AUTOPILOT_SECOND };
+  float last = -1;
+  int accepted = 0;
+  for (const char* json : stream) {
+    float volts;
+    if (parse(json, volts)) {
+      last = volts;
+      accepted++;
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(1, accepted);
+  TEST_ASSERT_FLOAT_WITHIN(0.0005f, 15.894f, last);
+}
+
+// WebSocket frames are not null-terminated: nothing past length is read
+static void test_stops_at_length() {
+  char buffer[1024];
+  size_t length = strlen(AUTOPILOT_MAIN);
+  memcpy(buffer, AUTOPILOT_MAIN, length);
+  float volts;
+  const char* voltages = strstr(AUTOPILOT_MAIN, "\"voltages\":[");
+  size_t cut = (voltages - AUTOPILOT_MAIN) + strlen("\"voltages\":[");
+  TEST_ASSERT_FALSE(parseBatteryStatusVoltage(buffer, cut, volts));
+  TEST_ASSERT_TRUE(parseBatteryStatusVoltage(buffer, length, volts));
+}
+
+static uint32_t ip(uint8_t last) {
+  return 0x0002A8C0UL | ((uint32_t)last << 24);
+}
+
+// Vehicles staying in the table keep their slot, so their connection stays up
+static void test_subscriptions_keep_slots() {
+  uint32_t slots[3] = { 0, 0, 0 };
+  const uint32_t first[] = { ip(2), ip(3) };
+  TEST_ASSERT_EQUAL_INT(0, streamSubscriptionsAssign(slots, 3, first, 2));
+  TEST_ASSERT_EQUAL_UINT32(ip(2), slots[0]);
+  TEST_ASSERT_EQUAL_UINT32(ip(3), slots[1]);
+  TEST_ASSERT_EQUAL_UINT32(0, slots[2]);
+  
+  // 192.168.2.2 leaves, 192.168.2.4 takes its slot, 192.168.2.3 stays where it was
+  const uint32_t second[] = { ip(3), ip(4) };
+  TEST_ASSERT_EQUAL_INT(0, streamSubscriptionsAssign(slots, 3, second, 2));
+  TEST_ASSERT_EQUAL_UINT32(ip(4), slots[0]);
+  TEST_ASSERT_EQUAL_UINT32(ip(3), slots[1]);
+  TEST_ASSERT_EQUAL_UINT32(0, slots[2]);
+  
+  const uint32_t none[] = { 0 };
+  TEST_ASSERT_EQUAL_INT(0, streamSubscriptionsAssign(slots, 3, none, 0));
+  TEST_ASSERT_EQUAL_UINT32(0, slots[0]);
+  TEST_ASSERT_EQUAL_UINT32(0, slots[1]);
+}
+
+// Each vehicle once, unparsed addresses skipped, the rest counted when full
+static void test_subscriptions_skip_duplicates_and_overflow() {
+  uint32_t slots[2] = { 0, 0 };
+  const uint32_t wanted[] = { ip(2), 0, ip(2), ip(3), ip(4), ip(5) };
+  TEST_ASSERT_EQUAL_INT(2, streamSubscriptionsAssign(slots, 2, wanted, 6));
+  TEST_ASSERT_EQUAL_UINT32(ip(2), slots[0]);
+  TEST_ASSERT_EQUAL_UINT32(ip(3), slots[1]);
+}
+
+// What BatteryStream::handleMessage does with one message
+static bool receive(StreamThrottle& throttle, const char* json, uint32_t nowMs, float& volts) {
+  if (!streamThrottleReady(throttle, nowMs, INTERVAL_MS) || !parse(json, volts)) {
+    return false;
+  }
+  streamThrottleAccept(throttle, nowMs);
+  return true;
+}
+
+// A minute of the recorded stream at one message per second
+static int receiveMinute(uint32_t startMs, uint32_t acceptedMs[], int maxAccepted) {
+  const char* const stream[] = { AUTOPILOT_MAIN, AUTOPILOT_SECOND, HEARTBEAT, GIMBAL };
+  StreamThrottle throttle;
+  streamThrottleReset(throttle);
+  int accepted = 0;
+  for (uint32_t second = 0; second < 60; second++) {
+    uint32_t now = startMs + second * 1000;
+    float volts = -1;
+    if (receive(throttle, stream[second % 4], now, volts)) {
+      TEST_ASSERT_FLOAT_WITHIN(0.0005f, 15.894f, volts);
+      TEST_ASSERT_TRUE(accepted < maxAccepted);
+      acceptedMs[accepted++] = now;
+    }
+  }
+  return accepted;
+}
+
+// The first main battery voltage right away, then one per interval
+static void test_throttle_spaces_main_battery() {
+  uint32_t acceptedMs[60];
+  int accepted = receiveMinute(0, acceptedMs, 60);
+  
+  // Main battery every 4 s, so taken every 8 s: 0, 8, ... 56
+  TEST_ASSERT_EQUAL_INT(8, accepted);
+  TEST_ASSERT_EQUAL_UINT32(0, acceptedMs[0]);
+  for (int i = 1; i < accepted; i++) {
+    TEST_ASSERT_TRUE(acceptedMs[i] - acceptedMs[i - 1] >= INTERVAL_MS);
+  }
+}
+
+// Same spacing when millis() wraps in the middle of the minute
+static void test_throttle_across_millis_wrap() {
+  uint32_t acceptedMs[60];
+  uint32_t start = 0xFFFFFFFFUL - 30000;
+  int accepted = receiveMinute(start, acceptedMs, 60);
+  
+  TEST_ASSERT_EQUAL_INT(8, accepted);
+  TEST_ASSERT_EQUAL_UINT32(start, acceptedMs[0]);
+  for (int i = 1; i < accepted; i++) {
+    TEST_ASSERT_EQUAL_UINT32(8000, acceptedMs[i] - acceptedMs[i - 1]);
+  }
+}
+
+// A reopened subscription takes its first message right away
+static void test_throttle_reset_on_resubscribe() {
+  StreamThrottle throttle;
+  streamThrottleReset(throttle);
+  float volts;
+  TEST_ASSERT_TRUE(receive(throttle, AUTOPILOT_MAIN, 1000, volts));
+  TEST_ASSERT_FALSE(receive(throttle, AUTOPILOT_MAIN, 2000, volts));
+  
+  streamThrottleReset(throttle);
+  TEST_ASSERT_TRUE(receive(throttle, AUTOPILOT_MAIN, 2000, volts));
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_accepts_autopilot_main_battery);
+  RUN_TEST(test_rejects_other_batteries_and_senders);
+  RUN_TEST(test_stream_keeps_main_battery);
+  RUN_TEST(test_stops_at_length);
+  RUN_TEST(test_subscriptions_keep_slots);
+  RUN_TEST(test_subscriptions_skip_duplicates_and_overflow);
+  RUN_TEST(test_throttle_spaces_main_battery);
+  RUN_TEST(test_throttle_across_millis_wrap);
+  RUN_TEST(test_throttle_reset_on_resubscribe);
+  return UNITY_END();
+}
+  
\ No newline at end of file
@@ -0,0 +1,229 @@
+/**
+  ******************************************************************************
+  * @file    test_charge_estimator.cpp
+  * @brief   Cell count, state of charge and discharge rate from pack voltages
+  ******************************************************************************
+  *
+  * Run with PlatformIO:  pio test -e native -f test_charge_estimator
+*/
+
+#include <unity.h>
+#include "charge_estimator.h"
+
+#define MINUTE_MS 60000ULL
+
+// One voltage never gives a wrong count, from a sagging empty pack to a full one
+static void test_detects_cells_across_the_curve() {
+  for (int cells = 1; cells <= CHARGE_MAX_CELLS; cells++) {
+    for (float cellVolts = CHARGE_CELL_EMPTY_V; cellVolts <= 4.2f; cellVolts += 0.02f) {
+      uint8_t detected = chargeDetectCells(cellVolts * cells);
+      if (detected != 0) {
+        TEST_ASSERT_EQUAL_UINT8(cells, detected);
+      }
+    }
+  }
+}
+
+// Voltages where one count is the only one
+static void test_detects_unambiguous_packs() {
+  TEST_ASSERT_EQUAL_UINT8(1, chargeDetectCells(4.2f));
+  TEST_ASSERT_EQUAL_UINT8(3, chargeDetectCells(9.4f));
+  TEST_ASSERT_EQUAL_UINT8(4, chargeDetectCells(13.2f));
+  TEST_ASSERT_EQUAL_UINT8(4, chargeDetectCells(4 * 3.7f));
+}
+
+// Full 4S, 5S and 6S packs and a low 6S one could each be another count too
+static void test_ambiguous_packs_are_unknown() {
+  const float packs[] = { 16.8f, 21.0f, 25.2f, 6 * 3.54f, 12.0f };
+  for (float packVolts : packs) {
+    ChargeEstimatorState state;
+    chargeEstimatorReset(state, 0);
+    chargeEstimatorUpdate(state, packVolts, 0);
+  
+    ChargeEstimate estimate = chargeEstimatorGet(state);
+    TEST_ASSERT_EQUAL_UINT8(0, estimate.cells);
+    TEST_ASSERT_LESS_THAN(0.0f, estimate.soc);
+  }
+}
+
+// Rounding by a nominal voltage took these for 3S and 2S packs at 100 percent
+static void test_empty_packs_read_empty() {
+  ChargeEstimatorState state;
+  chargeEstimatorReset(state, 0);
+  chargeEstimatorUpdate(state, 13.2f, 0);
+  ChargeEstimate estimate = chargeEstimatorGet(state);
+  TEST_ASSERT_EQUAL_UINT8(4, estimate.cells);
+  TEST_ASSERT_LESS_THAN(5.0f, estimate.soc);
+  
+  chargeEstimatorReset(state, 0);
+  chargeEstimatorUpdate(state, 9.4f, 0);
+  estimate = chargeEstimatorGet(state);
+  TEST_ASSERT_EQUAL_UINT8(3, estimate.cells);
+  TEST_ASSERT_LESS_THAN(5.0f, estimate.soc);
+}
+
+// A 4S pack from full to a deep sag: unknown at first, then 4S to the end, one history
+static void test_discharge_keeps_the_count() {
+  ChargeEstimatorState state;
+  chargeEstimatorReset(state, 0);
+  int minute = 0;
+  uint16_t samples = 0;
+  for (float cellVolts = 4.2f; cellVolts >= 2.8f; cellVolts -= 0.01f, minute++) {
+    chargeEstimatorUpdate(state, 4 * cellVolts, minute * MINUTE_MS);
+    ChargeEstimate estimate = chargeEstimatorGet(state);
+    if (4 * cellVolts > 5 * CHARGE_CELL_EMPTY_V) {
+      TEST_ASSERT_EQUAL_UINT8(0, estimate.cells);
+      continue;
+    }
+    TEST_ASSERT_EQUAL_UINT8(4, estimate.cells);
+    TEST_ASSERT_TRUE(estimate.soc < 75.0f);
+    TEST_ASSERT_EQUAL_UINT16(samples + 1, state.samples);
+    samples = state.samples;
+  }
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, chargeEstimatorGet(state).soc);
+}
+
+// Back on the charger the count stays and only the history starts over
+static void test_count_survives_recharge() {
+  ChargeEstimatorState state;
+  chargeEstimatorReset(state, 0);
+  chargeEstimatorUpdate(state, 4 * 3.5f, 0);
+  chargeEstimatorUpdate(state, 16.8f, MINUTE_MS);
+  
+  ChargeEstimate estimate = chargeEstimatorGet(state);
+  TEST_ASSERT_EQUAL_UINT8(4, estimate.cells);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 100.0f, estimate.soc);
+  TEST_ASSERT_EQUAL_UINT16(1, state.samples);
+}
+
+static void test_configured_full_4s_pack() {
+  ChargeEstimatorState state;
+  chargeEstimatorReset(state, 4);
+  chargeEstimatorUpdate(state, 16.8f, 0);
+  
+  ChargeEstimate estimate = chargeEstimatorGet(state);
+  TEST_ASSERT_EQUAL_UINT8(4, estimate.cells);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 100.0f, estimate.soc);
+}
+
+static void test_configured_cells_lookup() {
+  const char* table = "192.168.2.2=4,192.168.2.20=6";
+  TEST_ASSERT_EQUAL_UINT8(4, chargeConfiguredCells(table, "192.168.2.2"));
+  TEST_ASSERT_EQUAL_UINT8(6, chargeConfiguredCells(table, "192.168.2.20"));
+  TEST_ASSERT_EQUAL_UINT8(0, chargeConfiguredCells(table, "192.168.2.200"));
+  TEST_ASSERT_EQUAL_UINT8(0, chargeConfiguredCells(table, "192.168.2"));
+  TEST_ASSERT_EQUAL_UINT8(0, chargeConfiguredCells("", "192.168.2.2"));
+}
+
+// Rate and time to empty only after enough history, then from the fitted line
+static void test_steady_discharge() {
+  ChargeEstimatorState state;
+  chargeEstimatorReset(state, 0);
+  
+  // 4S from 3.70 V down by 1 mV per cell and minute
+  for (int minute = 0; minute <= 30; minute++) {
+    chargeEstimatorUpdate(state, 4 * (3.70f - 0.001f * minute), minute * MINUTE_MS);
+    if (minute < 5) {
+      TEST_ASSERT_EQUAL_INT(-1, chargeEstimatorGet(state).minutesToEmpty);
+    }
+  }
+  
+  ChargeEstimate estimate = chargeEstimatorGet(state);
+  TEST_ASSERT_EQUAL_UINT8(4, estimate.cells);
+  TEST_ASSERT_FALSE(estimate.charging);
+  TEST_ASSERT_LESS_THAN(-5.0f, estimate.ratePerHour);
+  TEST_ASSERT_GREATER_THAN(-30.0f, estimate.ratePerHour);
+  TEST_ASSERT_GREATER_THAN(0, estimate.minutesToEmpty);
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, estimate.soc / -estimate.ratePerHour * 60, (float)estimate.minutesToEmpty);
+}
+
+static void test_rising_voltage_is_charging() {
+  ChargeEstimatorState state;
+  chargeEstimatorReset(state, 1);
+  for (int minute = 0; minute <= 20; minute++) {
+    chargeEstimatorUpdate(state, 3.80f + 0.002f * minute, minute * MINUTE_MS);
+  }
+  
+  ChargeEstimate estimate = chargeEstimatorGet(state);
+  TEST_ASSERT_TRUE(estimate.charging);
+  TEST_ASSERT_EQUAL_INT(-1, estimate.minutesToEmpty);
+}
+
+// A recharged pack starts a new history instead of bending the old line
+static void test_recharge_restarts_history() {
+  ChargeEstimatorState state;
+  chargeEstimatorReset(state, 0);
+  for (int minute = 0; minute <= 10; minute++) {
+    chargeEstimatorUpdate(state, 4 * (3.70f - 0.002f * minute), minute * MINUTE_MS);
+  }
+  chargeEstimatorUpdate(state, 16.8f, 11 * MINUTE_MS);
+  
+  TEST_ASSERT_EQUAL_UINT16(1, state.samples);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 100.0f, chargeEstimatorGet(state).soc);
+}
+
+// A smaller pack swapped in reads impossibly low per cell and is counted again
+static void test_swap_to_fewer_cells_recounts() {
+  ChargeEstimatorState state;
+  chargeEstimatorReset(state, 0);
+  chargeEstimatorUpdate(state, 6 * 4.2f, 0);
+  chargeEstimatorUpdate(state, 6 * 3.45f, MINUTE_MS);
+  TEST_ASSERT_EQUAL_UINT8(6, chargeEstimatorGet(state).cells);
+  chargeEstimatorUpdate(state, 3 * 3.9f, 2 * MINUTE_MS);
+  
+  ChargeEstimate estimate = chargeEstimatorGet(state);
+  TEST_ASSERT_EQUAL_UINT8(3, estimate.cells);
+  TEST_ASSERT_GREATER_THAN(40.0f, estimate.soc);
+}
+
+// A larger pack reads too high for every count still open
+static void test_swap_to_more_cells_recounts() {
+  ChargeEstimatorState state;
+  chargeEstimatorReset(state, 0);
+  chargeEstimatorUpdate(state, 3 * 3.8f, 0);
+  TEST_ASSERT_EQUAL_UINT8(3, chargeEstimatorGet(state).cells);
+  
+  // Full 6S could be 7S too, until it has run down a little
+  chargeEstimatorUpdate(state, 6 * 4.2f, MINUTE_MS);
+  TEST_ASSERT_EQUAL_UINT8(0, chargeEstimatorGet(state).cells);
+  chargeEstimatorUpdate(state, 6 * 3.45f, 2 * MINUTE_MS);
+  
+  ChargeEstimate estimate = chargeEstimatorGet(state);
+  TEST_ASSERT_EQUAL_UINT8(6, estimate.cells);
+  TEST_ASSERT_EQUAL_UINT16(1, state.samples);
+}
+
+// The watch's single cell is never recounted, even far off the curve
+static void test_fixed_cells_are_kept() {
+  ChargeEstimatorState state;
+  chargeEstimatorReset(state, 1);
+  chargeEstimatorUpdate(state, 3.9f, 0);
+  chargeEstimatorUpdate(state, 2.0f, MINUTE_MS);
+  
+  ChargeEstimate estimate = chargeEstimatorGet(state);
+  TEST_ASSERT_EQUAL_UINT8(1, estimate.cells);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, estimate.soc);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_detects_cells_across_the_curve);
+  RUN_TEST(test_detects_unambiguous_packs);
+  RUN_TEST(test_ambiguous_packs_are_unknown);
+  RUN_TEST(test_empty_packs_read_empty);
+  RUN_TEST(test_discharge_keeps_the_count);
+  RUN_TEST(test_count_survives_recharge);
+  RUN_TEST(test_configured_full_4s_pack);
+  RUN_TEST(test_configured_cells_lookup);
+  RUN_TEST(test_steady_discharge);
+  RUN_TEST(test_rising_voltage_is_charging);
+  RUN_TEST(test_recharge_restarts_history);
+  RUN_TEST(test_swap_to_fewer_cells_recounts);
+  RUN_TEST(test_swap_to_more_cells_recounts);
+  RUN_TEST(test_fixed_cells_are_kept);
+  return UNITY_END();
+}
@@ -0,0 +1,221 @@
+/**
+  ******************************************************************************
+  * @file    test_frame_buffer.cpp
+  * @brief   Blitted glyphs against Adafruit_GFX::drawChar(), and their speed
+  ******************************************************************************
+  *
+  * Run with PlatformIO:  pio test -e native -f test_frame_buffer
+  *
+  * The font headers ship with the Arduino library, so the glyphs are generated:
+  * every width from 1 to 40 px (one to three 16-bit source chunks), bitmaps
+  * starting at every bit phase, offsets on both sides of the cursor, and empty,
+  * full and random bitmaps.
+*/
+
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include "frame_buffer.h"
+
+#define TEST_GLYPH_COUNT 95
+#define TEST_FIRST_CHAR 0x20
+
+static uint8_t glyphBitmaps[TEST_GLYPH_COUNT * 256];
+static GFXglyph glyphs[TEST_GLYPH_COUNT];
+static GFXfont font;
+
+// Reference path: the library's write() and drawChar(), pixel by pixel into the same page
+class ReferenceFrame : public FrameBuffer {
+public:
+  size_t write(uint8_t c) override { return Adafruit_GFX::write(c); }
+};
+
+static uint32_t rng = 0x9E3779B9;
+
+static uint32_t nextRandom() {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static void buildFont() {
+  uint16_t offset = 0;
+  for (int i = 0; i < TEST_GLYPH_COUNT; i++) {
+    GFXglyph& glyph = glyphs[i];
+    glyph.width = 1 + i % 40;
+    glyph.height = 1 + (i * 7) % 37;
+    glyph.xOffset = i % 7 - 3;
+    glyph.yOffset = -glyph.height + i % 5 - 2;
+    glyph.xAdvance = glyph.width + 1;
+    glyph.bitmapOffset = offset;
+  
+    int bytes = (glyph.width * glyph.height + 7) / 8;
+    for (int b = 0; b < bytes; b++) {
+      uint8_t value;
+      if (i % 13 == 0) {
+        value = 0x00;
+      } else if (i % 13 == 1) {
+        value = 0xFF;
+      } else {
+        value = (uint8_t)nextRandom();
+      }
+      glyphBitmaps[offset + b] = value;
+    }
+    offset += bytes;
+  }
+  
+  font.bitmap = glyphBitmaps;
+  font.glyph = glyphs;
+  font.first = TEST_FIRST_CHAR;
+  font.last = TEST_FIRST_CHAR + TEST_GLYPH_COUNT - 1;
+  font.yAdvance = 42;
+}
+
+// Draw one character through both paths on the same page and compare pages and cursors
+static void compareChar(uint8_t c, int16_t x, int16_t y, uint8_t size, bool white, int16_t pageTop) {
+  static FrameBuffer blitted;
+  static ReferenceFrame reference;
+  
+  FrameBuffer* frames[2] = { &blitted, &reference };
+  for (FrameBuffer* frame : frames) {
+    frame->setPage(pageTop);
+    frame->fillScreen(white ? 0 : 1);
+    frame->setFont(&font);
+    frame->setTextSize(size);
+    frame->setTextColor(white ? 1 : 0);
+    frame->setTextWrap(false);
+    frame->setCursor(x, y);
+    frame->write(c);
+  }
+  
+  int bytes = blitted.getPageHeight() * FRAME_BYTES_PER_ROW;
+  if (memcmp(blitted.getBuffer(), reference.getBuffer(), bytes) != 0) {
+    char message[96];
+    snprintf(message, sizeof(message), "glyph %d size %d %s at (%d,%d), page %d",
+             c - TEST_FIRST_CHAR, size, white ? "white" : "black", x, y, pageTop);
+    TEST_FAIL_MESSAGE(message);
+  }
+  TEST_ASSERT_EQUAL_INT16(reference.getCursorX(), blitted.getCursorX());
+  TEST_ASSERT_EQUAL_INT16(reference.getCursorY(), blitted.getCursorY());
+}
+
+// Every glyph at every byte alignment, and clipped at the left and right edges
+static void test_blit_matches_draw_char_across_x() {
+  int16_t pageTop = (FRAME_PAGE_COUNT / 2) * FRAME_PAGE_HEIGHT;
+  int16_t y = pageTop + FRAME_PAGE_HEIGHT / 2;
+  for (int i = 0; i < TEST_GLYPH_COUNT; i++) {
+    for (uint8_t size = 1; size <= 2; size++) {
+      for (int16_t x = -90; x <= FRAME_WIDTH + 8; x++) {
+        // Alignments repeat every byte, the unclipped middle adds nothing
+        if (x > 24 && x < FRAME_WIDTH - 90) {
+          continue;
+        }
+        compareChar(TEST_FIRST_CHAR + i, x, y, size, false, pageTop);
+        compareChar(TEST_FIRST_CHAR + i, x, y, size, true, pageTop);
+      }
+    }
+  }
+}
+
+// Every glyph crossing the top and bottom edge of every page, the short last page included
+static void test_blit_matches_draw_char_across_pages() {
+  for (int page = 0; page < FRAME_PAGE_COUNT; page++) {
+    int16_t pageTop = page * FRAME_PAGE_HEIGHT;
+    for (int i = 0; i < TEST_GLYPH_COUNT; i++) {
+      for (uint8_t size = 1; size <= 2; size++) {
+        for (int16_t y = pageTop - 10; y <= pageTop + FRAME_PAGE_HEIGHT + 90; y++) {
+          compareChar(TEST_FIRST_CHAR + i, 3 + i % 8, y, size, (y & 1) != 0, pageTop);
+        }
+      }
+    }
+  }
+}
+
+// Whole strings with newlines and wrapping, drawn page by page like a screen
+static void test_blit_matches_draw_char_for_text() {
+  static FrameBuffer blitted;
+  static ReferenceFrame reference;
+  char text[TEST_GLYPH_COUNT + 8];
+  for (int i = 0; i < TEST_GLYPH_COUNT; i++) {
+    text[i] = TEST_FIRST_CHAR + (i * 37) % TEST_GLYPH_COUNT;
+  }
+  text[20] = '\n';
+  text[50] = '\r';
+  text[51] = '\n';
+  text[TEST_GLYPH_COUNT] = '\0';
+  
+  for (uint8_t size = 1; size <= 2; size++) {
+    for (int page = 0; page < FRAME_PAGE_COUNT; page++) {
+      FrameBuffer* frames[2] = { &blitted, &reference };
+      for (FrameBuffer* frame : frames) {
+        frame->setPage(page * FRAME_PAGE_HEIGHT);
+        frame->fillScreen(1);
+        frame->setFont(&font);
+        frame->setTextSize(size);
+        frame->setTextColor(0);
+        frame->setTextWrap(true);
+        frame->setCursor(5, 40);
+        frame->print(text);
+      }
+      TEST_ASSERT_EQUAL_MEMORY(reference.getBuffer(), blitted.getBuffer(),
+                               blitted.getPageHeight() * FRAME_BYTES_PER_ROW);
+      TEST_ASSERT_EQUAL_INT16(reference.getCursorX(), blitted.getCursorX());
+      TEST_ASSERT_EQUAL_INT16(reference.getCursorY(), blitted.getCursorY());
+    }
+  }
+}
+
+// Time a full frame of six text lines, all pages, through one path
+static double frameMicros(FrameBuffer& frame, uint8_t size, int repeats) {
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeats; r++) {
+    for (int page = 0; page < FRAME_PAGE_COUNT; page++) {
+      frame.setPage(page * FRAME_PAGE_HEIGHT);
+      frame.fillScreen(1);
+      frame.setFont(&font);
+      frame.setTextSize(size);
+      frame.setTextColor(0);
+      frame.setTextWrap(true);
+      frame.setCursor(0, 30);
+      for (int line = 0; line < 6; line++) {
+        // Narrow glyphs, like a line of digits
+        for (int c = 0; c < 12; c++) {
+          frame.write(TEST_FIRST_CHAR + 2 + (line + c) % 10);
+        }
+        frame.write('\n');
+      }
+    }
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::micro>(elapsed).count() / repeats;
+}
+
+static void test_blit_benchmark() {
+  static FrameBuffer blitted;
+  static ReferenceFrame reference;
+  
+  for (uint8_t size = 1; size <= 2; size++) {
+    double blitUs = frameMicros(blitted, size, 200);
+    double referenceUs = frameMicros(reference, size, 200);
+    char message[96];
+    snprintf(message, sizeof(message), "size %d: blit %.1f us/frame, drawChar %.1f us/frame, %.1fx",
+             size, blitUs, referenceUs, referenceUs / blitUs);
+    TEST_MESSAGE(message);
+  }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+  buildFont();
+  
+  UNITY_BEGIN();
+  RUN_TEST(test_blit_matches_draw_char_across_x);
+  RUN_TEST(test_blit_matches_draw_char_across_pages);
+  RUN_TEST(test_blit_matches_draw_char_for_text);
+  RUN_TEST(test_blit_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,289 @@
+/**
+  ******************************************************************************
+  * @file    test_mavlink_parser.cpp
+  * @brief   MAVLink v2 datagram parsing, and its speed on replayed UDP traffic
+  ******************************************************************************
+  *
+  * Run with PlatformIO:  pio test -e native -f test_mavlink_parser
+  *
+  * The replayed traffic is shaped like an autopilot stream: one
+  * HEARTBEAT, SYS_STATUS and BATTERY_STATUS per second among the ATTITUDE,
+  * GLOBAL_POSITION_INT and other messages the watch ignores, the way a
+  * router bundles them into datagrams.
+*/
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "mavlink_parser.h"
+
+#define REPLAY_DATAGRAMS 600
+#define REPLAY_MAX_DATAGRAM 512
+
+// Other messages of the stream, skipped by the parser unchecked
+#define MSG_ID_ATTITUDE 30
+#define MSG_ID_GLOBAL_POSITION_INT 33
+#define MSG_ID_VFR_HUD 74
+#define MSG_ID_TIMESYNC 111
+
+static uint8_t replay[REPLAY_DATAGRAMS][REPLAY_MAX_DATAGRAM];
+static size_t replayLengths[REPLAY_DATAGRAMS];
+
+struct Received {
+  int count;
+  MavlinkMessage last;
+  float lastBatteryVoltage;
+};
+
+static void crcAccumulate(uint8_t data, uint16_t& crc) {
+  uint8_t tmp = data ^ (uint8_t)(crc & 0xFF);
+  tmp ^= (tmp << 4);
+  crc = (crc >> 8) ^ ((uint16_t)tmp << 8) ^ ((uint16_t)tmp << 3) ^ (tmp >> 4);
+}
+
+// One v2 frame with trailing zeros truncated like a sender does, @return its length
+static size_t packFrame(uint8_t* buffer, uint8_t sequence, uint8_t systemId, uint8_t componentId,
+                        uint32_t messageId, const uint8_t* payload, uint8_t length, uint8_t crcExtra) {
+  while (length > 1 && payload[length - 1] == 0) {
+    length--;
+  }
+  buffer[0] = 0xFD;
+  buffer[1] = length;
+  buffer[2] = 0;
+  buffer[3] = 0;
+  buffer[4] = sequence;
+  buffer[5] = systemId;
+  buffer[6] = componentId;
+  buffer[7] = messageId & 0xFF;
+  buffer[8] = (messageId >> 8) & 0xFF;
+  buffer[9] = (messageId >> 16) & 0xFF;
+  memcpy(buffer + 10, payload, length);
+  
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 1; i < 10 + (size_t)length; i++) {
+    crcAccumulate(buffer[i], crc);
+  }
+  crcAccumulate(crcExtra, crc);
+  buffer[10 + length] = crc & 0xFF;
+  buffer[11 + length] = crc >> 8;
+  return 12 + length;
+}
+
+static size_t packBatteryStatus(uint8_t* buffer, uint8_t sequence, uint8_t batteryId, uint16_t millivolts,
+                                int8_t remaining) {
+  uint8_t payload[36];
+  memset(payload, 0, sizeof(payload));
+  for (int cell = 0; cell < 10; cell++) {
+    uint16_t value = cell == 0 ? millivolts : 0xFFFF;
+    payload[10 + cell * 2] = value & 0xFF;
+    payload[11 + cell * 2] = value >> 8;
+  }
+  payload[32] = batteryId;
+  payload[35] = (uint8_t)remaining;
+  return packFrame(buffer, sequence, 1, 1, MAVLINK_MSG_ID_BATTERY_STATUS, payload, sizeof(payload), 154);
+}
+
+// Ends in battery_remaining 0 and zeros, so the sender truncates it
+static size_t packSysStatus(uint8_t* buffer, uint8_t sequence, uint16_t millivolts) {
+  uint8_t payload[31];
+  memset(payload, 0, sizeof(payload));
+  payload[14] = millivolts & 0xFF;
+  payload[15] = millivolts >> 8;
+  return packFrame(buffer, sequence, 1, 1, MAVLINK_MSG_ID_SYS_STATUS, payload, sizeof(payload), 124);
+}
+
+static size_t packOther(uint8_t* buffer, uint8_t sequence, uint32_t messageId, uint8_t length) {
+  uint8_t payload[64];
+  for (int i = 0; i < length; i++) {
+    payload[i] = (uint8_t)(sequence * 31 + i * 7 + 1);
+  }
+  return packFrame(buffer, sequence, 1, 1, messageId, payload, length, 0x5A);
+}
+
+static void buildReplay() {
+  uint8_t sequence = 0;
+  for (int d = 0; d < REPLAY_DATAGRAMS; d++) {
+    uint8_t* datagram = replay[d];
+    size_t length = 0;
+  
+    // Four datagrams per second, the battery messages in the first one
+    if (d % 4 == 0) {
+      length += mavlinkPackHeartbeat(datagram + length, sequence++, 1, 1);
+      length += packSysStatus(datagram + length, sequence++, 15800 - d);
+      length += packBatteryStatus(datagram + length, sequence++, 0, 15800 - d, 80);
+      length += packBatteryStatus(datagram + length, sequence++, 1, 4100, 95);
+    }
+    length += packOther(datagram + length, sequence++, MSG_ID_ATTITUDE, 28);
+    length += packOther(datagram + length, sequence++, MSG_ID_GLOBAL_POSITION_INT, 28);
+    length += packOther(datagram + length, sequence++, MSG_ID_VFR_HUD, 20);
+    length += packOther(datagram + length, sequence++, MSG_ID_TIMESYNC, 16);
+    replayLengths[d] = length;
+  }
+}
+
+static void countMessage(const MavlinkMessage& message, void* context) {
+  Received* received = static_cast<Received*>(context);
+  received->count++;
+  received->last = message;
+  if (message.messageId == MAVLINK_MSG_ID_BATTERY_STATUS && message.batteryId == 0) {
+    received->lastBatteryVoltage = message.voltage;
+  }
+}
+
+static void test_decodes_battery_status() {
+  uint8_t frame[64];
+  size_t length = packBatteryStatus(frame, 7, 2, 16120, 64);
+  
+  Received received = {};
+  MavlinkParseStats stats = {};
+  TEST_ASSERT_EQUAL_INT(1, mavlinkParseDatagram(frame, length, countMessage, &received, &stats));
+  TEST_ASSERT_EQUAL_UINT32(MAVLINK_MSG_ID_BATTERY_STATUS, received.last.messageId);
+  TEST_ASSERT_EQUAL_UINT8(1, received.last.systemId);
+  TEST_ASSERT_EQUAL_UINT8(1, received.last.componentId);
+  TEST_ASSERT_EQUAL_UINT8(2, received.last.batteryId);
+  TEST_ASSERT_FLOAT_WITHIN(0.0005f, 16.12f, received.last.voltage);
+  TEST_ASSERT_EQUAL_INT(64, received.last.batteryRemaining);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.frames);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.decoded);
+}
+
+// Trailing zeros dropped by the sender read back as zeros
+static void test_decodes_truncated_payload() {
+  uint8_t frame[64];
+  size_t length = packSysStatus(frame, 0, 15350);
+  TEST_ASSERT_LESS_THAN(12 + 31, length);
+  
+  Received received = {};
+  TEST_ASSERT_EQUAL_INT(1, mavlinkParseDatagram(frame, length, countMessage, &received, nullptr));
+  TEST_ASSERT_FLOAT_WITHIN(0.0005f, 15.35f, received.last.voltage);
+  TEST_ASSERT_EQUAL_INT(0, received.last.batteryRemaining);
+}
+
+// Other messages are skipped by length and counted apart from the checked frames
+static void test_other_messages_are_unchecked() {
+  uint8_t datagram[128];
+  size_t length = packOther(datagram, 0, MSG_ID_ATTITUDE, 28);
+  length += mavlinkPackHeartbeat(datagram + length, 1, 1, 1);
+  
+  Received received = {};
+  MavlinkParseStats stats = {};
+  TEST_ASSERT_EQUAL_INT(1, mavlinkParseDatagram(datagram, length, countMessage, &received, &stats));
+  TEST_ASSERT_EQUAL_UINT32(MAVLINK_MSG_ID_HEARTBEAT, received.last.messageId);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.frames);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.unchecked);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.crcErrors);
+}
+
+// A corrupt frame is dropped and the parser finds the next one
+static void test_resynchronizes_after_crc_error() {
+  uint8_t datagram[128];
+  size_t length = packBatteryStatus(datagram, 0, 0, 16000, 50);
+  datagram[12] ^= 0x01;
+  length += packBatteryStatus(datagram + length, 1, 0, 15900, 49);
+  
+  Received received = {};
+  MavlinkParseStats stats = {};
+  TEST_ASSERT_EQUAL_INT(1, mavlinkParseDatagram(datagram, length, countMessage, &received, &stats));
+  TEST_ASSERT_FLOAT_WITHIN(0.0005f, 15.9f, received.last.voltage);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.crcErrors);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.frames);
+  TEST_ASSERT_GREATER_THAN(0, stats.skippedBytes);
+}
+
+static void test_ignores_truncated_datagram() {
+  uint8_t frame[64];
+  size_t length = packBatteryStatus(frame, 0, 0, 16000, 50);
+  
+  Received received = {};
+  MavlinkParseStats stats = {};
+  TEST_ASSERT_EQUAL_INT(0, mavlinkParseDatagram(frame, length - 3, countMessage, &received, &stats));
+  TEST_ASSERT_EQUAL_UINT32(0, stats.frames);
+  TEST_ASSERT_EQUAL_UINT32(length - 3, stats.skippedBytes);
+}
+
+static void test_replay_decodes_every_battery_status() {
+  Received received = {};
+  MavlinkParseStats stats = {};
+  for (int d = 0; d < REPLAY_DATAGRAMS; d++) {
+    mavlinkParseDatagram(replay[d], replayLengths[d], countMessage, &received, &stats);
+  }
+  TEST_ASSERT_EQUAL_INT(REPLAY_DATAGRAMS / 4 * 4, received.count);
+  TEST_ASSERT_EQUAL_UINT32(received.count, stats.decoded);
+  TEST_ASSERT_EQUAL_UINT32(REPLAY_DATAGRAMS * 4, stats.unchecked);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.crcErrors);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.skippedBytes);
+  TEST_ASSERT_FLOAT_WITHIN(0.0005f, (15800 - (REPLAY_DATAGRAMS - 4)) / 1000.0f, received.lastBatteryVoltage);
+}
+
+// Send the replay over loopback UDP and parse each datagram as it is received
+static double replayMicros(int socketFd, const sockaddr_in& address, Received& received) {
+  uint8_t datagram[REPLAY_MAX_DATAGRAM];
+  auto start = std::chrono::steady_clock::now();
+  for (int d = 0; d < REPLAY_DATAGRAMS; d++) {
+    sendto(socketFd, replay[d], replayLengths[d], 0, (const sockaddr*)&address, sizeof(address));
+    ssize_t length = recv(socketFd, datagram, sizeof(datagram), 0);
+    if (length > 0) {
+      mavlinkParseDatagram(datagram, (size_t)length, countMessage, &received, nullptr);
+    }
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::micro>(elapsed).count() / REPLAY_DATAGRAMS;
+}
+
+static void test_replay_benchmark() {
+  const int repeats = 200;
+  Received received = {};
+  
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeats; r++) {
+    for (int d = 0; d < REPLAY_DATAGRAMS; d++) {
+      mavlinkParseDatagram(replay[d], replayLengths[d], countMessage, &received, nullptr);
+    }
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  double parseUs = std::chrono::duration<double, std::micro>(elapsed).count() / (repeats * REPLAY_DATAGRAMS);
+  
+  // The socket bound to loopback sends to itself
+  int socketFd = socket(AF_INET, SOCK_DGRAM, 0);
+  TEST_ASSERT_TRUE(socketFd >= 0);
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+  socklen_t addressLength = sizeof(address);
+  TEST_ASSERT_EQUAL_INT(0, bind(socketFd, (const sockaddr*)&address, sizeof(address)));
+  TEST_ASSERT_EQUAL_INT(0, getsockname(socketFd, (sockaddr*)&address, &addressLength));
+  
+  Received replayed = {};
+  double udpUs = replayMicros(socketFd, address, replayed);
+  close(socketFd);
+  TEST_ASSERT_EQUAL_INT(REPLAY_DATAGRAMS / 4 * 4, replayed.count);
+  
+  char message[128];
+  snprintf(message, sizeof(message), "parse %.2f us/datagram, loopback UDP replay with parsing %.2f us/datagram",
+           parseUs, udpUs);
+  TEST_MESSAGE(message);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+  buildReplay();
+  
+  UNITY_BEGIN();
+  RUN_TEST(test_decodes_battery_status);
+  RUN_TEST(test_decodes_truncated_payload);
+  RUN_TEST(test_other_messages_are_unchecked);
+  RUN_TEST(test_resynchronizes_after_crc_error);
+  RUN_TEST(test_ignores_truncated_datagram);
+  RUN_TEST(test_replay_decodes_every_battery_status);
+  RUN_TEST(test_replay_benchmark);
+  return UNITY_END();
+}
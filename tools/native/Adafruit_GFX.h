@@ -0,0 +1,138 @@
+/**
+  ******************************************************************************
+  * @file    Adafruit_GFX.h
+  * @brief   The part of Adafruit_GFX the frame buffer uses, for host builds
+  ******************************************************************************
+  *
+  * The library itself cannot be built on the host: its header pulls in the
+  * BusIO SPI and I2C device classes. write() and drawChar() below follow the
+  * library's GFX font code statement by statement, so host tests compare the
+  * frame buffer's blitter against the same pixels the library draws.
+*/
+
+#ifndef NATIVE_ADAFRUIT_GFX_H
+#define NATIVE_ADAFRUIT_GFX_H
+
+#include "Arduino.h"
+
+// Same layout as the library's gfxfont.h, so font headers can be shared
+typedef struct {
+  uint16_t bitmapOffset;
+  uint8_t width;
+  uint8_t height;
+  uint8_t xAdvance;
+  int8_t xOffset;
+  int8_t yOffset;
+} GFXglyph;
+
+typedef struct {
+  uint8_t* bitmap;
+  GFXglyph* glyph;
+  uint16_t first;
+  uint16_t last;
+  uint8_t yAdvance;
+} GFXfont;
+
+class Adafruit_GFX : public Print {
+public:
+  Adafruit_GFX(int16_t w, int16_t h) : _width(w), _height(h) {}
+  
+  virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+  
+  virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    for (int16_t i = x; i < x + w; i++) {
+      for (int16_t j = y; j < y + h; j++) {
+        drawPixel(i, j, color);
+      }
+    }
+  }
+  
+  virtual void fillScreen(uint16_t color) { fillRect(0, 0, _width, _height, color); }
+  
+  // GFX font branch of the library's drawChar(); the classic 5x7 font is not supported
+  void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg,
+                uint8_t size_x, uint8_t size_y) {
+    (void)bg;
+    c -= (uint8_t)pgm_read_byte(&gfxFont->first);
+    GFXglyph* glyph = ((GFXglyph*)pgm_read_ptr(&gfxFont->glyph)) + c;
+    uint8_t* bitmap = (uint8_t*)pgm_read_ptr(&gfxFont->bitmap);
+  
+    uint16_t bo = pgm_read_word(&glyph->bitmapOffset);
+    uint8_t w = pgm_read_byte(&glyph->width), h = pgm_read_byte(&glyph->height);
+    int8_t xo = pgm_read_byte(&glyph->xOffset), yo = pgm_read_byte(&glyph->yOffset);
+    uint8_t xx, yy, bits = 0, bit = 0;
+    int16_t xo16 = 0, yo16 = 0;
+  
+    if (size_x > 1 || size_y > 1) {
+      xo16 = xo;
+      yo16 = yo;
+    }
+  
+    for (yy = 0; yy < h; yy++) {
+      for (xx = 0; xx < w; xx++) {
+        if (!(bit++ & 7)) {
+          bits = pgm_read_byte(&bitmap[bo++]);
+        }
+        if (bits & 0x80) {
+          if (size_x == 1 && size_y == 1) {
+            drawPixel(x + xo + xx, y + yo + yy, color);
+          } else {
+            fillRect(x + (xo16 + xx) * size_x, y + (yo16 + yy) * size_y, size_x, size_y, color);
+          }
+        }
+        bits <<= 1;
+      }
+    }
+  }
+  
+  using Print::write;
+  
+  // GFX font branch of the library's write()
+  virtual size_t write(uint8_t c) override {
+    if (gfxFont == nullptr) {
+      return 1;
+    }
+    if (c == '\n') {
+      cursor_x = 0;
+      cursor_y += (int16_t)textsize_y * (uint8_t)pgm_read_byte(&gfxFont->yAdvance);
+    } else if (c != '\r') {
+      uint8_t first = pgm_read_byte(&gfxFont->first);
+      if ((c >= first) && (c <= (uint8_t)pgm_read_byte(&gfxFont->last))) {
+        GFXglyph* glyph = ((GFXglyph*)pgm_read_ptr(&gfxFont->glyph)) + (c - first);
+        uint8_t w = pgm_read_byte(&glyph->width), h = pgm_read_byte(&glyph->height);
+        if ((w > 0) && (h > 0)) {
+          int16_t xo = (int8_t)pgm_read_byte(&glyph->xOffset);
+          if (wrap && ((cursor_x + textsize_x * (xo + w)) > _width)) {
+            cursor_x = 0;
+            cursor_y += (int16_t)textsize_y * (uint8_t)pgm_read_byte(&gfxFont->yAdvance);
+          }
+          drawChar(cursor_x, cursor_y, c, textcolor, textbgcolor, textsize_x, textsize_y);
+        }
+        cursor_x += (uint8_t)pgm_read_byte(&glyph->xAdvance) * (int16_t)textsize_x;
+      }
+    }
+    return 1;
+  }
+  
+  void setFont(const GFXfont* f) { gfxFont = (GFXfont*)f; }
+  void setCursor(int16_t x, int16_t y) { cursor_x = x; cursor_y = y; }
+  void setTextSize(uint8_t s) { textsize_x = textsize_y = s > 0 ? s : 1; }
+  void setTextColor(uint16_t c) { textcolor = textbgcolor = c; }
+  void setTextColor(uint16_t c, uint16_t bg) { textcolor = c; textbgcolor = bg; }
+  void setTextWrap(bool w) { wrap = w; }
+  
+  int16_t getCursorX() const { return cursor_x; }
+  int16_t getCursorY() const { return cursor_y; }
+  int16_t width() const { return _width; }
+  int16_t height() const { return _height; }
+  
+protected:
+  int16_t _width, _height;
+  int16_t cursor_x = 0, cursor_y = 0;
+  uint16_t textcolor = 0xFFFF, textbgcolor = 0xFFFF;
+  uint8_t textsize_x = 1, textsize_y = 1;
+  bool wrap = true;
+  GFXfont* gfxFont = nullptr;
+};
+
+#endif // NATIVE_ADAFRUIT_GFX_H
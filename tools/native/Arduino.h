@@ -0,0 +1,47 @@
+/**
+  ******************************************************************************
+  * @file    Arduino.h
+  * @brief   The few Arduino definitions the display code needs, for host builds
+  ******************************************************************************
+*/
+
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_ptr(addr) (*(void* const*)(addr))
+
+// Byte sink the GFX classes derive from, text output only
+class Print {
+public:
+  virtual ~Print() {}
+  
+  virtual size_t write(uint8_t c) = 0;
+  
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t written = 0;
+    while (size--) {
+      written += write(*buffer++);
+    }
+    return written;
+  }
+  
+  size_t write(const char* text) {
+    return text == nullptr ? 0 : write((const uint8_t*)text, strlen(text));
+  }
+  
+  size_t print(const char* text) { return write(text); }
+};
+
+#endif // NATIVE_ARDUINO_H
@@ -0,0 +1,506 @@
+/**
+  ******************************************************************************
+  * @file    energy_sim.cpp
+  * @brief   Host-side simulation of battery life and refresh latency per policy
+  ******************************************************************************
+  *
+  * Runs the firmware's own decision logic (draw_schedule, sleep_policy,
+  * refresh_scheduler and energy_model) against a timing model of the radio,
+  * the panel and the CPU, for each policy in POLICIES.
+  *
+  * Build and run with PlatformIO:  pio run -e native && .pio/build/native/program [days]
+  * or directly:  g++ -O2 -Isrc tools/sim/energy_sim.cpp src/draw_schedule.cpp
+  *               src/sleep_policy.cpp src/refresh_scheduler.cpp src/energy_model.cpp
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include "draw_schedule.h"
+#include "sleep_policy.h"
+#include "refresh_scheduler.h"
+#include "energy_model.h"
+
+// How long things take on the watch. The WiFi and discovery values mirror the
+// firmware's defaults, the others are typical durations from the serial log.
+struct SimTiming {
+  uint32_t bootMs = 350;
+  uint32_t fastConnectMs = 600;          // Directed connect to the cached AP
+  uint32_t fastConnectTimeoutMs = 3000;  // WIFI_FAST_CONNECT_TIMEOUT_MS
+  uint32_t scanMs = 2200;
+  uint32_t associateMs = 900;
+  uint32_t dhcpMs = 1200;
+  uint64_t leaseReuseMs = 3600000;       // WIFI_LEASE_REUSE_MS
+  uint32_t mdnsQueryMs = 3000;           // DISCOVERY_QUERY_TIMEOUT_MS
+  uint32_t discoveryIntervalMs = DRAW_INTERVAL_MS; // DISCOVERY_INTERVAL_MS
+  uint32_t rediscoverWakes = 12;         // DUTY_CYCLE_REDISCOVER_WAKES
+  uint32_t fetchMs = 350;                // All vehicles, fetched in parallel
+  uint32_t renderMs = 60;
+  uint32_t fullRefreshMs = 2100;
+  uint32_t partialRefreshMs = 450;
+  uint64_t cleanSleepMs = 1200000;       // DISPLAY_CLEAN_SLEEP_MS
+  uint32_t uptimeStepMinutes = 15;       // STATUS_UPTIME_STEP_MINUTES
+  uint32_t loopIdleMaxMs = 200;          // LOOP_IDLE_MAX_MS
+  uint32_t loopBusyMs = 10;              // LOOP_BUSY_DELAY_MS
+  double udpTaskWakesPerS = 1;           // MAVLink UDP task, woken by its heartbeat timer
+};
+
+// The world the watch lives in
+struct SimScenario {
+  double days = 1.0;
+  int networkFromHour = 7;              // Network present from..to on the uptime clock
+  int networkToHour = 23;
+  int vehicles = 3;
+  uint32_t vehicleChangeMeanMs = 60000; // A displayed vehicle voltage changes this often, whole fleet
+  uint32_t batteryChangeMs = 900000;    // The watch's own voltage moves one displayed digit
+  double capacityMah = 200;
+};
+
+// Changed pixels of a region when its content changes, same order as STATUS_REGIONS
+static const int REGION_COUNT = 6;
+static const uint32_t REGION_PIXELS[REGION_COUNT] = { 2400, 900, 900, 900, 700, 250 };
+static const int REGION_BATTERY = 0;
+static const int REGION_VEHICLE = 1;
+static const int REGION_UPTIME = 5;
+
+struct SimPolicy {
+  const char* name;
+  bool dutyCycle;       // DUTY_CYCLE_MODE
+  uint32_t intervalMs;  // DUTY_CYCLE_INTERVAL_MS
+  bool partialUpdates;  // false: every update is a full refresh
+};
+
+static const SimPolicy POLICIES[] = {
+  { "always-on, partial updates", false, 0, true },
+  { "always-on, full refreshes", false, 0, false },
+  { "duty cycle 5 min", true, 300000, true },
+  { "duty cycle 15 min", true, 900000, true },
+};
+
+struct SimResult {
+  EnergyCounters energy;
+  uint32_t fullUpdates = 0;
+  uint32_t partialUpdates = 0;
+  uint32_t skippedUpdates = 0;
+  uint32_t wakes = 0;
+  uint32_t failedConnects = 0;
+  std::vector<uint32_t> latencies; // Vehicle change until it is on the panel
+  uint32_t undisplayed = 0;        // Changes still waiting at the end
+  uint64_t loopWakes = 0;          // Iterations of the always-on loop
+  uint64_t loopMs = 0;             // Time spent in it
+};
+
+class Simulation {
+public:
+  Simulation(const SimPolicy& policy, const SimScenario& scenario, const SimTiming& timing)
+    : policy(policy), scenario(scenario), timing(timing) {
+    endMs = (uint64_t)(scenario.days * 24 * 3600000.0);
+    energyCountersReset(result.energy);
+    energyTrackerBegin(tracker, 0);
+    sleepPolicyReset(sleepPolicy);
+    refreshSchedulerReset(refresh);
+    nextChangeMs = nextInterval();
+    nextBatteryMs = scenario.batteryChangeMs;
+  }
+  
+  SimResult run() {
+    while (now < endMs) {
+      if (!bootAndConnect()) {
+        continue;
+      }
+      if (policy.dutyCycle) {
+        dutyCycle();
+      } else {
+        alwaysOn();
+      }
+    }
+    energyTrackerFlush(tracker, result.energy, now);
+    result.undisplayed = pending.size();
+    return result;
+  }
+  
+private:
+  struct Change {
+    uint64_t at;
+    int vehicle;
+  };
+  
+  const SimPolicy& policy;
+  const SimScenario& scenario;
+  const SimTiming& timing;
+  SimResult result;
+  uint64_t now = 0;
+  uint64_t endMs;
+  uint32_t rng = 0x2545F491;
+  
+  // Firmware state
+  EnergyTracker tracker;
+  SleepPolicyState sleepPolicy;
+  RefreshSchedulerState refresh;
+  bool cacheValid = false;
+  uint64_t leaseAtMs = 0;
+  bool vehiclesKnown = false;      // rtcState.vehicleCount > 0
+  bool queriedThisBoot = false;    // VehicleDiscovery::waitForFirstQuery(0)
+  uint64_t wokeAtMs = 0;
+  uint32_t wakesSinceDiscovery = 0;
+  bool panelInSync = false;        // Controller RAM holds the frame, kept through deep sleep
+  bool statusOnPanel = false;      // The status screen rather than the sleep screen is shown
+  uint64_t displayedMinute = 0;
+  uint32_t sleepScreenMs = 0;      // Sleep duration on the sleep screen, 0 if not shown
+  
+  // Concurrent activity: background discovery and the panel refreshing
+  bool discoveryRunning = false;
+  bool mdnsActive = false;
+  uint64_t discoveryEdgeMs = 0;
+  bool panelBusy = false;
+  uint64_t panelIdleMs = 0;
+  
+  // Content changes not yet fetched
+  std::vector<Change> pending;
+  uint64_t nextChangeMs;
+  uint64_t nextBatteryMs;
+  bool batteryChanged = false;
+  
+  uint32_t nextRandom() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+  }
+  
+  // Exponential, so vehicle changes form a Poisson process
+  uint64_t nextInterval() {
+    double u = (nextRandom() + 1.0) / 4294967297.0;
+    return (uint64_t)(-log(u) * scenario.vehicleChangeMeanMs) + 1;
+  }
+  
+  bool networkUp(uint64_t atMs) const {
+    int hour = (int)((atMs / 3600000) % 24);
+    return hour >= scenario.networkFromHour && hour < scenario.networkToHour;
+  }
+  
+  // Let time pass, running background edges in order
+  void advance(uint64_t ms) {
+    uint64_t target = now + ms;
+    while (true) {
+      uint64_t edge = target;
+      if (discoveryRunning && discoveryEdgeMs < edge) {
+        edge = discoveryEdgeMs;
+      }
+      if (panelBusy && panelIdleMs < edge) {
+        edge = panelIdleMs;
+      }
+      if (edge == target) {
+        break;
+      }
+      now = edge;
+      if (panelBusy && panelIdleMs == now) {
+        energyTrackerLeave(tracker, result.energy, ENERGY_PANEL_BUSY, now);
+        panelBusy = false;
+      } else if (mdnsActive) {
+        energyTrackerLeave(tracker, result.energy, ENERGY_MDNS, now);
+        mdnsActive = false;
+        vehiclesKnown = true;
+        queriedThisBoot = true;
+        discoveryEdgeMs = now + timing.discoveryIntervalMs;
+      } else {
+        energyTrackerEnter(tracker, result.energy, ENERGY_MDNS, now);
+        mdnsActive = true;
+        discoveryEdgeMs = now + timing.mdnsQueryMs;
+      }
+    }
+    now = target;
+  
+    // Vehicles share the watch's network, they only report while it is there
+    while (nextChangeMs <= now) {
+      if (networkUp(nextChangeMs)) {
+        pending.push_back({ nextChangeMs, (int)(nextRandom() % scenario.vehicles) });
+      }
+      nextChangeMs += nextInterval();
+    }
+    while (nextBatteryMs <= now) {
+      batteryChanged = true;
+      nextBatteryMs += scenario.batteryChangeMs;
+    }
+  }
+  
+  // Blocking activity of the main task
+  void spend(EnergyState state, uint64_t ms) {
+    energyTrackerEnter(tracker, result.energy, state, now);
+    advance(ms);
+    energyTrackerLeave(tracker, result.energy, state, now);
+  }
+  
+  void waitForPanel() {
+    if (panelBusy) {
+      advance(panelIdleMs - now);
+    }
+  }
+  
+  void deepSleep(uint64_t ms) {
+    // DisplayUpdater::prepareForSleep(): a long sleep starts without ghosting
+    waitForPanel();
+    if (ms >= timing.cleanSleepMs && refreshSchedulerHasGhosting(refresh)) {
+      spend(ENERGY_RENDER, timing.renderMs);
+      startRefresh(false);
+      waitForPanel();
+    }
+    if (mdnsActive) {
+      energyTrackerLeave(tracker, result.energy, ENERGY_MDNS, now);
+      mdnsActive = false;
+    }
+    discoveryRunning = false;
+    energyTrackerFlush(tracker, result.energy, now);
+    energyCharge(result.energy, ENERGY_SLEEP, ms);
+    advance(ms);
+    energyTrackerBegin(tracker, now);
+    queriedThisBoot = false;
+  }
+  
+  // WiFiManager: directed connect from the cache, else scan, associate and DHCP
+  bool connect() {
+    if (cacheValid) {
+      if (networkUp(now)) {
+        spend(ENERGY_ASSOCIATE, timing.fastConnectMs);
+        if (now - leaseAtMs >= timing.leaseReuseMs) {
+          spend(ENERGY_DHCP, timing.dhcpMs);
+          leaseAtMs = now;
+        }
+        return true;
+      }
+      spend(ENERGY_ASSOCIATE, timing.fastConnectTimeoutMs);
+      cacheValid = false;
+    }
+  
+    spend(ENERGY_SCAN, timing.scanMs);
+    if (!networkUp(now)) {
+      return false;
+    }
+    spend(ENERGY_ASSOCIATE, timing.associateMs);
+    spend(ENERGY_DHCP, timing.dhcpMs);
+    cacheValid = true;
+    leaseAtMs = now;
+    return true;
+  }
+  
+  // onWiFiUnavailable(): sleep screen, then the sleep policy's backoff
+  void networkAbsent() {
+    result.failedConnects++;
+    uint32_t sleepMs = sleepPolicyRecordFailure(sleepPolicy, now);
+  
+    // DisplayUpdater skips a sleep screen identical to the one on the panel
+    if (statusOnPanel || sleepMs != sleepScreenMs || batteryChanged) {
+      spend(ENERGY_RENDER, timing.renderMs);
+      startRefresh(false);
+      batteryChanged = false;
+    } else {
+      result.skippedUpdates++;
+    }
+    statusOnPanel = false;
+    sleepScreenMs = sleepMs;
+    deepSleep(sleepMs);
+  }
+  
+  bool bootAndConnect() {
+    result.wakes++;
+    wokeAtMs = now;
+    spend(ENERGY_BOOT, timing.bootMs);
+    if (!connect()) {
+      networkAbsent();
+      return false;
+    }
+    sleepPolicyRecordSuccess(sleepPolicy, now);
+    return true;
+  }
+  
+  void startRefresh(bool partial) {
+    if (partial) {
+      result.partialUpdates++;
+    } else {
+      refreshSchedulerReset(refresh);
+      result.fullUpdates++;
+    }
+    panelBusy = true;
+    panelIdleMs = now + (partial ? timing.partialRefreshMs : timing.fullRefreshMs);
+    energyTrackerEnter(tracker, result.energy, ENERGY_PANEL_BUSY, now);
+    panelInSync = true;
+  }
+  
+  // drawUI(): fetch, render, then the panel refreshes in the background
+  void drawStatus() {
+    std::vector<Change> captured;
+    captured.swap(pending);
+    spend(ENERGY_HTTP, timing.fetchMs);
+  
+    uint32_t changed[REGION_COUNT] = {};
+    uint64_t minute = now / 60000 / timing.uptimeStepMinutes * timing.uptimeStepMinutes;
+    for (const Change& change : captured) {
+      changed[REGION_VEHICLE + change.vehicle % 3] = REGION_PIXELS[REGION_VEHICLE + change.vehicle % 3];
+    }
+    if (batteryChanged) {
+      changed[REGION_BATTERY] = REGION_PIXELS[REGION_BATTERY];
+    }
+    if (minute != displayedMinute) {
+      changed[REGION_UPTIME] = REGION_PIXELS[REGION_UPTIME];
+    }
+    if (!statusOnPanel) {
+      for (int i = 0; i < REGION_COUNT; i++) {
+        changed[i] = REGION_PIXELS[i];
+      }
+    }
+  
+    bool anyChanged = false;
+    for (int i = 0; i < REGION_COUNT; i++) {
+      anyChanged |= changed[i] > 0;
+    }
+    if (!anyChanged) {
+      result.skippedUpdates++;
+      return;
+    }
+  
+    spend(ENERGY_RENDER, timing.renderMs);
+    bool partial = policy.partialUpdates && panelInSync && statusOnPanel &&
+                   !refreshSchedulerWantsFull(refresh, changed, REGION_COUNT);
+    if (partial) {
+      refreshSchedulerRecordPartial(refresh, changed, REGION_COUNT);
+    }
+    startRefresh(partial);
+  
+    for (const Change& change : captured) {
+      result.latencies.push_back((uint32_t)(panelIdleMs - change.at));
+    }
+    statusOnPanel = true;
+    displayedMinute = minute;
+    batteryChanged = false;
+  }
+  
+  // loop() while connected, until the network goes away
+  void alwaysOn() {
+    DrawSchedule schedule;
+    drawScheduleBegin(schedule, (uint32_t)now);
+    drawScheduleServicesStarted(schedule, (uint32_t)now, timing.mdnsQueryMs + 1000);
+    discoveryRunning = true;
+    discoveryEdgeMs = now;
+  
+    while (now < endMs) {
+      if (!networkUp(now)) {
+        // The manager reconnects from the cache, which fails while the AP is gone
+        if (!connect()) {
+          networkAbsent();
+          return;
+        }
+      }
+      sleepPolicyRecordConnected(sleepPolicy, now);
+      if (!panelBusy) {
+        bool sampleBattery = false;
+        if (drawScheduleDue(schedule, (uint32_t)now, queriedThisBoot, sampleBattery)) {
+          drawStatus();
+        }
+      }
+      
+      // Until the next draw, or short waits while one waits for the panel or discovery
+      uint32_t idleMs = panelBusy ? 0 : drawScheduleIdleMs(schedule, (uint32_t)now, timing.loopIdleMaxMs);
+      idleMs = std::max(idleMs, timing.loopBusyMs);
+      result.loopWakes++;
+      result.loopMs += idleMs;
+      advance(idleMs);
+    }
+  }
+  
+  // runDutyCycle(): connect, maybe discover, fetch, render and sleep out the interval
+  void dutyCycle() {
+    if (!vehiclesKnown || wakesSinceDiscovery >= timing.rediscoverWakes) {
+      spend(ENERGY_MDNS, timing.mdnsQueryMs);
+      vehiclesKnown = true;
+      wakesSinceDiscovery = 0;
+    } else {
+      wakesSinceDiscovery++;
+    }
+  
+    drawStatus();
+    waitForPanel();
+    uint64_t awakeMs = now - wokeAtMs;
+    deepSleep(awakeMs < policy.intervalMs ? policy.intervalMs - awakeMs : 1000);
+  }
+};
+
+// The tests link the same sources and bring their own main()
+#ifndef PIO_UNIT_TESTING
+static uint32_t percentile(const std::vector<uint32_t>& sorted, int percent) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  return sorted[std::min(sorted.size() - 1, sorted.size() * percent / 100)];
+}
+
+int main(int argc, char** argv) {
+  SimScenario scenario;
+  SimTiming timing;
+  if (argc > 1) {
+    scenario.days = atof(argv[1]);
+  }
+  
+  printf("%.1f days, network from %02d:00 to %02d:00, %d vehicles, %.0f mAh battery\n\n",
+         scenario.days, scenario.networkFromHour, scenario.networkToHour, scenario.vehicles, scenario.capacityMah);
+  printf("%-28s %8s %8s %8s %16s %6s %22s\n", "Policy", "mAh", "avg mA", "days", "full/part/skip", "wakes",
+         "latency avg/p95/max s");
+  
+  std::vector<SimResult> results;
+  auto started = std::chrono::steady_clock::now();
+  for (const SimPolicy& policy : POLICIES) {
+    SimResult result = Simulation(policy, scenario, timing).run();
+  
+    std::vector<uint32_t> sorted = result.latencies;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0;
+    for (uint32_t latency : sorted) {
+      sum += latency;
+    }
+    double mah = energyTotalMilliampHours(result.energy);
+    double hours = energyTotalMs(result.energy) / 3600000.0;
+    double averageMa = hours > 0 ? mah / hours : 0;
+  
+    char updates[32];
+    snprintf(updates, sizeof(updates), "%u/%u/%u", result.fullUpdates, result.partialUpdates, result.skippedUpdates);
+    char latency[32];
+    snprintf(latency, sizeof(latency), "%.0f/%u/%u", sorted.empty() ? 0 : sum / sorted.size() / 1000,
+             percentile(sorted, 95) / 1000, sorted.empty() ? 0 : sorted.back() / 1000);
+    printf("%-28s %8.1f %8.2f %8.1f %16s %6u %22s\n", policy.name, mah, averageMa,
+           averageMa > 0 ? scenario.capacityMah / averageMa / 24 : 0, updates, result.wakes, latency);
+    results.push_back(result);
+  }
+  double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+  
+  // CPU wakes while awake and idle, against both tasks polling every LOOP_BUSY_DELAY_MS
+  double pollingUa = energyIdleCurrentUa(2 * 1000.0 / timing.loopBusyMs);
+  printf("\n%-28s %8s %8s %14s\n", "Idle", "wakes/s", "mA", "10 ms polls mA");
+  for (size_t i = 0; i < results.size(); i++) {
+    if (results[i].loopMs == 0) {
+      continue;
+    }
+    double wakesPerS = results[i].loopWakes * 1000.0 / results[i].loopMs + timing.udpTaskWakesPerS;
+    printf("%-28s %8.1f %8.2f %14.2f\n", POLICIES[i].name, wakesPerS, energyIdleCurrentUa(wakesPerS) / 1000,
+           pollingUa / 1000);
+  }
+  
+  // Where the charge went
+  printf("\n%-12s", "mAh");
+  for (const SimPolicy& policy : POLICIES) {
+    printf(" %10.10s", policy.name);
+  }
+  printf("\n");
+  for (int i = 0; i < ENERGY_STATE_COUNT; i++) {
+    printf("%-12s", energyStateName((EnergyState)i));
+    for (const SimResult& result : results) {
+      printf(" %10.2f", energyMilliampHours(result.energy, (EnergyState)i));
+    }
+    printf("\n");
+  }
+  
+  printf("\nSimulated in %.0f ms\n", elapsedMs);
+  return 0;
+}
+#endif // PIO_UNIT_TESTING
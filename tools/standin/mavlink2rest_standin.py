@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+"""
+Stand-in for the mavlink2rest WebSocket endpoint, for testing the battery stream
+without a vehicle.
+
+Replays saved mavlink2rest messages, one JSON object per line, to every client of
+/v1/ws/mavlink, honouring its ?filter= regex on the message type. The default
+battery_status.jsonl is a vehicle with a second battery monitor and a gimbal that
+reports its own battery. Build the
+firmware with the host's address as a fixed stream endpoint:
+
+  build_flags = -DBATTERY_STREAM_FIXED_IP=\"192.168.1.10\"
+
+then run:  python3 tools/standin/mavlink2rest_standin.py [--rate 4] [--drop-after 30]
+
+The watch should subscribe once, log one voltage every BATTERY_STREAM_MIN_INTERVAL_MS
+whatever the rate, ignore the second battery and the gimbal, and reconnect after
+BATTERY_STREAM_RECONNECT_MS when --drop-after closes the connection.
+Only the Python standard library is needed.
+"""
+
+import argparse
+import base64
+import hashlib
+import json
+import os
+import re
+import socket
+import struct
+import threading
+import time
+import urllib.parse
+
+WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+WS_PATH = "/v1/ws/mavlink"
+DEFAULT_RECORDING = os.path.join(os.path.dirname(os.path.abspath(__file__)), "battery_status.jsonl")
+
+
+def load_recording(path):
+    """@return (message type, line) of every message"""
+    with open(path) as f:
+        lines = [line.strip() for line in f if line.strip()]
+    return [(json.loads(line)["message"]["type"], line) for line in lines]
+
+
+def send_frame(conn, opcode, payload=b""):
+    header = bytes([0x80 | opcode])
+    length = len(payload)
+    if length < 126:
+        header += bytes([length])
+    elif length < 65536:
+        header += bytes([126]) + struct.pack(">H", length)
+    else:
+        header += bytes([127]) + struct.pack(">Q", length)
+    conn.sendall(header + payload)
+
+
+def read_exact(conn, count):
+    data = b""
+    while len(data) < count:
+        chunk = conn.recv(count - len(data))
+        if not chunk:
+            raise ConnectionError("client closed")
+        data += chunk
+    return data
+
+
+def read_frames(conn, closed):
+    """Answer pings and notice a close, client frames are masked"""
+    try:
+        while not closed.is_set():
+            first, second = read_exact(conn, 2)
+            opcode = first & 0x0F
+            length = second & 0x7F
+            if length == 126:
+                length = struct.unpack(">H", read_exact(conn, 2))[0]
+            elif length == 127:
+                length = struct.unpack(">Q", read_exact(conn, 8))[0]
+            mask = read_exact(conn, 4) if second & 0x80 else b"\0\0\0\0"
+            payload = bytes(b ^ mask[i % 4] for i, b in enumerate(read_exact(conn, length)))
+            if opcode == 0x8:
+                break
+            if opcode == 0x9:
+                send_frame(conn, 0xA, payload)
+    except (ConnectionError, OSError):
+        pass
+    closed.set()
+
+
+def handshake(conn):
+    """@return the filter regex of the subscription, None if the request is not ours"""
+    request = b""
+    while b"\r\n\r\n" not in request:
+        chunk = conn.recv(4096)
+        if not chunk:
+            return None
+        request += chunk
+    lines = request.decode("latin-1").split("\r\n")
+    target = lines[0].split(" ")[1]
+    headers = {}
+    for line in lines[1:]:
+        if ":" in line:
+            name, value = line.split(":", 1)
+            headers[name.strip().lower()] = value.strip()
+
+    url = urllib.parse.urlparse(target)
+    if url.path != WS_PATH or "sec-websocket-key" not in headers:
+        conn.sendall(b"HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n")
+        return None
+
+    accept = base64.b64encode(hashlib.sha1((headers["sec-websocket-key"] + WS_GUID).encode()).digest())
+    conn.sendall(b"HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                 b"Sec-WebSocket-Accept: " + accept + b"\r\n\r\n")
+    return urllib.parse.parse_qs(url.query).get("filter", [".*"])[0]
+
+
+def serve_client(conn, address, recording, rate, drop_after):
+    with conn:
+        message_filter = handshake(conn)
+        if message_filter is None:
+            return
+        print(f"{address[0]}: subscribed, filter {message_filter}")
+        pattern = re.compile(message_filter)
+        closed = threading.Event()
+        threading.Thread(target=read_frames, args=(conn, closed), daemon=True).start()
+
+        started = time.monotonic()
+        sent = 0
+        try:
+            while not closed.is_set():
+                if drop_after and time.monotonic() - started >= drop_after:
+                    print(f"{address[0]}: dropping the connection after {drop_after} s")
+                    send_frame(conn, 0x8, struct.pack(">H", 1001))
+                    break
+                message_type, line = recording[sent % len(recording)]
+                if pattern.fullmatch(message_type):
+                    send_frame(conn, 0x1, line.encode())
+                sent += 1
+                time.sleep(1.0 / rate)
+        except OSError:
+            pass
+        closed.set()
+        print(f"{address[0]}: closed after {sent} messages")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--port", type=int, default=6040)
+    parser.add_argument("--recording", default=DEFAULT_RECORDING, help="mavlink2rest messages, one JSON object per line")
+    parser.add_argument("--rate", type=float, default=4.0, help="messages per second")
+    parser.add_argument("--drop-after", type=float, default=0, help="close each connection after this many seconds")
+    args = parser.parse_args()
+
+    recording = load_recording(args.recording)
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind(("", args.port))
+    server.listen()
+    print(f"mavlink2rest stand-in on port {args.port}, {len(recording)} messages at {args.rate}/s")
+    while True:
+        conn, address = server.accept()
+        threading.Thread(target=serve_client, args=(conn, address, recording, args.rate, args.drop_after),
+                         daemon=True).start()
+
+
+if __name__ == "__main__":
+    main()